@@ -88,6 +88,26 @@ class CF : public Estimator
      */
     virtual bool update  (estimator_function_t function, const real_t& dt, 
                           const uint8_t& m, real_t* z, real_t* kp);
+    /**
+     * Provides length of checkpoint: state vector and error vector.
+     * \return checkpoint length
+     * \sa checkpoint(), restore()
+     */
+    virtual uint16_t getCheckpointLength () {return _n + BLOB_CF_MAX_LENGTH;}
+    /**
+     * Saves state vector and error vector.
+     * \param buffer  destination of getCheckpointLength() elements
+     * \return        true if successful, false otherwise
+     * \sa restore()
+     */
+    virtual bool checkpoint (real_t* buffer);
+    /**
+     * Restores state vector and error vector.
+     * \param buffer  checkpoint of getCheckpointLength() elements
+     * \return        true if successful, false otherwise
+     * \sa checkpoint()
+     */
+    virtual bool restore (const real_t* buffer);
     /**
      * Outputs internal and state information from filter to standard output.
      */
@@ -95,7 +115,7 @@ class CF : public Estimator
 
   protected:
     uint8_t _l;                         /**< error vector length */
-    real_t _error[BLOB_CF_MAX_LENGTH]; /**< error vector */
+    AlignedBuffer<real_t,BLOB_CF_MAX_LENGTH> _error; /**< error vector */
 };
 
 }
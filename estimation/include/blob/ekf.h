@@ -0,0 +1,248 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       ekf.h
+ * \brief      interface for generic extended kalman filter
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_EKF_H
+#define B_EKF_H
+
+#include <blob/estimator.h>
+#include <blob/matrix.h>
+#include <blob/dual.h>
+
+#if !defined(BLOB_EKF_MAX_N)
+ #define BLOB_EKF_MAX_N BLOB_ESTIMATOR_MAX_STATE_LENGTH
+#endif
+
+#if !defined(BLOB_EKF_MAX_M)
+ #define BLOB_EKF_MAX_M BLOB_ESTIMATOR_MAX_MEASUREMENT_LENGTH
+#endif
+
+namespace blob {
+
+/**
+ * Defines function providing the jacobian of an estimator function.
+ * \param dt   time lapse
+ * \param arg  control input (predict) or NULL (update)
+ * \param x    state vector
+ * \param J    resulting jacobian d(result)/dx, row-major (result length x n)
+ */
+typedef void (*estimator_jacobian_t)(const real_t& dt, real_t* arg, 
+                                     real_t* x, real_t* J);
+
+/**
+ * Implements generic Extended Kalman Filter. Jacobians are given by callback,
+ * by forward-mode automatic differentiation of functions templated on the
+ * scalar type (evaluated once over Dual<N>), or by forward differences when 
+ * only the estimator function is available.
+ */
+class EKF : public Estimator
+{
+  public:
+    /**
+     * Initializes filter parameters and state vector.
+     * \param n      number of states
+     * \param init_x state vector inital value
+     */
+    EKF (uint8_t n=0, real_t* init_x=NULL);
+
+    /**
+     * Applies f function to provide a model based prediction of system state,
+     * with jacobian by forward differences (n+1 evaluations of f).
+     * \param function pointer to f function to be applied during prediction
+     * \param dt       time lapse
+     * \param l        control input vector length
+     * \param u        control input vector
+     * \param q        state model noise covariance (n x n)
+     * \return         true if successful, false otherwise
+     * \sa update()
+     */
+    virtual bool predict (estimator_function_t function, const real_t& dt, 
+                          const uint8_t& l, real_t* u, real_t* q);
+    /**
+     * Applies h function to update system state with sensor measurement,
+     * with jacobian by forward differences (n+1 evaluations of h).
+     * \param function pointer to h function to be applied during sensor update
+     * \param dt  time lapse
+     * \param m   sensor measurement vector length
+     * \param z   sensor measurement vector
+     * \param r   sensor measurement noise covariance (m x m)
+     * \return    true if successful, false otherwise
+     * \sa predict()
+     */
+    virtual bool update  (estimator_function_t function, const real_t& dt, 
+                          const uint8_t& m, real_t* z, real_t* r);
+    /**
+     * Prediction with analytic jacobian F = df/dx (see predict()).
+     * \param jacobian pointer to function providing F
+     */
+    bool predict (estimator_function_t function, estimator_jacobian_t jacobian,
+                  const real_t& dt, const uint8_t& l, real_t* u, real_t* q);
+    /**
+     * Update with analytic jacobian H = dh/dx (see update()).
+     * \param jacobian pointer to function providing H
+     */
+    bool update  (estimator_function_t function, estimator_jacobian_t jacobian,
+                  const real_t& dt, const uint8_t& m, real_t* z, real_t* r);
+    /**
+     * Prediction with f function evaluated once over dual numbers, which 
+     * provides both f(x) and F = df/dx (see predict()). N must be at least
+     * the number of states.
+     * \param function pointer to f<Dual<N> > instance of templated f function
+     */
+    template <int N> bool predict (void (*function)(const real_t&, real_t*, 
+                                                   Dual<N>*, Dual<N>*),
+                                   const real_t& dt, const uint8_t& l, 
+                                   real_t* u, real_t* q)
+    {
+      BLOB_MATRIX_ALIGNED real_t fx[BLOB_EKF_MAX_N];
+      BLOB_MATRIX_ALIGNED real_t F[BLOB_EKF_MAX_N*BLOB_EKF_MAX_N];
+      if(!differentiate(function, dt, u, _n, fx, F))
+        return false;
+      return propagate(fx, F, q);
+    }
+    /**
+     * Update with h function evaluated once over dual numbers, which provides
+     * both h(x) and H = dh/dx (see update()). N must be at least the number 
+     * of states.
+     * \param function pointer to h<Dual<N> > instance of templated h function
+     */
+    template <int N> bool update  (void (*function)(const real_t&, real_t*, 
+                                                   Dual<N>*, Dual<N>*),
+                                   const real_t& dt, const uint8_t& m, 
+                                   real_t* z, real_t* r)
+    {
+      BLOB_MATRIX_ALIGNED real_t hx[BLOB_EKF_MAX_M];
+      BLOB_MATRIX_ALIGNED real_t H[BLOB_EKF_MAX_M*BLOB_EKF_MAX_N];
+      if(!differentiate(function, dt, NULL, m, hx, H))
+        return false;
+      return correct(m, z, hx, H, r);
+    }
+    /**
+     * Provides pointer to state covariance.
+     * \return pointer to n x n covariance
+     */
+    real_t* getCovariance () {return _P;}
+    /**
+     * Provides length of checkpoint: state vector and covariance matrix.
+     * \return checkpoint length
+     * \sa checkpoint(), restore()
+     */
+    virtual uint16_t getCheckpointLength () {return _n + _n*_n;}
+    /**
+     * Saves state vector and covariance matrix.
+     * \param buffer  destination of getCheckpointLength() elements
+     * \return        true if successful, false otherwise
+     * \sa restore()
+     */
+    virtual bool checkpoint (real_t* buffer);
+    /**
+     * Restores state vector and covariance matrix.
+     * \param buffer  checkpoint of getCheckpointLength() elements
+     * \return        true if successful, false otherwise
+     * \sa checkpoint()
+     */
+    virtual bool restore (const real_t* buffer);
+    /**
+     * Outputs internal and state information from filter to standard output.
+     */
+    virtual void print   ();
+
+  protected:
+    /**
+     * Evaluates function over dual numbers seeded with the state vector.
+     * \param function pointer to function over dual numbers
+     * \param dt   time lapse
+     * \param arg  control input or NULL
+     * \param l    result length
+     * \param y    resulting function value (l)
+     * \param J    resulting jacobian (l x n)
+     * \return  true if successful, false otherwise
+     */
+    template <int N> bool differentiate (void (*function)(const real_t&, 
+                                         real_t*, Dual<N>*, Dual<N>*),
+                                         const real_t& dt, real_t* arg, int l,
+                                         real_t* y, real_t* J)
+    {
+      if((N < _n) || (l > BLOB_ESTIMATOR_MAX_LENGTH))
+      {
+#if defined(__DEBUG__) & defined(__linux__)
+        std::cerr << "EKF::differentiate() error: Dual<" << N << "> for " 
+                  << (int)_n << " states" << std::endl;
+#endif
+        return false;
+      }
+      Dual<N> x[N], r[BLOB_ESTIMATOR_MAX_LENGTH];
+      for(int i=0; i<_n; i++)
+        x[i] = Dual<N>(_x[i], i);
+      function(dt, arg, x, r);
+      for(int i=0; i<l; i++)
+      {
+        y[i] = r[i].value();
+        for(int j=0; j<_n; j++)
+          J[i*_n+j] = r[i].derivative(j);
+      }
+      return true;
+    }
+    /**
+     * Calculates jacobian of function at state vector by forward differences.
+     * \param function pointer to function
+     * \param dt   time lapse
+     * \param arg  control input or NULL
+     * \param l    result length
+     * \param y    resulting function value (l)
+     * \param J    resulting jacobian (l x n)
+     */
+    void differentiate (estimator_function_t function, const real_t& dt, 
+                        real_t* arg, int l, real_t* y, real_t* J);
+    /**
+     * Propagates state and covariance: x = f(x), P = F*P*F' + Q.
+     * \param fx  f(x)
+     * \param F   jacobian of f at x
+     * \param q   state model noise covariance
+     * \return  true if successful, false otherwise
+     */
+    bool propagate (real_t* fx, real_t* F, real_t* q);
+    /**
+     * Corrects state and covariance: K = P*H'/(H*P*H' + R), 
+     * x = x + K*(z - h(x)), P = (I - K*H)*P*(I - K*H)' + K*R*K'.
+     * \param m   measurement length
+     * \param z   measurement
+     * \param hx  h(x)
+     * \param H   jacobian of h at x
+     * \param r   sensor measurement noise covariance
+     * \return  true if successful, false otherwise
+     */
+    bool correct (uint8_t m, real_t* z, real_t* hx, real_t* H, real_t* r);
+
+    AlignedBuffer<real_t,BLOB_EKF_MAX_N*BLOB_EKF_MAX_N> _P; /**< covariance */
+};
+
+}
+
+#endif // B_EKF_H 
@@ -32,6 +32,7 @@
 #define B_ESTIMATOR_H
 
 #include <blob/types.h>
+#include <blob/aligned.h>
 
 #if defined(__linux__)
   #include <iostream>
@@ -63,6 +64,24 @@ namespace blob {
 typedef void (*estimator_function_t)(const real_t& dt, real_t* arg, 
                                            real_t* input, real_t* result);
 
+/**
+ * Defines function to predict and update estimations of a batch of points
+ * at once. Points are stored by components (structure of arrays): component
+ * i of point k is at input[i*stride + k], and result is laid out the same
+ * way, so that the function can process several points per instruction.
+ * Input and result never overlap.
+ * \param dt      time lapse
+ * \param arg     vector with control input or NULL
+ * \param input   input points, one row of stride elements per component
+ * \param result  resulting points, one row of stride elements per component
+ * \param npoints number of points to process
+ * \param stride  distance between consecutive components of a point
+ */
+typedef void (*estimator_batch_function_t)(const real_t& dt, real_t* arg,
+                                           const real_t* input, real_t* result,
+                                           const uint8_t& npoints,
+                                           const uint8_t& stride);
+
 /**
  * Interface  generic estimation algorithm.
  */
@@ -80,6 +99,11 @@ class Estimator
       if(init_state && _n)
         memcpy(_x, init_state, _n*sizeof(real_t));    
     }
+    /**
+     * Releases algorithm resources, so that estimators owning storage can be
+     * deleted through a pointer to this interface.
+     */
+    virtual ~Estimator () {}
 
     /**
      * Applies function to provide a model based estimation of system state.
@@ -142,10 +166,34 @@ class Estimator
      * \sa getNumStates()
      */
     real_t   getState (const uint8_t& i) {return _x[i];}
+    /**
+     * Provides length of checkpoint: the internal state of the algorithm 
+     * needed to resume estimation from the point it was saved. Not supported
+     * unless overridden, as the state vector alone does not resume most 
+     * algorithms.
+     * \return checkpoint length, 0 if checkpoints are not supported
+     * \sa checkpoint(), restore()
+     */
+    virtual uint16_t getCheckpointLength () {return 0;}
+    /**
+     * Saves checkpoint of algorithm internal state.
+     * \param buffer  destination of getCheckpointLength() elements
+     * \return        true if successful, false otherwise
+     * \sa restore()
+     */
+    virtual bool checkpoint (real_t* buffer) {return false;}
+    /**
+     * Restores algorithm internal state from checkpoint.
+     * \param buffer  checkpoint of getCheckpointLength() elements
+     * \return        true if successful, false otherwise
+     * \sa checkpoint()
+     */
+    virtual bool restore (const real_t* buffer) {return false;}
 
   protected: 
-    real_t _n;                                  /**< state vector length */
-    real_t _x[BLOB_ESTIMATOR_MAX_STATE_LENGTH]; /**< state vector */
+    uint8_t _n;                                 /**< state vector length */
+    AlignedBuffer<real_t,BLOB_ESTIMATOR_MAX_STATE_LENGTH> _x; /**< state 
+                                                                   vector */
 };
 }
 
@@ -0,0 +1,211 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       fusion.h
+ * \brief      interface for time-stamped fusion with out-of-sequence updates
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_FUSION_H
+#define B_FUSION_H
+
+#include <blob/estimator.h>
+
+#if !defined(BLOB_FUSION_HISTORY)
+ #define BLOB_FUSION_HISTORY 32 // predictions kept to replay late measurements
+#endif
+
+#if !defined(BLOB_FUSION_CAPACITY)
+ #define BLOB_FUSION_CAPACITY 32 // measurements kept to replay
+#endif
+
+#if !defined(BLOB_FUSION_MAX_SENSORS)
+ #define BLOB_FUSION_MAX_SENSORS 8
+#endif
+
+namespace blob {
+
+/**
+ * Sensor registered in fusion front-end.
+ */
+typedef struct
+{
+  estimator_function_t h; /**< sensor model */
+  uint8_t m;              /**< measurement vector length */
+  real_t* r;              /**< measurement noise covariance (m x m) */
+  real_t dt;              /**< time lapse passed to update (sensor period) */
+} fusion_sensor_t;
+
+/**
+ * Time-stamped measurement kept for replay.
+ */
+typedef struct
+{
+  uint32_t t;                                     /**< timestamp [us] */
+  uint8_t sensor;                                 /**< sensor index */
+  real_t z[BLOB_ESTIMATOR_MAX_MEASUREMENT_LENGTH];/**< measurement vector */
+} fusion_measurement_t;
+
+/**
+ * Implements fusion front-end over any estimator supporting checkpoints, 
+ * accepting time-stamped inputs and measurements. Every prediction (tick) 
+ * stores its input and a checkpoint of the estimator before the measurements
+ * of the tick are applied. A measurement is applied at the latest tick not 
+ * newer than its timestamp: in order measurements are applied directly, late
+ * ones are inserted in the time-sorted measurement queue and the estimator is
+ * restored to the checkpoint of their tick and re-propagated up to the newest
+ * tick, so that the result is the same as if they had arrived in order. 
+ * Measurements older than the oldest tick kept are dropped. All buffers are
+ * allocated at construction.
+ */
+class Fusion
+{
+  public:
+    /**
+     * Initializes fusion front-end and allocates its buffers.
+     * \param filter    estimator, must support checkpoints to replay
+     * \param f         state model function
+     * \param l         control input vector length
+     * \param q         state model noise covariance
+     * \param t         timestamp of initial filter state [us], time base of
+     *                  the first prediction
+     * \param history   number of ticks kept, bounds measurement delay and 
+     *                  replay cost
+     * \param capacity  number of measurements kept for replay
+     */
+    Fusion (Estimator* filter, estimator_function_t f, uint8_t l, real_t* q,
+            uint32_t t, uint8_t history=BLOB_FUSION_HISTORY, 
+            uint8_t capacity=BLOB_FUSION_CAPACITY);
+    /**
+     * Releases buffers.
+     */
+    ~Fusion ();
+
+    /**
+     * Registers sensor.
+     * \param h   sensor model function
+     * \param m   measurement vector length
+     * \param r   measurement noise covariance (m x m)
+     * \param dt  time lapse passed to sensor update (typically its period)
+     * \return    sensor index, -1 if not possible
+     */
+    int8_t addSensor (estimator_function_t h, uint8_t m, real_t* r, 
+                      const real_t& dt);
+    /**
+     * Predicts state up to time t with control input u and stores new tick.
+     * \param t  timestamp [us]
+     * \param u  control input vector (not modified)
+     * \return   true if successful, false otherwise
+     */
+    bool predict (uint32_t t, const real_t* u);
+    /**
+     * Fuses time-stamped measurement, replaying ticks if it is late.
+     * \param sensor  sensor index
+     * \param t       timestamp [us]
+     * \param z       measurement vector (not modified)
+     * \return        true if successful, false otherwise (e.g. dropped)
+     */
+    bool update (uint8_t sensor, uint32_t t, const real_t* z);
+
+    /**
+     * Provides timestamp of newest tick, or of initial state before any.
+     * \return timestamp [us]
+     */
+    uint32_t getTime () {return _t;}
+    /**
+     * Provides number of late measurements fused by replay.
+     * \return number of replays
+     */
+    uint32_t getReplays () {return _replays;}
+    /**
+     * Provides number of ticks re-propagated during replays.
+     * \return number of replayed ticks
+     */
+    uint32_t getReplayedTicks () {return _replayed;}
+    /**
+     * Provides number of measurements dropped because too late or because 
+     * queue was full.
+     * \return number of dropped measurements
+     */
+    uint32_t getDropped () {return _dropped;}
+
+  protected:
+    /**
+     * Provides buffer index of kth oldest tick.
+     */
+    uint8_t tick (uint8_t k) {return (_head + k)%_history;}
+    /**
+     * Applies measurement with copy of its vector.
+     */
+    bool apply (const fusion_measurement_t & measurement);
+    /**
+     * Inserts measurement in time-sorted queue, after those with same time.
+     * \return position in queue, -1 if not possible
+     */
+    int insert (uint8_t sensor, uint32_t t, const real_t* z);
+    /**
+     * Restores checkpoint of kth oldest tick and re-propagates up to newest.
+     */
+    bool replay (uint8_t k);
+
+    Estimator* _filter;      /**< estimator */
+    estimator_function_t _f; /**< state model function */
+    uint8_t _l;              /**< control input vector length */
+    real_t* _q;              /**< state model noise covariance */
+    uint16_t _c;             /**< checkpoint length */
+
+    fusion_sensor_t _sensors[BLOB_FUSION_MAX_SENSORS]; /**< sensors */
+    uint8_t _nsensors;       /**< number of sensors */
+
+    void*    _mem;           /**< single allocation of buffers */
+    uint8_t  _history;       /**< tick buffer length */
+    uint8_t  _head;          /**< buffer index of oldest tick */
+    uint8_t  _count;         /**< number of ticks kept */
+    uint32_t* _times;        /**< tick timestamps */
+    real_t*  _dts;           /**< tick time lapses */
+    real_t*  _inputs;        /**< tick control inputs (history x l) */
+    real_t*  _checkpoints;   /**< tick checkpoints before measurements */
+    fusion_measurement_t* _queue; /**< time-sorted measurements */
+    uint8_t  _capacity;      /**< measurement queue length */
+    uint8_t  _size;          /**< number of measurements kept */
+
+    uint32_t _t;             /**< timestamp of newest tick or initial state */
+    uint32_t _replays;       /**< late measurements fused by replay */
+    uint32_t _replayed;      /**< ticks re-propagated */
+    uint32_t _dropped;       /**< dropped measurements */
+
+  private:
+    /**
+     * Not copyable: buffers would be released twice.
+     */
+    Fusion (const Fusion &);
+    /**
+     * Not assignable: buffers would be released twice.
+     */
+    Fusion & operator= (const Fusion &);
+};
+}
+
+#endif // B_FUSION_H
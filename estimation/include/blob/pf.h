@@ -0,0 +1,334 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       pf.h
+ * \brief      interface for generic particle filter
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_PF_H
+#define B_PF_H
+
+#include <blob/estimator.h>
+#include <blob/matrix.h>
+
+#if defined(__linux__)
+  #include <blob/pool.h>
+#endif
+
+#if !defined(BLOB_PF_MAX_N)
+ #define BLOB_PF_MAX_N BLOB_ESTIMATOR_MAX_STATE_LENGTH
+#endif
+
+#if !defined(BLOB_PF_MAX_M)
+ #define BLOB_PF_MAX_M BLOB_ESTIMATOR_MAX_MEASUREMENT_LENGTH
+#endif
+
+#if !defined(BLOB_PF_CHUNK)
+ #define BLOB_PF_CHUNK 4096 // particles per chunk of work (and random stream)
+#endif
+
+#if !defined(BLOB_PF_ESS_THRESHOLD)
+ #define BLOB_PF_ESS_THRESHOLD 0.5 // resample when ESS < threshold*particles
+#endif
+
+namespace blob {
+
+/**
+ * Defines resampling schemes, both O(N) over sorted uniform samples.
+ */
+typedef enum
+{
+  PF_SYSTEMATIC = 0, /**< single uniform offset shared by all strata */
+  PF_STRATIFIED = 1  /**< independent uniform sample per stratum */
+} pf_resampling_t;
+
+/**
+ * Defines function applied to a range of particles in structure of arrays 
+ * layout, so that loops over particles vectorize.
+ * \param dt      time lapse
+ * \param arg     control input (predict) or sensor measurement (update)
+ * \param x       state rows: x[i][k] is state i of particle k
+ * \param begin   first particle of range
+ * \param end     one past last particle of range
+ * \param seed    random generator state of range (see uniform(), gaussian())
+ * \param result  NULL when predicting (particles propagated in place), log 
+ *                likelihood of particle k at result[k] when updating
+ */
+typedef void (*pf_function_t)(const real_t& dt, real_t* arg, real_t* const* x,
+                              uint32_t begin, uint32_t end, uint32_t* seed, 
+                              real_t* result);
+
+/**
+ * Implements generic Particle Filter (sequential importance resampling). 
+ * Particles are stored as structure of arrays and processed in chunks of 
+ * BLOB_PF_CHUNK particles, optionally over a worker pool. Every chunk owns a
+ * random stream seeded from filter seed, step and chunk index, and partial 
+ * sums are reduced in chunk order, so results do not depend on the number of
+ * threads. State vector holds the weighted mean of particles.
+ */
+class PF : public Estimator
+{
+  public:
+    /**
+     * Initializes filter parameters, particles and state vector.
+     * \param n      number of states
+     * \param init_x state vector inital value
+     * \param np     number of particles
+     * \param init_s initial standard deviation of each state, NULL for all 
+     *               particles at init_x
+     * \param seed   random generator seed (not 0)
+     */
+    PF (uint8_t n=0, real_t* init_x=NULL, uint32_t np=1000, 
+        real_t* init_s=NULL, uint32_t seed=1);
+    /**
+     * Releases particle storage.
+     */
+    ~PF ();
+
+    /**
+     * Applies f function to every particle and adds gaussian process noise.
+     * \param function pointer to f function to be applied during prediction
+     * \param dt       time lapse
+     * \param l        control input vector length
+     * \param u        control input vector
+     * \param q        state model noise covariance (n x n), NULL for none
+     * \return         true if successful, false otherwise
+     * \sa update()
+     */
+    virtual bool predict (estimator_function_t function, const real_t& dt, 
+                          const uint8_t& l, real_t* u, real_t* q);
+    /**
+     * Weights particles with gaussian likelihood of sensor measurement 
+     * through h function and resamples if effective sample size is low.
+     * \param function pointer to h function to be applied during sensor update
+     * \param dt  time lapse
+     * \param m   sensor measurement vector length
+     * \param z   sensor measurement vector
+     * \param r   sensor measurement noise covariance (m x m)
+     * \return    true if successful, false otherwise
+     * \sa predict()
+     */
+    virtual bool update  (estimator_function_t function, const real_t& dt, 
+                          const uint8_t& m, real_t* z, real_t* r);
+    /**
+     * Propagates particles with vectorized f function, which must add its own
+     * process noise.
+     * \param function pointer to f function over a range of particles
+     * \param dt       time lapse
+     * \param u        control input vector
+     * \return         true if successful, false otherwise
+     */
+    bool predict (pf_function_t function, const real_t& dt, real_t* u);
+    /**
+     * Weights particles with log likelihood given by vectorized h function and
+     * resamples if effective sample size is low.
+     * \param function pointer to h function over a range of particles
+     * \param dt       time lapse
+     * \param z        sensor measurement vector
+     * \return         true if successful, false otherwise
+     */
+    bool update  (pf_function_t function, const real_t& dt, real_t* z);
+    /**
+     * Resamples particles with current scheme and resets weights to 1/N.
+     * \return  true if successful, false otherwise
+     */
+    bool resample ();
+    /**
+     * Sets resampling scheme and effective sample size trigger.
+     * \param scheme     resampling scheme
+     * \param threshold  resample when ESS < threshold*N, 0 to never trigger
+     */
+    void setResampling (pf_resampling_t scheme, 
+                        real_t threshold=BLOB_PF_ESS_THRESHOLD);
+#if defined(__linux__)
+    /**
+     * Sets worker pool to process chunks of particles, NULL for caller only.
+     * \param pool  worker pool
+     */
+    void setPool (Pool* pool) {_pool = pool;}
+#endif
+    /**
+     * Provides number of particles.
+     * \return number of particles
+     */
+    uint32_t getNumParticles () {return _np;}
+    /**
+     * Provides pointer to row of state i of all particles.
+     * \param i  state index
+     * \return pointer to np values of state i
+     */
+    real_t*  getParticles (uint8_t i) {return _rows[i];}
+    /**
+     * Provides pointer to normalized particle weights.
+     * \return pointer to np weights
+     */
+    real_t*  getWeights () {return _w;}
+    /**
+     * Provides effective sample size 1/sum(w^2) after last update.
+     * \return effective sample size
+     */
+    real_t   getEffectiveSampleSize () {return _ess;}
+    /**
+     * Provides number of resamplings since initialization.
+     * \return number of resamplings
+     */
+    uint32_t getNumResamplings () {return _resamplings;}
+    /**
+     * Calculates weighted covariance of particles around state vector.
+     * \return pointer to n x n covariance
+     */
+    real_t*  getCovariance ();
+    /**
+     * Particles are not checkpointed.
+     * \return 0, checkpoints are not supported
+     */
+    virtual uint16_t getCheckpointLength () {return 0;}
+    /**
+     * Particles are not checkpointed.
+     * \param buffer  unused
+     * \return        false, checkpoints are not supported
+     */
+    virtual bool checkpoint (real_t* buffer) {return false;}
+    /**
+     * Particles are not restored from checkpoints.
+     * \param buffer  unused
+     * \return        false, checkpoints are not supported
+     */
+    virtual bool restore (const real_t* buffer) {return false;}
+    /**
+     * Outputs internal and state information from filter to standard output.
+     */
+    virtual void print   ();
+
+    /**
+     * Draws uniform random number from xorshift generator.
+     * \param seed  generator state (not 0), updated
+     * \return  uniform random number in [0,1)
+     */
+    static real_t uniform (uint32_t* seed)
+    {
+      uint32_t s = *seed;
+      s ^= s << 13; s ^= s >> 17; s ^= s << 5;
+      *seed = s;
+      return (real_t)(s >> 8)*(real_t)(1.0/16777216.0);
+    }
+    /**
+     * Draws standard normal random numbers (Box-Muller, in pairs).
+     * \param seed  generator state (not 0), updated
+     * \param g     resulting random numbers
+     * \param n     number of random numbers
+     */
+    static void gaussian (uint32_t* seed, real_t* g, int n);
+
+  protected:
+    /**
+     * Defines processing stage of a chunk job.
+     */
+    typedef enum 
+    {
+      PF_PROPAGATE = 0, /**< propagate particles, partial weighted sums */
+      PF_LIKELIHOOD = 1,/**< log likelihood of particles, partial maximum */
+      PF_WEIGHT = 2     /**< reweight particles, partial weighted sums */
+    } pf_stage_t;
+    /**
+     * Defines arguments of a chunk job.
+     */
+    typedef struct
+    {
+      PF*                  pf;    /**< filter */
+      pf_stage_t           stage; /**< processing stage */
+      pf_function_t        f;     /**< vectorized function, or NULL */
+      estimator_function_t g;     /**< per particle function, if f is NULL */
+      real_t               dt;    /**< time lapse */
+      real_t*              arg;   /**< control input or measurement */
+      uint8_t              m;     /**< measurement length */
+      real_t*              L;     /**< noise covariance cholesky factor */
+      uint8_t*             piv;   /**< rows of L, L(i,:) is row piv[i] */
+      real_t               max;   /**< maximum log likelihood */
+    } pf_job_t;
+
+    /**
+     * Processes one chunk of particles (see Pool::run()).
+     * \param job    pointer to pf_job_t
+     * \param chunk  chunk index
+     */
+    static void chunk (void* job, uint32_t chunk);
+    /**
+     * Runs job over all chunks, on worker pool if available.
+     * \param job  job arguments
+     * \return  true if successful, false otherwise
+     */
+    bool run (pf_job_t& job);
+    /**
+     * Reduces partial weighted sums of chunks into state vector, normalizes 
+     * weights and updates effective sample size.
+     * \return  true if successful, false otherwise
+     */
+    bool reduce ();
+    /**
+     * Shared implementation of predictions.
+     */
+    bool propagate (pf_job_t& job);
+    /**
+     * Shared implementation of updates.
+     */
+    bool weight (pf_job_t& job);
+
+    uint32_t        _np;          /**< number of particles */
+    uint32_t        _nchunks;     /**< number of chunks */
+    uint32_t        _seed;        /**< random generator seed */
+    uint32_t        _step;        /**< number of predictions and updates */
+    uint32_t        _resamplings; /**< number of resamplings */
+    pf_resampling_t _scheme;      /**< resampling scheme */
+    real_t          _threshold;   /**< ess resampling trigger */
+    real_t          _ess;         /**< effective sample size */
+    void*           _mem;         /**< particle storage */
+    real_t*         _p;           /**< particles, n x np (rows of states) */
+    real_t*         _q;           /**< resampling scratch, n x np */
+    real_t*         _w;           /**< weights, np */
+    real_t*         _l;           /**< log likelihoods in update(), np */
+    uint32_t*       _idx;         /**< resampled indexes, np */
+    real_t*         _sums;        /**< per chunk sum(w),sum(w^2),sum(w*x) */
+    real_t*         _rows[BLOB_PF_MAX_N]; /**< pointers to rows of _p */
+#if defined(__linux__)
+    Pool*           _pool;        /**< worker pool, or NULL */
+#endif
+    AlignedBuffer<real_t,BLOB_PF_MAX_N*BLOB_PF_MAX_N> _P; /**< covariance */
+
+  private:
+    /**
+     * Not copyable: particle storage would be released twice.
+     */
+    PF (const PF &);
+    /**
+     * Not assignable: particle storage would be released twice.
+     */
+    PF & operator= (const PF &);
+};
+
+}
+
+#endif // B_PF_H 
@@ -0,0 +1,165 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       srukf.h
+ * \brief      interface for generic square-root unscented kalman filter
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_SRUKF_H
+#define B_SRUKF_H
+
+#include <blob/estimator.h>
+#include <blob/matrix.h>
+
+#if !defined(BLOB_SRUKF_MAX_N)
+ #define BLOB_SRUKF_MAX_N BLOB_ESTIMATOR_MAX_STATE_LENGTH
+#endif
+
+#if !defined(BLOB_SRUKF_MAX_M)
+ #define BLOB_SRUKF_MAX_M BLOB_ESTIMATOR_MAX_MEASUREMENT_LENGTH
+#endif
+
+namespace blob {
+
+/**
+ * Implements generic Square-Root Unscented Kalman Filter (see 
+ * matlab/srukf_predict.m and matlab/srukf_update.m). The lower triangular
+ * Cholesky factor S of state covariance P=S*S' is propagated directly with 
+ * QR triangularization and rank-1 updates, so P is never refactorized.
+ */
+class SRUKF : public Estimator
+{
+  public:
+    /**
+     * Initializes filter parameters and state vector.
+     * \param n      number of states
+     * \param init_x state vector inital value
+     * \param alpha  tunable parameter
+     * \param beta   tunable parameter
+     * \param ki     tunable parameter
+     */
+    SRUKF (uint8_t n=0, real_t* init_x=NULL, real_t alpha=1, real_t beta=2, 
+           real_t ki=0);
+
+    /**
+     * Applies f function to provide a model based prediction of system state.
+     * \param function pointer to f function to be applied during prediction
+     * \param dt       time lapse
+     * \param l        control input vector length
+     * \param u        control input vector
+     * \param sq       state model noise covariance square root (n x n, lower
+     *                 triangular or diagonal)
+     * \return         true if successful, false otherwise
+     * \sa sigmas(), update()
+     */
+    virtual bool predict (estimator_function_t function, const real_t& dt, 
+                          const uint8_t& l, real_t* u, real_t* sq);
+
+    /**
+     * Applies h function to update system state with sensor measurement.
+     * \param function pointer to h function to be applied during sensor update
+     * \param dt  time lapse
+     * \param m   sensor measurement vector length
+     * \param z   sensor measurement vector
+     * \param sr  sensor measurement noise covariance square root (m x m, 
+     *            lower triangular or diagonal)
+     * \return    true if successful, false otherwise
+     * \sa sigmas(), predict()
+     */
+    virtual bool update  (estimator_function_t function, const real_t& dt, 
+                          const uint8_t& m, real_t* z, real_t* sr);
+    /**
+     * Provides pointer to lower triangular covariance square root S.
+     * \return pointer to n x n covariance square root
+     */
+    real_t* getCovarianceSqrt () {return _S;}
+    /**
+     * Provides length of checkpoint: state vector and covariance square root.
+     * \return checkpoint length
+     * \sa checkpoint(), restore()
+     */
+    virtual uint16_t getCheckpointLength () {return _n + _n*_n;}
+    /**
+     * Saves state vector and covariance square root.
+     * \param buffer  destination of getCheckpointLength() elements
+     * \return        true if successful, false otherwise
+     * \sa restore()
+     */
+    virtual bool checkpoint (real_t* buffer);
+    /**
+     * Restores state vector and covariance square root.
+     * \param buffer  checkpoint of getCheckpointLength() elements
+     * \return        true if successful, false otherwise
+     * \sa checkpoint()
+     */
+    virtual bool restore (const real_t* buffer);
+    /**
+     * Outputs internal and state information from filter to standard output.
+     */
+    virtual void print   ();
+
+  protected:
+
+    /**
+     * Calculates sigma points from state vector and covariance square root.
+     * \param x   state vector
+     * \param S   state covariance square root
+     * \param X   state sigma points
+     * \return    true if successful, false otherwise
+     */
+    bool sigmas  (MatrixR& x, MatrixR& S, MatrixR& X);
+    /**
+     * Calculates weighted mean, deviations and covariance square root of 
+     * transformed sigma points: S = cholupdate(qr([sqrt(Wc1)*Us(:,1:2n) Sn]'),
+     * sqrt(|Wc0|)*Us(:,0), sign(Wc0))'.
+     * \param U   transformed sigma points
+     * \param Sn  additive noise covariance square root
+     * \param u   resulting mean
+     * \param Us  resulting deviations
+     * \param S   resulting lower triangular covariance square root
+     * \return    true if successful, false otherwise
+     */
+    bool sqrtCov (MatrixR& U, MatrixR& Sn, MatrixR& u, MatrixR& Us, 
+                  MatrixR& S);
+    
+    real_t _alpha;                  /**< alpha tunable parameter */
+    real_t _ki;                     /**< ki tunable parameter    */
+    real_t _beta;                   /**< beta tunable parameter  */
+    real_t _lambda;                 /**< lambda factor           */
+    real_t _c;                      /**< c scaling factor        */
+    AlignedBuffer<real_t,2*BLOB_SRUKF_MAX_N+1> _wm; /**< weights for means */
+    AlignedBuffer<real_t,2*BLOB_SRUKF_MAX_N+1> _wc; /**< weights for 
+                                                         covariance */
+
+    AlignedBuffer<real_t,BLOB_SRUKF_MAX_N*BLOB_SRUKF_MAX_N> _S; /**< covariance
+                                                   square root (lower) */
+    AlignedBuffer<real_t,(2*BLOB_SRUKF_MAX_N+1)*BLOB_SRUKF_MAX_N> _X; /**< 
+                                                   state sigma points */
+};
+
+}
+
+#endif // B_SRUKF_H 
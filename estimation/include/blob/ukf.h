@@ -34,6 +34,10 @@
 #include <blob/estimator.h>
 #include <blob/matrix.h>
 
+#if defined(__linux__)
+  #include <blob/pool.h>
+#endif
+
 #if !defined(BLOB_UKF_MAX_N)
  #define BLOB_UKF_MAX_N BLOB_ESTIMATOR_MAX_STATE_LENGTH
 #endif
@@ -42,6 +46,10 @@
  #define BLOB_UKF_MAX_M BLOB_ESTIMATOR_MAX_MEASUREMENT_LENGTH
 #endif
 
+#if !defined(BLOB_UKF_POOL_THRESHOLD)
+ #define BLOB_UKF_POOL_THRESHOLD 5 // us per evaluation to evaluate in parallel
+#endif
+
 #if (BLOB_UKF_MAX_N > BLOB_UKF_MAX_M)
  #define BLOB_UKF_MAX_LENGTH BLOB_UKF_MAX_N
 #else
@@ -91,12 +99,153 @@ class UKF : public Estimator
      */
     virtual bool update  (estimator_function_t function, const real_t& dt, 
                           const uint8_t& m, real_t* z, real_t* q);
+    /**
+     * Applies f function to all sigma points at once to provide a model based
+     * prediction of system state.
+     * \param function pointer to batch f function to be applied during 
+     *                 prediction, called once over the 2n+1 sigma points
+     * \param dt       time lapse
+     * \param l        control input vector length
+     * \param u        control input vector
+     * \param r        state model noise covariance matrix
+     * \return         true if successful, false otherwise
+     * \sa sigmas(), ut(), update()
+     */
+    bool predict (estimator_batch_function_t function, const real_t& dt,
+                  const uint8_t& l, real_t* u, real_t* r);
+    /**
+     * Applies h function to all sigma points at once to update system state 
+     * with sensor measurement.
+     * \param function pointer to batch h function to be applied during sensor
+     *                 update, called once over the 2n+1 sigma points
+     * \param dt  time lapse
+     * \param m   sensor measurement vector length
+     * \param z   sensor measurement vector
+     * \param q   sensor measurement noise covariance matrix
+     * \return    true if successful, false otherwise
+     * \sa sigmas(), ut(), predict()
+     */
+    bool update  (estimator_batch_function_t function, const real_t& dt,
+                  const uint8_t& m, real_t* z, real_t* q);
+    /**
+     * Applies h functions of several sensors sampled at the same time to 
+     * update system state with all their measurements at once. Measurements
+     * are stacked and transformed over a single set of sigma points, so 
+     * sigma points and their deviations are calculated once per call instead
+     * of once per sensor.
+     * \param k          number of sensors
+     * \param functions  pointers to h function of each sensor
+     * \param dt         time lapse
+     * \param m          measurement vector length of each sensor
+     * \param z          stacked measurement vectors of all sensors
+     * \param q          pointers to measurement noise covariance matrix of 
+     *                   each sensor
+     * \return           true if successful, false otherwise
+     * \sa update()
+     */
+    bool update  (const uint8_t& k, estimator_function_t* functions, 
+                  const real_t& dt, const uint8_t* m, real_t* z, real_t** q);
+    /**
+     * Registers the matrix product shapes of this filter in the kernel 
+     * auto-tuner, so that Tuner::tune() selects their fastest kernels.
+     * \param m  sensor measurement vector length, 0 for prediction only
+     * \return   true if successful, false otherwise
+     * \sa Tuner
+     */
+    bool registerShapes (uint8_t m=0);
+    /**
+     * Enables sequential scalar updates. Updates whose measurement noise 
+     * covariance is diagonal then condition state on one measurement 
+     * component at a time, with rank-1 covariance updates and no matrix 
+     * inversion; other updates are not affected. Optionally, components whose
+     * innovation exceeds gate standard deviations are rejected.
+     * \param enable  true to enable sequential updates
+     * \param gate    innovation gate in standard deviations, 0 to disable
+     * \sa getRejections()
+     */
+    void setSequential (bool enable, real_t gate=0)
+    {
+      _sequential = enable;
+      _gate = gate;
+    }
+    /**
+     * Provides number of measurement components rejected by the innovation
+     * gate during last update.
+     * \return  number of rejected components
+     * \sa setSequential()
+     */
+    uint8_t getRejections () {return _rejected;}
+#if defined(__linux__)
+    /**
+     * Sets worker pool to evaluate sigma points in parallel, NULL for caller
+     * only. Every transform evaluates the first sigma point on the caller and
+     * fans the remaining 2n out over the pool only if that evaluation took at
+     * least threshold microseconds, so cheap models stay serial. Points are 
+     * reduced afterwards in fixed order, so results do not depend on the 
+     * number of threads.
+     * \param pool       worker pool
+     * \param threshold  minimum evaluation time [us] to use the pool
+     */
+    void setPool (Pool* pool, real_t threshold=BLOB_UKF_POOL_THRESHOLD) 
+    {
+      _pool = pool;
+      _threshold = threshold;
+    }
+#endif
+    /**
+     * Provides length of checkpoint: state vector, covariance matrix, sigma 
+     * points and their deviations, which the first update after a prediction
+     * reuses, and whether they are still valid.
+     * \return checkpoint length
+     * \sa checkpoint(), restore()
+     */
+    virtual uint16_t getCheckpointLength () {return _n + _n*_n + 
+                                                    2*_n*(2*_n+1) + 1;}
+    /**
+     * Saves state vector, covariance matrix and sigma points.
+     * \param buffer  destination of getCheckpointLength() elements
+     * \return        true if successful, false otherwise
+     * \sa restore()
+     */
+    virtual bool checkpoint (real_t* buffer);
+    /**
+     * Restores state vector, covariance matrix and sigma points, so that
+     * estimation resumes exactly as from the point it was saved.
+     * \param buffer  checkpoint of getCheckpointLength() elements
+     * \return        true if successful, false otherwise
+     * \sa checkpoint()
+     */
+    virtual bool restore (const real_t* buffer);
     /**
      * Outputs internal and state information from filter to standard output.
      */
     virtual void print   ();
 
   protected:
+    /**
+     * Defines job to evaluate function over a range of sigma points.
+     */
+    typedef struct
+    {
+      estimator_function_t       function; /**< per point function */
+      estimator_batch_function_t batch;    /**< batch function, or NULL */
+      real_t                     dt;       /**< time lapse */
+      real_t*                    arg;      /**< function input argument */
+      const real_t*              X;        /**< sigma points, n x s */
+      real_t*                    U;        /**< transformed points, l x s */
+      uint8_t                    n;        /**< sigma point length */
+      uint8_t                    l;        /**< transformed point length */
+      uint8_t                    s;        /**< number of sigma points */
+      uint8_t                    first;    /**< first point of chunk 0 */
+      uint8_t                    size;     /**< points per chunk */
+    } ukf_job_t;
+
+    /**
+     * Evaluates function over one chunk of sigma points (see Pool::run()).
+     * \param job    pointer to ukf_job_t
+     * \param chunk  chunk index
+     */
+    static void chunk (void* job, uint32_t chunk);
 
     /**
      * Calculates sigma points from state vector and covariance matrix. 
@@ -105,12 +254,76 @@ class UKF : public Estimator
      * \param X   state sigma points
      * \return    true if successful, false otherwise
      */
-    bool sigmas  (Matrix& x, Matrix& P, Matrix& X);
+    bool sigmas  (MatrixR& x, MatrixR& P, MatrixR& X);
+
+    /**
+     * Predicts state with either per point or batch f function.
+     * \param function pointer to f function, used if batch is NULL
+     * \param batch    pointer to batch f function or NULL
+     * \param dt       time lapse
+     * \param u        control input vector
+     * \param r        state model noise covariance matrix
+     * \return         true if successful, false otherwise
+     * \sa predict()
+     */
+    bool propagate (estimator_function_t function, 
+                    estimator_batch_function_t batch, const real_t& dt, 
+                    real_t* u, real_t* r);
+
+    /**
+     * Updates state with either per point or batch h function.
+     * \param function pointer to h function, used if batch is NULL
+     * \param batch    pointer to batch h function or NULL
+     * \param dt       time lapse
+     * \param arg      function input argument vector
+     * \param m        sensor measurement vector length
+     * \param z        sensor measurement vector
+     * \param q        sensor measurement noise covariance matrix
+     * \return         true if successful, false otherwise
+     * \sa update()
+     */
+    bool correct (estimator_function_t function, 
+                  estimator_batch_function_t batch, const real_t& dt, 
+                  real_t* arg, const uint8_t& m, real_t* z, real_t* q);
+
+    /**
+     * Defines h functions of sensors stacked in a single update.
+     */
+    typedef struct
+    {
+      uint8_t               k;         /**< number of sensors */
+      estimator_function_t* functions; /**< h function of each sensor */
+      const uint8_t*        m;         /**< measurement length of each one */
+    } ukf_stack_t;
+
+    /**
+     * Applies h functions of stacked sensors to a sigma point, writing their
+     * expected measurements one after the other.
+     * \param dt    time lapse
+     * \param arg   pointer to ukf_stack_t
+     * \param x     sigma point
+     * \param res   stacked expected measurements
+     */
+    static void stack (const real_t& dt, real_t* arg, real_t* x, real_t* res);
+
+    /**
+     * Conditions state on measurement components one at a time (diagonal 
+     * measurement noise), updating the joint statistics of the remaining 
+     * components with rank-1 corrections. 
+     * \param z    measurement vector, innovations on return
+     * \param z1   expected measurement vector
+     * \param Pz   expected measurement covariance (noise included)
+     * \param Pxz  state and measurement cross-covariance
+     * \return     true if successful, false otherwise
+     */
+    bool sequential (MatrixR& z, MatrixR& z1, MatrixR& Pz, MatrixR& Pxz);
 
     /**
      * Performs unscented transformation applying function and covariance to 
      * sigma points.
      * \param function pointer to function to be applied during transform
+     * \param batch    pointer to batch function applied instead of function
+     *                 to all sigma points at once, or NULL
      * \param dt       time lapse
      * \param arg      function input argument vector
      * \param X   state sigma points
@@ -122,26 +335,35 @@ class UKF : public Estimator
      * \return    true if successful, false otherwise
      * \sa sigmas()
      */
-    bool ut (estimator_function_t function, const real_t& dt, real_t *arg, 
-             Matrix& X, Matrix& R, Matrix& u, Matrix& Pu, Matrix& U, Matrix& Us);
+    bool ut (estimator_function_t function, estimator_batch_function_t batch,
+             const real_t& dt, real_t *arg, MatrixR& X, MatrixR& R, 
+             MatrixR& u, MatrixR& Pu, MatrixR& U, MatrixR& Us);
     
     real_t _alpha;                  /**< alpha tunable parameter */
     real_t _ki;                     /**< ki tunable parameter    */
     real_t _beta;                   /**< beta tunable parameter  */
     real_t _lambda;                 /**< lambda factor           */
     real_t _c;                      /**< c scaling factor        */
-    real_t _wm[2*BLOB_UKF_MAX_N+1]; /**< weights for means       */
-    real_t _wc[2*BLOB_UKF_MAX_N+1]; /**< weights for covariance  */ 
+    AlignedBuffer<real_t,2*BLOB_UKF_MAX_N+1> _wm; /**< weights for means */
+    AlignedBuffer<real_t,2*BLOB_UKF_MAX_N+1> _wc; /**< weights for covariance*/
 
     bool _updated; /**< indicates if state has already been updated with a 
                         sensor measurement */
+    bool    _sequential; /**< scalar updates if noise is diagonal */
+    real_t  _gate;       /**< innovation gate [std. dev.], 0 if disabled */
+    uint8_t _rejected;   /**< components rejected during last update */
 
-    real_t _P[BLOB_UKF_MAX_N*BLOB_UKF_MAX_N]; /**< covariance matrix */
+    AlignedBuffer<real_t,BLOB_UKF_MAX_N*BLOB_UKF_MAX_N> _P; /**< covariance 
+                                                                 matrix */
 
-    real_t _X [((2*BLOB_UKF_MAX_N+1)*BLOB_UKF_MAX_N)]; /**< state unscented 
-                                                            transformation */
-    real_t _Xs[((2*BLOB_UKF_MAX_N+1)*BLOB_UKF_MAX_N)]; /**< std. dev. unscented 
-                                                            transformation  */ 
+    AlignedBuffer<real_t,(2*BLOB_UKF_MAX_N+1)*BLOB_UKF_MAX_N> _X;  /**< state 
+                                              unscented transformation */
+    AlignedBuffer<real_t,(2*BLOB_UKF_MAX_N+1)*BLOB_UKF_MAX_N> _Xs; /**< std. 
+                                      dev. unscented transformation */
+#if defined(__linux__)
+    Pool*  _pool;       /**< worker pool, or NULL */
+    real_t _threshold;  /**< minimum evaluation time [us] to use the pool */
+#endif
 };
 
 }
@@ -0,0 +1,869 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       ukfbank.h
+ * \brief      interface and implementation of bank of unscented kalman 
+ *             filters processed in lockstep
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_UKFBANK_H
+#define B_UKFBANK_H
+
+#include <blob/estimator.h>
+#include <blob/matrix.h>
+#include <blob/math.h>
+
+#include <stdlib.h>
+
+#if !defined(BLOB_UKFBANK_WIDTH)
+ #define BLOB_UKFBANK_WIDTH 16 // filters per block, processed together
+#endif
+
+namespace blob {
+
+/**
+ * Defines function to predict and update estimations of a block of filters 
+ * at once. Vectors are stored by components: component i of filter w is at 
+ * x[i*stride + w], and arg and result are laid out the same way, so that 
+ * loops over filters vectorize. Input and result never overlap.
+ * \param dt      time lapse
+ * \param arg     control input of every filter, or NULL when updating
+ * \param x       state of every filter (one sigma point each)
+ * \param result  resulting vector of every filter
+ * \param count   number of filters of block
+ * \param stride  distance between consecutive components of a filter
+ */
+typedef void (*bank_function_t)(const real_t& dt, const real_t* arg, 
+                                const real_t* x, real_t* result, 
+                                const uint16_t& count, const uint16_t& stride);
+
+/**
+ * Implements bank of K independent Unscented Kalman Filters sharing the same
+ * N-state model, with sensor measurements of up to M components. Filters are
+ * stored in blocks of W (structure of arrays within every block) and 
+ * predicted and updated together: Cholesky factors, sigma points, model 
+ * evaluations, gains and covariances are calculated for the W filters of a 
+ * block in the innermost loops, and all loops have compile-time trip counts.
+ * Updates take a mask to skip filters without measurement. Filters whose 
+ * update fails numerically keep their previous estimation (see 
+ * getFailures()). Same algorithm as UKF and UKFN.
+ */
+template <int N, int M=N, int W=BLOB_UKFBANK_WIDTH> class UKFBank
+{
+  public:
+    /**
+     * Initializes filter parameters and allocates filters.
+     * \param k      number of filters
+     * \param init_x state vector inital value of all filters
+     * \param alpha  tunable parameter
+     * \param beta   tunable parameter
+     * \param ki     tunable parameter
+     */
+    UKFBank (uint32_t k, real_t* init_x=NULL, real_t alpha=1, real_t beta=2, 
+             real_t ki=0);
+    /**
+     * Releases filters.
+     */
+    ~UKFBank ();
+
+    /**
+     * Applies f function to provide a model based prediction of the state of
+     * all filters.
+     * \param function pointer to f function to be applied during prediction
+     * \param dt       time lapse
+     * \param l        control input vector length
+     * \param u        control input vectors of all filters (K x l), or NULL
+     * \param r        state model noise covariance matrix, shared
+     * \return         true if successful, false otherwise
+     * \sa update()
+     */
+    bool predict (bank_function_t function, const real_t& dt, 
+                  const uint8_t& l, const real_t* u, const real_t* r);
+    /**
+     * Applies h function to update the state of filters with sensor 
+     * measurements.
+     * \param function pointer to h function to be applied during sensor update
+     * \param dt    time lapse
+     * \param m     sensor measurement vector length (up to M)
+     * \param z     sensor measurement vectors of all filters (K x m)
+     * \param q     sensor measurement noise covariance matrix, shared
+     * \param mask  filters to update (K flags, not 0 to update), NULL for all
+     * \return      true if successful, false otherwise (some filters failed)
+     * \sa predict(), getFailures()
+     */
+    bool update  (bank_function_t function, const real_t& dt, 
+                  const uint8_t& m, const real_t* z, const real_t* q, 
+                  const uint8_t* mask=NULL);
+
+    /**
+     * Provides number of filters.
+     * \return number of filters
+     */
+    uint32_t getNumFilters () {return _k;}
+    /**
+     * Provides copy of state vector of filter.
+     * \param k      filter index
+     * \param state  pointer to destination vector (N elements)
+     */
+    void     getState (uint32_t k, real_t* state);
+    /**
+     * Provides indexed element of state vector of filter.
+     * \param k  filter index
+     * \param i  state element index to retrieve
+     * \return   state vector element in ith position
+     */
+    real_t   getState (uint32_t k, uint8_t i) 
+    {
+      return _blocks[k/W].x[i*W + k%W];
+    }
+    /**
+     * Sets state vector of filter.
+     * \param k      filter index
+     * \param state  state vector (N elements)
+     */
+    void     setState (uint32_t k, const real_t* state);
+    /**
+     * Provides copy of covariance matrix of filter.
+     * \param k  filter index
+     * \param P  pointer to destination matrix (N x N)
+     */
+    void     getCovariance (uint32_t k, real_t* P);
+    /**
+     * Sets covariance matrix of filter.
+     * \param k  filter index
+     * \param P  covariance matrix (N x N)
+     */
+    void     setCovariance (uint32_t k, const real_t* P);
+    /**
+     * Provides number of filters whose last update failed numerically.
+     * \return number of failed filters
+     */
+    uint32_t getFailures () {return _failures;}
+
+  protected:
+    enum { S = 2*N+1 /**< number of sigma points */ };
+
+    /**
+     * Filters of a block, by components: element e of filter w at [e*W + w].
+     */
+    typedef struct
+    {
+      AlignedBuffer<real_t,N*W>   x;  /**< state vectors */
+      AlignedBuffer<real_t,N*N*W> P;  /**< covariance matrices */
+      AlignedBuffer<real_t,S*N*W> X;  /**< sigma points, point s component i
+                                           at [(s*N + i)*W + w] */
+      AlignedBuffer<real_t,W>     updated; /**< 1 if updated since last 
+                                                prediction, 0 otherwise */
+    } ukfbank_block_t;
+
+    /**
+     * Calculates sigma points of all filters of block, X = [x x+A x-A] with
+     * A = c*chol(P), falling back to pivoted Cholesky for filters with 
+     * non-positive definite covariance.
+     * \param block  block of filters
+     * \param X      resulting sigma points
+     */
+    void sigmas (ukfbank_block_t& block, real_t* X);
+
+    /**
+     * Calculates rank-revealing Cholesky factors of the positive 
+     * semi-definite part of covariances, as MatrixR::pcholesky() does for a 
+     * single matrix but on all filters of block, every one pivoting on its
+     * own. Only filters flagged bad are written, L(piv(i),:) = A(i,:).
+     * \param P      covariances of block
+     * \param bad    1 for filters to factor, 0 otherwise
+     * \param L      resulting factors, lower triangle of bad filters
+     */
+    void pcholesky (const real_t* P, const real_t* bad, real_t* L);
+
+    uint32_t _k;                    /**< number of filters */
+    uint32_t _nblocks;              /**< number of blocks */
+    void*    _mem;                  /**< allocation of blocks */
+    ukfbank_block_t* _blocks;       /**< aligned blocks */
+    uint32_t _failures;             /**< filters failed in last update */
+
+    real_t _c;                      /**< c scaling factor        */
+    real_t _wm[S];                  /**< weights for means       */
+    real_t _wc[S];                  /**< weights for covariance  */
+
+  private:
+    /**
+     * Not copyable: blocks would be released twice.
+     */
+    UKFBank (const UKFBank &);
+    /**
+     * Not assignable: blocks would be released twice.
+     */
+    UKFBank & operator= (const UKFBank &);
+};
+
+template <int N, int M, int W> 
+UKFBank<N,M,W>::UKFBank (uint32_t k, real_t* init_x, real_t alpha, 
+                         real_t beta, real_t ki)
+{
+  real_t lambda = alpha*alpha*(N + ki) - N;
+  _c = N + lambda;
+  _wc[0] = _wm[0] = lambda/_c; 
+  for(int s=1; s<S; s++)
+    _wc[s] = _wm[s] = 0.5/_c;              // weights for means
+  _wc[0] = _wc[0]+(1-alpha*alpha+beta);    // weights for covariance
+  _c = blob::math::sqrtr(_c);
+  _failures = 0;
+
+  // aligned blocks, last one padded with filters that are never read
+  _k = k;
+  _nblocks = (k + W - 1)/W;
+  _mem = malloc(_nblocks*sizeof(ukfbank_block_t) + BLOB_MATRIX_ALIGNMENT);
+  if(!_mem)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "UKFBank::UKFBank() error: unable to allocate " << k 
+              << " filters" << std::endl;
+#endif
+    _k = 0;
+    _nblocks = 0;
+  }
+  _blocks = (ukfbank_block_t*)(((uintptr_t)_mem + BLOB_MATRIX_ALIGNMENT - 1) &
+                               ~(uintptr_t)(BLOB_MATRIX_ALIGNMENT - 1));
+
+  for(uint32_t b=0; b<_nblocks; b++)
+  {
+    ukfbank_block_t& block = _blocks[b];
+    memset(&block, 0, sizeof(ukfbank_block_t));
+    for(int w=0; w<W; w++)
+    {
+      for(int i=0; i<N; i++)
+      {
+        block.x[i*W + w] = init_x? init_x[i] : 0;
+        block.P[(i*N + i)*W + w] = 1;
+      }
+    }
+  }
+}
+
+template <int N, int M, int W> UKFBank<N,M,W>::~UKFBank ()
+{
+  free(_mem);
+}
+
+template <int N, int M, int W> 
+void UKFBank<N,M,W>::sigmas (ukfbank_block_t& block, real_t* X)
+{
+  BLOB_MATRIX_ALIGNED real_t L[N*N*W];
+  BLOB_MATRIX_ALIGNED real_t inv[W];
+  BLOB_MATRIX_ALIGNED real_t acc[W];
+  BLOB_MATRIX_ALIGNED real_t bad[W];
+  const real_t* P = block.P;
+  const real_t* x = block.x;
+  real_t c = _c; // local copies of members, so that stores cannot alias them
+
+  // L = chol(P) of every filter by columns, lower triangle, dividing by
+  // each diagonal element once. Pivots are not checked on the way: one <= 0
+  // turns every later diagonal element into NaN, so that the last one not
+  // being > 0 flags the filter
+  bool any = false;
+  for(int j=0; j<N; j++)
+  {
+    for(int w=0; w<W; w++)
+      acc[w] = P[(j*N + j)*W + w];
+    for(int k=0; k<j; k++)
+      for(int w=0; w<W; w++)
+        acc[w] -= L[(j*N + k)*W + w]*L[(j*N + k)*W + w];
+    for(int w=0; w<W; w++)
+    {
+      L[(j*N + j)*W + w] = blob::math::sqrtr(acc[w]);
+      inv[w] = 1/L[(j*N + j)*W + w];
+    }
+    for(int i=j+1; i<N; i++)
+    {
+      for(int w=0; w<W; w++)
+        acc[w] = P[(i*N + j)*W + w];
+      for(int k=0; k<j; k++)
+        for(int w=0; w<W; w++)
+          acc[w] -= L[(i*N + k)*W + w]*L[(j*N + k)*W + w];
+      for(int w=0; w<W; w++)
+        L[(i*N + j)*W + w] = acc[w]*inv[w];
+    }
+    for(int i=0; i<j; i++)
+      for(int w=0; w<W; w++)
+        L[(i*N + j)*W + w] = 0;
+  }
+  for(int w=0; w<W; w++)
+  {
+    bad[w] = (L[(N*N - 1)*W + w] > 0)? 0 : 1;
+    any |= (bad[w] != 0);
+  }
+
+  // near-singular or slightly indefinite P: rank-revealing factor of its
+  // positive semi-definite part
+  if(any)
+    pcholesky(P, bad, L);
+
+  // X = [x x+c*L x-c*L]
+  for(int i=0; i<N; i++)
+  {
+    for(int w=0; w<W; w++)
+    {
+      real_t a = x[i*W + w];
+      X[i*W + w] = a;
+      for(int j=0; j<N; j++)
+      {
+        real_t d = c*L[(i*N + j)*W + w];
+        X[((1 + j)*N + i)*W + w]     = a + d;
+        X[((1 + N + j)*N + i)*W + w] = a - d;
+      }
+    }
+  }
+}
+
+template <int N, int M, int W> 
+void UKFBank<N,M,W>::pcholesky (const real_t* P, const real_t* bad,
+                                real_t* L)
+{
+  BLOB_MATRIX_ALIGNED real_t A[N*N*W];
+  BLOB_MATRIX_ALIGNED real_t dots[N*W]; // squared norms of computed L rows
+  BLOB_MATRIX_ALIGNED real_t piv[N*W];  // permutation, as real_t like flags
+  BLOB_MATRIX_ALIGNED real_t rank[W];   // N while factoring, rank once done
+  BLOB_MATRIX_ALIGNED real_t mm[W], q[W], tol[W], swap[W];
+  const real_t eps = (sizeof(real_t) == sizeof(float))? 1.19e-7 : 2.22e-16;
+
+  // symmetric swaps need full matrix
+  for(int i=0; i<N; i++)
+  {
+    for(int j=0; j<=i; j++)
+    {
+      for(int w=0; w<W; w++)
+      {
+        A[(i*N + j)*W + w] = P[(i*N + j)*W + w];
+        A[(j*N + i)*W + w] = P[(i*N + j)*W + w];
+      }
+    }
+    for(int w=0; w<W; w++)
+    {
+      dots[i*W + w] = 0;
+      piv[i*W + w] = i;
+    }
+  }
+  for(int w=0; w<W; w++)
+    rank[w] = N;
+
+  for(int j=0; j<N; j++)
+  {
+    if(j > 0)
+      for(int i=j; i<N; i++)
+        for(int w=0; w<W; w++)
+          dots[i*W + w] += A[(i*N + j-1)*W + w]*A[(i*N + j-1)*W + w];
+
+    // q = argmax{L(i,i)-dots(i)}_i=j:n, stop when remaining part is null
+    for(int w=0; w<W; w++)
+    {
+      mm[w] = A[(j*N + j)*W + w] - dots[j*W + w];
+      q[w] = j;
+    }
+    for(int i=j+1; i<N; i++)
+    {
+      for(int w=0; w<W; w++)
+      {
+        real_t res = A[(i*N + i)*W + w] - dots[i*W + w];
+        q[w] = (res > mm[w])? i : q[w];
+        mm[w] = (res > mm[w])? res : mm[w];
+      }
+    }
+    if(j == 0)
+      for(int w=0; w<W; w++)
+        tol[w] = N*eps*((mm[w] > 0)? mm[w] : 0);
+    for(int w=0; w<W; w++)
+      rank[w] = ((rank[w] == N) && (mm[w] <= tol[w]))? j : rank[w];
+
+    // symmetric swap of j and q, in filters still factoring
+    for(int k=j+1; k<N; k++)
+    {
+      for(int w=0; w<W; w++)
+        swap[w] = ((rank[w] == N) && (q[w] == k))? 1 : 0;
+      for(int i=0; i<N; i++)
+      {
+        for(int w=0; w<W; w++)
+        {
+          real_t a = A[(j*N + i)*W + w], c = A[(k*N + i)*W + w];
+          A[(j*N + i)*W + w] = (swap[w] != 0)? c : a;
+          A[(k*N + i)*W + w] = (swap[w] != 0)? a : c;
+        }
+      }
+      for(int i=0; i<N; i++)
+      {
+        for(int w=0; w<W; w++)
+        {
+          real_t a = A[(i*N + j)*W + w], c = A[(i*N + k)*W + w];
+          A[(i*N + j)*W + w] = (swap[w] != 0)? c : a;
+          A[(i*N + k)*W + w] = (swap[w] != 0)? a : c;
+        }
+      }
+      for(int w=0; w<W; w++)
+      {
+        real_t a = dots[j*W + w], c = dots[k*W + w];
+        dots[j*W + w] = (swap[w] != 0)? c : a;
+        dots[k*W + w] = (swap[w] != 0)? a : c;
+      }
+      for(int w=0; w<W; w++)
+      {
+        real_t a = piv[j*W + w], c = piv[k*W + w];
+        piv[j*W + w] = (swap[w] != 0)? c : a;
+        piv[k*W + w] = (swap[w] != 0)? a : c;
+      }
+    }
+
+    // column j, in filters still factoring
+    for(int w=0; w<W; w++)
+      mm[w] = (mm[w] > 0)? mm[w] : 1;
+    for(int w=0; w<W; w++)
+    {
+      real_t a = A[(j*N + j)*W + w];
+      mm[w] = blob::math::sqrtr(mm[w]);
+      A[(j*N + j)*W + w] = (rank[w] == N)? mm[w] : a;
+    }
+    for(int i=j+1; i<N; i++)
+    {
+      for(int w=0; w<W; w++)
+        swap[w] = A[(i*N + j)*W + w];
+      for(int k=0; k<j; k++)
+        for(int w=0; w<W; w++)
+          swap[w] -= A[(i*N + k)*W + w]*A[(j*N + k)*W + w];
+      for(int w=0; w<W; w++)
+      {
+        real_t a = A[(i*N + j)*W + w];
+        A[(i*N + j)*W + w] = (rank[w] == N)? swap[w]/mm[w] : a;
+      }
+    }
+  }
+
+  // upper triangle and columns from rank on are null, L(piv(i),:) = A(i,:)
+  for(int i=0; i<N; i++)
+    for(int k=0; k<N; k++)
+      for(int w=0; w<W; w++)
+      {
+        real_t a = A[(i*N + k)*W + w];
+        A[(i*N + k)*W + w] = ((k > i) || (k >= rank[w]))? 0 : a;
+      }
+  for(int i=0; i<N; i++)
+    for(int t=0; t<N; t++)
+      for(int k=0; k<N; k++)
+        for(int w=0; w<W; w++)
+        {
+          real_t a = A[(i*N + k)*W + w], l = L[(t*N + k)*W + w];
+          L[(t*N + k)*W + w] = ((bad[w] != 0) & (piv[i*W + w] == t))? a : l;
+        }
+}
+
+template <int N, int M, int W> 
+bool UKFBank<N,M,W>::predict (bank_function_t function, const real_t& dt,
+                              const uint8_t& l, const real_t* u,
+                              const real_t* r)
+{
+  BLOB_MATRIX_ALIGNED real_t ub[BLOB_ESTIMATOR_MAX_LENGTH*W];
+  BLOB_MATRIX_ALIGNED real_t Xs[S*N*W];
+  BLOB_MATRIX_ALIGNED real_t D[S*N*W];
+  BLOB_MATRIX_ALIGNED real_t acc[W];
+
+  // local copies of weights and noise, so that stores cannot alias them.
+  // All points but the first share their weights
+  const real_t wm0 = _wm[0], wm1 = _wm[1], wc0 = _wc[0], wc1 = _wc[1];
+  BLOB_MATRIX_ALIGNED real_t R[N*N];
+  memcpy(R, r, N*N*sizeof(real_t));
+
+  if(l > BLOB_ESTIMATOR_MAX_LENGTH)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "UKFBank::predict() error: " << (int)l << " inputs"
+              << std::endl;
+#endif
+    return false;
+  }
+
+  for(uint32_t b=0; b<_nblocks; b++)
+  {
+    ukfbank_block_t& block = _blocks[b];
+    real_t* x = block.x;
+    real_t* P = block.P;
+    real_t* X = block.X;
+    int count = (_k - b*W < (uint32_t)W)? _k - b*W : W;
+
+    // inputs of block by components
+    if(u)
+    {
+      for(int w=0; w<W; w++)
+        for(int i=0; i<l; i++)
+          ub[i*W + w] = (w < count)? u[(b*W + w)*l + i] : 0;
+    }
+
+    // X(:,s) = f(Xs(:,s),u), sigma points calculated aside
+    sigmas(block, Xs);
+    for(int s=0; s<S; s++)
+      function(dt, u? ub : NULL, &Xs[s*N*W], &X[s*N*W], W, W);
+
+    // x = X*Wm, D = X - x
+    for(int i=0; i<N; i++)
+    {
+      for(int w=0; w<W; w++)
+      {
+        real_t a = X[(N + i)*W + w];
+        for(int s=2; s<S; s++)
+          a += X[(s*N + i)*W + w];
+        a = wm0*X[i*W + w] + wm1*a;
+        for(int s=0; s<S; s++)
+          D[(s*N + i)*W + w] = X[(s*N + i)*W + w] - a;
+        x[i*W + w] = a;
+      }
+    }
+
+    // P = D*diag(Wc)*D' + R
+    for(int i=0; i<N; i++)
+    {
+      for(int j=0; j<=i; j++)
+      {
+        for(int w=0; w<W; w++)
+          acc[w] = D[(N + i)*W + w]*D[(N + j)*W + w];
+        for(int s=2; s<S; s++)
+          for(int w=0; w<W; w++)
+            acc[w] += D[(s*N + i)*W + w]*D[(s*N + j)*W + w];
+        for(int w=0; w<W; w++)
+        {
+          acc[w] = wc0*D[i*W + w]*D[j*W + w] + wc1*acc[w];
+          P[(i*N + j)*W + w] = acc[w] + R[i*N + j];
+          P[(j*N + i)*W + w] = acc[w] + R[j*N + i];
+        }
+      }
+    }
+
+    for(int w=0; w<W; w++)
+      block.updated[w] = 0;
+  }
+
+  return true;
+}
+
+template <int N, int M, int W> 
+bool UKFBank<N,M,W>::update (bank_function_t function, const real_t& dt,
+                             const uint8_t& m, const real_t* z,
+                             const real_t* q, const uint8_t* mask)
+{
+  bool retval = true;
+  BLOB_MATRIX_ALIGNED real_t active[W];
+  BLOB_MATRIX_ALIGNED real_t updated[W];
+  BLOB_MATRIX_ALIGNED real_t bad[W];
+  BLOB_MATRIX_ALIGNED real_t inv[M*W];
+  BLOB_MATRIX_ALIGNED real_t Li[M*M*W];
+  BLOB_MATRIX_ALIGNED real_t Pzi[M*M*W];
+  BLOB_MATRIX_ALIGNED real_t acc[W];
+  BLOB_MATRIX_ALIGNED real_t y[M*W];
+  BLOB_MATRIX_ALIGNED real_t Xn[S*N*W];
+  BLOB_MATRIX_ALIGNED real_t Z[S*M*W];
+  BLOB_MATRIX_ALIGNED real_t Pz[M*M*W];
+  BLOB_MATRIX_ALIGNED real_t Pxz[N*M*W];
+  BLOB_MATRIX_ALIGNED real_t K[N*M*W];
+
+  // local copies of weights and noise, so that stores cannot alias them.
+  // Measurements shorter than M are padded: rows m..M-1 of Z and y are null
+  // and Q is the identity there, so that they add nothing to the update and
+  // every loop runs up to M. All points but the first share their weights
+  const real_t wm0 = _wm[0], wm1 = _wm[1], wc0 = _wc[0], wc1 = _wc[1];
+  BLOB_MATRIX_ALIGNED real_t Q[M*M];
+
+  if(m > M)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "UKFBank::update() error: " << (int)m << " measurements > "
+              << M << std::endl;
+#endif
+    return false;
+  }
+
+  for(int i=0; i<M; i++)
+    for(int j=0; j<M; j++)
+      Q[i*M + j] = ((i < m) && (j < m))? q[i*m + j] : ((i == j)? 1 : 0);
+  for(int s=0; s<S; s++)
+    for(int e=m*W; e<M*W; e++)
+      Z[s*M*W + e] = 0;
+
+  _failures = 0;
+  for(uint32_t b=0; b<_nblocks; b++)
+  {
+    ukfbank_block_t& block = _blocks[b];
+    real_t* x = block.x;
+    real_t* P = block.P;
+    real_t* X = block.X;
+    int count = (_k - b*W < (uint32_t)W)? _k - b*W : W;
+
+    // filters to update and their measurements, skip block if none
+    bool any = false, resample = false, all = true;
+    for(int w=0; w<W; w++)
+    {
+      active[w] = ((w < count) && (!mask || mask[b*W + w]))? 1 : 0;
+      updated[w] = block.updated[w];
+      any |= (active[w] != 0);
+      resample |= (active[w] != 0) && (updated[w] != 0);
+      all &= (updated[w] != 0);
+      bad[w] = 0;
+    }
+    if(!any)
+      continue;
+    for(int w=0; w<W; w++)
+      for(int i=0; i<M; i++)
+        y[i*W + w] = (active[w] && (i < m))? z[(b*W + w)*m + i] : 0;
+
+    // if already updated at least once, re-calculate sigma points around x,
+    // straight into X when every filter of block was
+    if(all)
+      sigmas(block, X);
+    else if(resample)
+    {
+      sigmas(block, Xn);
+      for(int e=0; e<S*N; e++)
+      {
+        for(int w=0; w<W; w++)
+        {
+          real_t a = Xn[e*W + w], o = X[e*W + w];
+          X[e*W + w] = (updated[w] != 0)? a : o;
+        }
+      }
+    }
+
+    // Z(:,s) = h(X(:,s)), z1 = Z*Wm, Z = Z - z1, y = z - z1
+    for(int s=0; s<S; s++)
+      function(dt, NULL, &X[s*N*W], &Z[s*M*W], W, W);
+    for(int i=0; i<M; i++)
+    {
+      for(int w=0; w<W; w++)
+      {
+        real_t a = Z[(M + i)*W + w];
+        for(int s=2; s<S; s++)
+          a += Z[(s*M + i)*W + w];
+        a = wm0*Z[i*W + w] + wm1*a;
+        for(int s=0; s<S; s++)
+          Z[(s*M + i)*W + w] -= a;
+        y[i*W + w] -= a;
+      }
+    }
+
+    // Pz = Z*diag(Wc)*Z' + Q (lower triangle), Pxz = (X - x)*diag(Wc)*Z'
+    for(int i=0; i<M; i++)
+    {
+      for(int w=0; w<W; w++)
+        for(int j=0; j<=i; j++)
+          Pz[(i*M + j)*W + w] = Z[(M + i)*W + w]*Z[(M + j)*W + w];
+      for(int s=2; s<S; s++)
+        for(int w=0; w<W; w++)
+          for(int j=0; j<=i; j++)
+            Pz[(i*M + j)*W + w] += Z[(s*M + i)*W + w]*Z[(s*M + j)*W + w];
+      for(int w=0; w<W; w++)
+        for(int j=0; j<=i; j++)
+          Pz[(i*M + j)*W + w] = wc0*(Z[i*W + w]*Z[j*W + w]) + 
+                                wc1*Pz[(i*M + j)*W + w] + Q[i*M + j];
+    }
+    for(int i=0; i<N; i++)
+    {
+      for(int w=0; w<W; w++)
+      {
+        real_t d = X[(N + i)*W + w] - x[i*W + w];
+        for(int j=0; j<M; j++)
+          Pxz[(i*M + j)*W + w] = d*Z[(M + j)*W + w];
+      }
+      for(int s=2; s<S; s++)
+      {
+        for(int w=0; w<W; w++)
+        {
+          real_t d = X[(s*N + i)*W + w] - x[i*W + w];
+          for(int j=0; j<M; j++)
+            Pxz[(i*M + j)*W + w] += d*Z[(s*M + j)*W + w];
+        }
+      }
+      for(int w=0; w<W; w++)
+      {
+        real_t d = X[i*W + w] - x[i*W + w];
+        for(int j=0; j<M; j++)
+          Pxz[(i*M + j)*W + w] = wc0*(d*Z[j*W + w]) + 
+                                 wc1*Pxz[(i*M + j)*W + w];
+      }
+    }
+
+    // K = Pxz*inv(Pz), with Pz = L*L' factored in place by columns
+    for(int j=0; j<M; j++)
+    {
+      for(int w=0; w<W; w++)
+        acc[w] = Pz[(j*M + j)*W + w];
+      for(int k=0; k<j; k++)
+        for(int w=0; w<W; w++)
+          acc[w] -= Pz[(j*M + k)*W + w]*Pz[(j*M + k)*W + w];
+      for(int w=0; w<W; w++)
+      {
+        bad[w] = (acc[w] > 0)? bad[w] : 1;
+        acc[w] = (acc[w] > 0)? acc[w] : 1;
+      }
+      for(int w=0; w<W; w++)
+      {
+        Pz[(j*M + j)*W + w] = blob::math::sqrtr(acc[w]);
+        inv[j*W + w] = 1/Pz[(j*M + j)*W + w];
+      }
+      for(int i=j+1; i<M; i++)
+      {
+        for(int w=0; w<W; w++)
+          acc[w] = Pz[(i*M + j)*W + w];
+        for(int k=0; k<j; k++)
+          for(int w=0; w<W; w++)
+            acc[w] -= Pz[(i*M + k)*W + w]*Pz[(j*M + k)*W + w];
+        for(int w=0; w<W; w++)
+          Pz[(i*M + j)*W + w] = acc[w]*inv[j*W + w];
+      }
+    }
+
+    // filters updated: active and numerically valid. K of the rest is null,
+    // so that x and P below are left as they are
+    for(int w=0; w<W; w++)
+    {
+      _failures += (active[w] != 0) && (bad[w] != 0);
+      active[w] = (bad[w] != 0)? 0 : active[w];
+      block.updated[w] = (active[w] != 0)? 1 : updated[w];
+    }
+    for(int i=0; i<M; i++)
+      for(int w=0; w<W; w++)
+        inv[i*W + w] *= active[w];
+    // inv(Pz) = inv(L)'*inv(L), inv(L) lower triangular in Li. Null for
+    // filters not updated, since their inv is
+    for(int i=0; i<M; i++)
+    {
+      for(int w=0; w<W; w++)
+        Li[(i*M + i)*W + w] = inv[i*W + w];
+      for(int j=0; j<i; j++)
+      {
+        for(int w=0; w<W; w++)
+          acc[w] = 0;
+        for(int k=j; k<i; k++)
+          for(int w=0; w<W; w++)
+            acc[w] += Pz[(i*M + k)*W + w]*Li[(k*M + j)*W + w];
+        for(int w=0; w<W; w++)
+          Li[(i*M + j)*W + w] = -acc[w]*inv[i*W + w];
+      }
+    }
+    for(int i=0; i<M; i++)
+    {
+      for(int j=0; j<=i; j++)
+      {
+        for(int w=0; w<W; w++)
+          acc[w] = 0;
+        for(int k=i; k<M; k++)
+          for(int w=0; w<W; w++)
+            acc[w] += Li[(k*M + i)*W + w]*Li[(k*M + j)*W + w];
+        for(int w=0; w<W; w++)
+        {
+          Pzi[(i*M + j)*W + w] = acc[w];
+          Pzi[(j*M + i)*W + w] = acc[w];
+        }
+      }
+    }
+    for(int c=0; c<N; c++)
+    {
+      for(int w=0; w<W; w++)
+      {
+        for(int i=0; i<M; i++)
+        {
+          real_t a = 0;
+          for(int j=0; j<M; j++)
+            a += Pxz[(c*M + j)*W + w]*Pzi[(j*M + i)*W + w];
+          K[(c*M + i)*W + w] = a;
+        }
+      }
+    }
+
+    // x = x + K*y
+    for(int i=0; i<N; i++)
+    {
+      for(int w=0; w<W; w++)
+      {
+        real_t a = x[i*W + w];
+        for(int j=0; j<M; j++)
+          a += K[(i*M + j)*W + w]*y[j*W + w];
+        x[i*W + w] = a;
+      }
+    }
+
+    // P = P - K*Pxz', symmetric
+    for(int i=0; i<N; i++)
+    {
+      for(int j=0; j<=i; j++)
+      {
+        for(int w=0; w<W; w++)
+        {
+          real_t a = P[(i*N + j)*W + w];
+          for(int k=0; k<M; k++)
+            a -= K[(i*M + k)*W + w]*Pxz[(j*M + k)*W + w];
+          P[(i*N + j)*W + w] = a;
+          P[(j*N + i)*W + w] = a;
+        }
+      }
+    }
+  }
+
+  retval &= (_failures == 0);
+#if defined(__DEBUG__) & defined(__linux__)
+  if(retval == false)
+    std::cerr << "UKFBank::update() error: " << _failures << " filters"
+              << std::endl;
+#endif
+  return retval;
+}
+
+template <int N, int M, int W> 
+void UKFBank<N,M,W>::getState (uint32_t k, real_t* state)
+{
+  for(int i=0; i<N; i++)
+    state[i] = _blocks[k/W].x[i*W + k%W];
+}
+
+template <int N, int M, int W> 
+void UKFBank<N,M,W>::setState (uint32_t k, const real_t* state)
+{
+  for(int i=0; i<N; i++)
+    _blocks[k/W].x[i*W + k%W] = state[i];
+  _blocks[k/W].updated[k%W] = 1; // sigma points no longer match state
+}
+
+template <int N, int M, int W> 
+void UKFBank<N,M,W>::getCovariance (uint32_t k, real_t* P)
+{
+  for(int e=0; e<N*N; e++)
+    P[e] = _blocks[k/W].P[e*W + k%W];
+}
+
+template <int N, int M, int W> 
+void UKFBank<N,M,W>::setCovariance (uint32_t k, const real_t* P)
+{
+  for(int e=0; e<N*N; e++)
+    _blocks[k/W].P[e*W + k%W] = P[e];
+  _blocks[k/W].updated[k%W] = 1; // sigma points no longer match covariance
+}
+
+}
+
+#endif // B_UKFBANK_H
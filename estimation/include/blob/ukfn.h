@@ -0,0 +1,469 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       ukfn.h
+ * \brief      interface and implementation of unscented kalman filter with 
+ *             dimensions fixed at compile time
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_UKFN_H
+#define B_UKFN_H
+
+#include <blob/estimator.h>
+#include <blob/matrix.h>
+#include <blob/math.h>
+
+namespace blob {
+
+/**
+ * Implements Unscented Kalman Filter with N states and sensor measurements of
+ * up to M components, fixed at compile time. Same algorithm as UKF, but 
+ * storage is sized exactly for N states and loops over states and sigma 
+ * points have compile-time trip counts, so that they can be unrolled and 
+ * vectorized. Intended for small filters and for many filter instances.
+ */
+template <int N, int M=N> class UKFN : public Estimator
+{
+  public:
+    /**
+     * Initializes filter parameters and state vector.
+     * \param init_x state vector inital value
+     * \param alpha  tunable parameter
+     * \param beta   tunable parameter
+     * \param ki     tunable parameter
+     */
+    UKFN (real_t* init_x=NULL, real_t alpha=1, real_t beta=2, real_t ki=0);
+
+    /**
+     * Applies f function to provide a model based prediction of system state.
+     * \param function pointer to f function to be applied during prediction
+     * \param dt       time lapse
+     * \param l        control input vector length
+     * \param u        control input vector
+     * \param r        state model noise covariance matrix
+     * \return         true if successful, false otherwise
+     * \sa sigmas(), update()
+     */
+    virtual bool predict (estimator_function_t function, const real_t& dt, 
+                          const uint8_t& l, real_t* u, real_t* r);
+    /**
+     * Applies h function to update system state with sensor measurement.
+     * \param function pointer to h function to be applied during sensor update
+     * \param dt  time lapse
+     * \param m   sensor measurement vector length (up to M)
+     * \param z   sensor measurement vector, replaced by innovation
+     * \param q   sensor measurement noise covariance matrix
+     * \return    true if successful, false otherwise
+     * \sa sigmas(), predict()
+     */
+    virtual bool update  (estimator_function_t function, const real_t& dt, 
+                          const uint8_t& m, real_t* z, real_t* q);
+    /**
+     * Provides pointer to covariance matrix (N x N).
+     * \return pointer to covariance matrix
+     */
+    real_t*  getCovariance () {return _P;}
+    /**
+     * Provides length of checkpoint: state vector, covariance matrix, sigma 
+     * points and their deviations, and whether they are still valid.
+     * \return checkpoint length
+     * \sa checkpoint(), restore()
+     */
+    virtual uint16_t getCheckpointLength () {return N + N*N + 2*N*S + 1;}
+    /**
+     * Saves state vector, covariance matrix and sigma points.
+     * \param buffer  destination of getCheckpointLength() elements
+     * \return        true if successful, false otherwise
+     * \sa restore()
+     */
+    virtual bool checkpoint (real_t* buffer);
+    /**
+     * Restores state vector, covariance matrix and sigma points.
+     * \param buffer  checkpoint of getCheckpointLength() elements
+     * \return        true if successful, false otherwise
+     * \sa checkpoint()
+     */
+    virtual bool restore (const real_t* buffer);
+    /**
+     * Outputs internal and state information from filter to standard output.
+     */
+    virtual void print   ();
+
+  protected:
+    enum { S = 2*N+1 /**< number of sigma points */ };
+    /**
+     * Checks at compile time that state fits in Estimator state vector.
+     */
+    typedef char state_length_check[(N <= BLOB_ESTIMATOR_MAX_STATE_LENGTH)? 
+                                                                      1 : -1];
+    /**
+     * Calculates sigma points around state vector, X = [x x+A x-A] with 
+     * A = c*chol(P), and their deviations Xs = X - x.
+     * \return  true if successful, false otherwise
+     */
+    bool sigmas ();
+
+    real_t _alpha;                  /**< alpha tunable parameter */
+    real_t _ki;                     /**< ki tunable parameter    */
+    real_t _beta;                   /**< beta tunable parameter  */
+    real_t _lambda;                 /**< lambda factor           */
+    real_t _c;                      /**< c scaling factor        */
+    AlignedBuffer<real_t,S> _wm;    /**< weights for means       */
+    AlignedBuffer<real_t,S> _wc;    /**< weights for covariance  */
+
+    bool _updated; /**< indicates if state has already been updated with a 
+                        sensor measurement since last prediction */
+
+    AlignedBuffer<real_t,N*N> _P;   /**< covariance matrix       */
+    AlignedBuffer<real_t,N*S> _X;   /**< state sigma points, by rows of S */
+    AlignedBuffer<real_t,N*S> _Xs;  /**< deviation of sigma points */
+};
+
+template <int N, int M> 
+UKFN<N,M>::UKFN (real_t* init_x, real_t alpha, real_t beta, real_t ki) : 
+                                                         Estimator (N, init_x)
+{
+  for(int i=0; i<N*N; i++)
+    _P[i] = (i%(N+1) == 0)? 1 : 0;
+  memset(_X, 0, sizeof(_X));
+  memset(_Xs, 0, sizeof(_Xs));
+
+  _alpha = alpha;                          // tunable
+  _ki = ki;                                // tunable
+  _beta = beta;                            // tunable
+  _lambda = _alpha*_alpha*(N + _ki) - N;   // factor
+  _c = N + _lambda;                        // factor
+  _wc[0] = _wm[0] = _lambda/_c; 
+  for(int k=1; k<S; k++)
+    _wc[k] = _wm[k] = 0.5/_c;              // weights for means
+  _wc[0] = _wc[0]+(1-_alpha*_alpha+_beta); // weights for covariance
+  _c = blob::math::sqrtr(_c);
+  _updated = false;
+}
+
+template <int N, int M> bool UKFN<N,M>::sigmas ()
+{
+  BLOB_MATRIX_ALIGNED real_t a[N*N];
+  uint8_t piv[N];
+  for(int i=0; i<N; i++)
+    piv[i] = i;
+
+  // A = chol(P), lower triangle
+  bool positive = true;
+  memcpy(a, _P, N*N*sizeof(real_t));
+  for(int i=0; i<N; i++)
+  {
+    for(int j=0; j<=i; j++)
+    {
+      real_t s = a[i*N + j];
+      for(int k=0; k<j; k++)
+        s -= a[i*N + k]*a[j*N + k];
+      if(i == j)
+      {
+        positive &= (s > 0);
+        a[i*N + i] = blob::math::sqrtr(positive? s : 1);
+      }
+      else
+        a[i*N + j] = s/a[j*N + j];
+    }
+    for(int j=i+1; j<N; j++)
+      a[i*N + j] = 0;
+  }
+  if(!positive)
+  {
+    // near-singular or slightly indefinite P: rank-revealing factor of its
+    // positive semi-definite part, A(piv(i),:) = L(i,:)
+    uint8_t rank = 0;
+    blob::MatrixR A(N,N,a);
+    memcpy(a, _P, N*N*sizeof(real_t));
+    if(!A.pcholesky(piv, &rank))
+    {
+#if defined(__DEBUG__) & defined(__linux__)
+      std::cerr << "UKFN::sigmas() error" << std::endl;
+#endif
+      return false;
+    }
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "UKFN::sigmas() warning: P not positive definite, rank " 
+              << (int)rank << std::endl;
+#endif
+  }
+
+  // X = [x x+c*A x-c*A], Xs = X - x
+  for(int i=0; i<N; i++)
+  {
+    int r = piv[i];
+    _X[r*S] = _x[r];
+    _Xs[r*S] = 0;
+    for(int j=0; j<N; j++)
+    {
+      real_t d = _c*a[i*N + j];
+      _X[r*S + j+1]    = _x[r] + d;
+      _X[r*S + j+1+N]  = _x[r] - d;
+      _Xs[r*S + j+1]   = d;
+      _Xs[r*S + j+1+N] = -d;
+    }
+  }
+  return true;
+}
+
+template <int N, int M> 
+bool UKFN<N,M>::predict (estimator_function_t function, const real_t& dt, 
+                         const uint8_t& l, real_t* u, real_t* r)
+{
+  BLOB_MATRIX_ALIGNED real_t in[N], out[N];
+
+  if(!sigmas())
+    return false;
+
+  // X(:,k) = f(X(:,k),u)
+  for(int k=0; k<S; k++)
+  {
+    for(int i=0; i<N; i++)
+      in[i] = _X[i*S + k];
+    function(dt, u, in, out);
+    for(int i=0; i<N; i++)
+      _X[i*S + k] = out[i];
+  }
+
+  // x = X*Wm, Xs = X - x
+  for(int i=0; i<N; i++)
+  {
+    real_t s = 0;
+    for(int k=0; k<S; k++)
+      s += _wm[k]*_X[i*S + k];
+    _x[i] = s;
+    for(int k=0; k<S; k++)
+      _Xs[i*S + k] = _X[i*S + k] - s;
+  }
+
+  // P = Xs*diag(Wc)*Xs' + R
+  for(int i=0; i<N; i++)
+  {
+    for(int j=0; j<=i; j++)
+    {
+      real_t s = 0;
+      for(int k=0; k<S; k++)
+        s += _wc[k]*_Xs[i*S + k]*_Xs[j*S + k];
+      _P[i*N + j] = s + r[i*N + j];
+      _P[j*N + i] = s + r[j*N + i];
+    }
+  }
+
+  _updated = false;
+  return true;
+}
+
+template <int N, int M> 
+bool UKFN<N,M>::update (estimator_function_t function, const real_t& dt, 
+                        const uint8_t& m, real_t* z, real_t* q)
+{
+  BLOB_MATRIX_ALIGNED real_t in[N], out[M];
+  BLOB_MATRIX_ALIGNED real_t Z[M*S];
+  BLOB_MATRIX_ALIGNED real_t z1[M];
+  BLOB_MATRIX_ALIGNED real_t Pz[M*M];
+  BLOB_MATRIX_ALIGNED real_t Pxz[N*M];
+  BLOB_MATRIX_ALIGNED real_t K[N*M];
+
+  if(m > M)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "UKFN::update() error: " << (int)m << " measurements > " 
+              << M << std::endl;
+#endif
+    return false;
+  }
+
+  // if already updated at least once, re-calculate sigma points around x
+  if(_updated && !sigmas())
+    return false;
+
+  // Z(:,k) = h(X(:,k))
+  for(int k=0; k<S; k++)
+  {
+    for(int i=0; i<N; i++)
+      in[i] = _X[i*S + k];
+    function(dt, NULL, in, out);
+    for(int i=0; i<m; i++)
+      Z[i*S + k] = out[i];
+  }
+
+  // z1 = Z*Wm, Zs = Z - z1 (in place)
+  for(int i=0; i<m; i++)
+  {
+    real_t s = 0;
+    for(int k=0; k<S; k++)
+      s += _wm[k]*Z[i*S + k];
+    z1[i] = s;
+    for(int k=0; k<S; k++)
+      Z[i*S + k] -= s;
+  }
+
+  // Pz = Zs*diag(Wc)*Zs' + Q, Pxz = Xs*diag(Wc)*Zs'
+  for(int i=0; i<m; i++)
+  {
+    for(int j=0; j<=i; j++)
+    {
+      real_t s = 0;
+      for(int k=0; k<S; k++)
+        s += _wc[k]*Z[i*S + k]*Z[j*S + k];
+      Pz[i*m + j] = s + q[i*m + j];
+      Pz[j*m + i] = s + q[j*m + i];
+    }
+  }
+  for(int i=0; i<N; i++)
+  {
+    for(int j=0; j<m; j++)
+    {
+      real_t s = 0;
+      for(int k=0; k<S; k++)
+        s += _wc[k]*_Xs[i*S + k]*Z[j*S + k];
+      Pxz[i*m + j] = s;
+    }
+  }
+
+  // K = Pxz/Pz, with Pz = L*L' factored in place
+  for(int i=0; i<m; i++)
+  {
+    for(int j=0; j<=i; j++)
+    {
+      real_t s = Pz[i*m + j];
+      for(int k=0; k<j; k++)
+        s -= Pz[i*m + k]*Pz[j*m + k];
+      if(i == j)
+      {
+        if(!(s > 0))
+        {
+#if defined(__DEBUG__) & defined(__linux__)
+          std::cerr << "UKFN::update() error: Pz not positive definite" 
+                    << std::endl;
+#endif
+          return false;
+        }
+        Pz[i*m + i] = blob::math::sqrtr(s);
+      }
+      else
+        Pz[i*m + j] = s/Pz[j*m + j];
+    }
+  }
+  for(int c=0; c<N; c++)
+  {
+    // forward solve L*y = Pxz(c,:)'
+    for(int i=0; i<m; i++)
+    {
+      real_t s = Pxz[c*m + i];
+      for(int k=0; k<i; k++)
+        s -= Pz[i*m + k]*K[c*m + k];
+      K[c*m + i] = s/Pz[i*m + i];
+    }
+    // backward solve L'*k = y
+    for(int i=m-1; i>=0; i--)
+    {
+      real_t s = K[c*m + i];
+      for(int k=i+1; k<m; k++)
+        s -= Pz[k*m + i]*K[c*m + k];
+      K[c*m + i] = s/Pz[i*m + i];
+    }
+  }
+
+  // x = x + K*(z - z1)
+  for(int j=0; j<m; j++)
+    z[j] -= z1[j];
+  for(int i=0; i<N; i++)
+  {
+    real_t s = 0;
+    for(int j=0; j<m; j++)
+      s += K[i*m + j]*z[j];
+    _x[i] += s;
+  }
+
+  // P = P - K*Pxz'
+  for(int i=0; i<N; i++)
+  {
+    for(int j=0; j<N; j++)
+    {
+      real_t s = 0;
+      for(int k=0; k<m; k++)
+        s += K[i*m + k]*Pxz[j*m + k];
+      _P[i*N + j] -= s;
+    }
+  }
+
+  _updated = true;
+  return true;
+}
+
+template <int N, int M> bool UKFN<N,M>::checkpoint (real_t* buffer)
+{
+  memcpy(buffer, _x, N*sizeof(real_t));
+  memcpy(&buffer[N], _P, N*N*sizeof(real_t));
+  memcpy(&buffer[N + N*N], _X, N*S*sizeof(real_t));
+  memcpy(&buffer[N + N*N + N*S], _Xs, N*S*sizeof(real_t));
+  buffer[N + N*N + 2*N*S] = _updated? 1 : 0;
+  return true;
+}
+
+template <int N, int M> bool UKFN<N,M>::restore (const real_t* buffer)
+{
+  memcpy(_x, buffer, N*sizeof(real_t));
+  memcpy(_P, &buffer[N], N*N*sizeof(real_t));
+  memcpy(_X, &buffer[N + N*N], N*S*sizeof(real_t));
+  memcpy(_Xs, &buffer[N + N*N + N*S], N*S*sizeof(real_t));
+  _updated = (buffer[N + N*N + 2*N*S] != 0);
+  return true;
+}
+
+template <int N, int M> void UKFN<N,M>::print ()
+{
+  blob::MatrixR x(N,1,_x);
+  blob::MatrixR P(N,N,_P);
+  blob::MatrixR X(N,S,_X);
+  blob::MatrixR Xs(N,S,_Xs);
+  
+#if defined(__linux__)
+  std::cout << "UKFN::x = " << std::endl;
+#endif
+  x.print();
+#if defined(__linux__)
+  std::cout << std::endl << "UKFN::P = " << std::endl;
+#endif
+  P.print();
+#if defined(__linux__)
+  std::cout << std::endl << "UKFN::X = " << std::endl;
+#endif
+  X.print();
+#if defined(__linux__)
+  std::cout << std::endl << "UKFN::Xs = " << std::endl;
+#endif
+  Xs.print();
+#if defined(__linux__)
+  std::cout << std::endl;
+#endif
+}
+
+}
+
+#endif // B_UKFN_H
@@ -65,7 +65,7 @@ bool blob::CF::update  (estimator_function_t function, const real_t& dt,
 {
   bool retval = true;
 
-  real_t e [BLOB_CF_MAX_LENGTH];
+  BLOB_MATRIX_ALIGNED real_t e [BLOB_CF_MAX_LENGTH];
 
   function(dt,NULL,z,e);
 
@@ -78,10 +78,24 @@ bool blob::CF::update  (estimator_function_t function, const real_t& dt,
   return retval;
 }
 
+bool blob::CF::checkpoint (real_t* buffer)
+{
+  memcpy(buffer, _x, _n*sizeof(real_t));
+  memcpy(&buffer[_n], _error, BLOB_CF_MAX_LENGTH*sizeof(real_t));
+  return true;
+}
+
+bool blob::CF::restore (const real_t* buffer)
+{
+  memcpy(_x, buffer, _n*sizeof(real_t));
+  memcpy(_error, &buffer[_n], BLOB_CF_MAX_LENGTH*sizeof(real_t));
+  return true;
+}
+
 void blob::CF::print  ()
 {
-  blob::Matrix x(_n,1,_x);
-  blob::Matrix e(_l,1,_error);
+  blob::MatrixR x(_n,1,_x);
+  blob::MatrixR e(_l,1,_error);
   
 #if defined(__linux__)
   std::cout << "CF::x = " << std::endl;
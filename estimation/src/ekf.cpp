@@ -0,0 +1,251 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       ekf.cpp
+ * \brief      implemention of generic extended kalman filter
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <blob/ekf.h>
+#include <blob/math.h>
+
+#include <float.h>
+
+blob::EKF::EKF (uint8_t n, real_t *init_x) : Estimator (n, init_x)
+{
+  blob::MatrixR P(_n, _n, _P);
+  P.eye();
+}
+
+void blob::EKF::differentiate (estimator_function_t function, const real_t& dt,
+                               real_t* arg, int l, real_t* y, real_t* J)
+{
+  BLOB_MATRIX_ALIGNED real_t x[BLOB_EKF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t yh[BLOB_ESTIMATOR_MAX_LENGTH];
+  const real_t eps = blob::math::using_double()? DBL_EPSILON : FLT_EPSILON;
+  const real_t seps = blob::math::sqrtr(eps);
+
+  memcpy(x, _x, _n*sizeof(real_t));
+  function(dt, arg, x, y);
+
+  // J(:,j) = (f(x + h*e[j]) - f(x))/h, h = sqrt(eps)*max(1,|x[j]|)
+  for(int j=0; j<_n; j++)
+  {
+    real_t xj = x[j];
+    real_t h = seps*((blob::math::rabs(xj) > 1)? blob::math::rabs(xj) : 1);
+    x[j] = xj + h;
+    h = x[j] - xj; // exactly representable step
+    function(dt, arg, x, yh);
+    for(int i=0; i<l; i++)
+      J[i*_n+j] = (yh[i] - y[i])/h;
+    x[j] = xj;
+  }
+}
+
+bool blob::EKF::propagate (real_t* fx, real_t* F_, real_t* q)
+{
+  bool retval = true;
+  BLOB_MATRIX_ALIGNED real_t aux[BLOB_EKF_MAX_N*BLOB_EKF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t ft[BLOB_EKF_MAX_N*BLOB_EKF_MAX_N];
+
+  blob::MatrixR P(_n,_n,_P);
+  blob::MatrixR F(_n,_n,F_);
+  blob::MatrixR Ft(_n,_n,ft);
+  blob::MatrixR Aux(_n,_n,aux);
+  blob::MatrixR Q(_n,_n,q);
+
+  // x = f(x)
+  memcpy(_x, fx, _n*sizeof(real_t));
+
+  {
+    BLOB_COUNT_TAG("ekf.cov");
+    // P = F*P*F' + Q
+    retval &= blob::MatrixR::transpose(F, Ft);
+    retval &= blob::MatrixR::multiply(F, P, Aux);
+    retval &= blob::MatrixR::multiply(Aux, Ft, P);
+    retval &= P.add(Q);
+  }
+
+#if defined(__DEBUG__) & defined(__linux__)
+  if(retval == false)
+    std::cerr << "EKF::predict() error" << std::endl;
+#endif
+
+  return retval;
+}
+
+bool blob::EKF::correct (uint8_t m, real_t* z_, real_t* hx, real_t* H_, 
+                         real_t* r)
+{
+  bool retval = true;
+  BLOB_MATRIX_ALIGNED real_t pht[BLOB_EKF_MAX_N*BLOB_EKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t ht[BLOB_EKF_MAX_N*BLOB_EKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t kt[BLOB_EKF_MAX_M*BLOB_EKF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t s[BLOB_EKF_MAX_M*BLOB_EKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t aux[BLOB_EKF_MAX_N*BLOB_EKF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t ia[BLOB_EKF_MAX_N*BLOB_EKF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t iat[BLOB_EKF_MAX_N*BLOB_EKF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t y[BLOB_EKF_MAX_M];
+
+  blob::MatrixR x(_n,1,_x);
+  blob::MatrixR P(_n,_n,_P);
+  blob::MatrixR H(m,_n,H_);
+  blob::MatrixR Ht(_n,m,ht);
+  blob::MatrixR PHt(_n,m,pht);
+  blob::MatrixR Kt(m,_n,kt);
+  blob::MatrixR S(m,m,s);
+  blob::MatrixR R(m,m,r);
+  blob::MatrixR Y(m,1,y);
+  blob::MatrixR Aux(_n,_n,aux);
+
+  {
+    BLOB_COUNT_TAG("ekf.gain");
+    // S = H*P*H' + R, K' = S\(P*H')'
+    for(int i=0; i<m; i++)
+      for(int j=0; j<_n; j++)
+        Ht(j,i) = H(i,j);
+    retval &= blob::MatrixR::multiply(P, Ht, PHt);
+    retval &= blob::MatrixR::multiply(H, PHt, S);
+    retval &= S.add(R);
+    retval &= S.cholesky();
+    for(int i=0; i<_n; i++)
+      for(int j=0; j<m; j++)
+        Kt(j,i) = PHt(i,j);
+    retval &= S.cholsolve(Kt);
+  }
+  if(retval)
+  {
+    BLOB_COUNT_TAG("ekf.state");
+    // x = x + K*(z - h(x))
+    for(int i=0; i<m; i++)
+      y[i] = z_[i] - hx[i];
+    retval &= blob::MatrixR::gemvT(Kt, Y, x, 1, 1);
+  }
+  if(retval)
+  {
+    BLOB_COUNT_TAG("ekf.cov");
+    // Joseph form, positive semi-definite despite cancellation when R << P:
+    // P = (I - K*H)*P*(I - K*H)' + K*R*K'
+    blob::MatrixR K(_n,m,ht);
+    blob::MatrixR A(_n,_n,ia);
+    blob::MatrixR At(_n,_n,iat);
+    for(int i=0; i<_n; i++)
+      for(int j=0; j<m; j++)
+        K(i,j) = Kt(j,i);
+    retval &= blob::MatrixR::multiply(K, H, A);
+    retval &= A.scale(-1);
+    for(int i=0; i<_n; i++)
+      A(i,i) += 1;
+    retval &= blob::MatrixR::transpose(A, At);
+    retval &= blob::MatrixR::multiply(A, P, Aux);
+    retval &= blob::MatrixR::multiply(Aux, At, P);
+    retval &= blob::MatrixR::multiply(K, R, PHt);
+    retval &= blob::MatrixR::multiply(PHt, Kt, Aux);
+    retval &= P.add(Aux);
+  }
+
+#if defined(__DEBUG__) & defined(__linux__)
+  if(retval == false)
+    std::cerr << "EKF::update() error" << std::endl;
+#endif
+
+  return retval;
+}
+
+bool blob::EKF::predict (estimator_function_t function, const real_t& dt, 
+                         const uint8_t& l, real_t *u, real_t *q)
+{
+  BLOB_MATRIX_ALIGNED real_t fx[BLOB_EKF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t F[BLOB_EKF_MAX_N*BLOB_EKF_MAX_N];
+  differentiate(function, dt, u, _n, fx, F);
+  return propagate(fx, F, q);
+}
+
+bool blob::EKF::update (estimator_function_t function, const real_t& dt, 
+                        const uint8_t& m, real_t *z, real_t *r)
+{
+  BLOB_MATRIX_ALIGNED real_t hx[BLOB_EKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t H[BLOB_EKF_MAX_M*BLOB_EKF_MAX_N];
+  differentiate(function, dt, NULL, m, hx, H);
+  return correct(m, z, hx, H, r);
+}
+
+bool blob::EKF::predict (estimator_function_t function, 
+                         estimator_jacobian_t jacobian, const real_t& dt, 
+                         const uint8_t& l, real_t *u, real_t *q)
+{
+  BLOB_MATRIX_ALIGNED real_t fx[BLOB_EKF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t x[BLOB_EKF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t F[BLOB_EKF_MAX_N*BLOB_EKF_MAX_N];
+  memcpy(x, _x, _n*sizeof(real_t));
+  function(dt, u, x, fx);
+  jacobian(dt, u, x, F);
+  return propagate(fx, F, q);
+}
+
+bool blob::EKF::update (estimator_function_t function, 
+                        estimator_jacobian_t jacobian, const real_t& dt, 
+                        const uint8_t& m, real_t *z, real_t *r)
+{
+  BLOB_MATRIX_ALIGNED real_t hx[BLOB_EKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t x[BLOB_EKF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t H[BLOB_EKF_MAX_M*BLOB_EKF_MAX_N];
+  memcpy(x, _x, _n*sizeof(real_t));
+  function(dt, NULL, x, hx);
+  jacobian(dt, NULL, x, H);
+  return correct(m, z, hx, H, r);
+}
+
+bool blob::EKF::checkpoint (real_t* buffer)
+{
+  memcpy(buffer, _x, _n*sizeof(real_t));
+  memcpy(&buffer[_n], _P, _n*_n*sizeof(real_t));
+  return true;
+}
+
+bool blob::EKF::restore (const real_t* buffer)
+{
+  memcpy(_x, buffer, _n*sizeof(real_t));
+  memcpy(_P, &buffer[_n], _n*_n*sizeof(real_t));
+  return true;
+}
+
+void blob::EKF::print ()
+{
+  blob::MatrixR x(_n,1,_x);
+  blob::MatrixR P(_n,_n,_P);
+
+#if defined(__linux__)
+  std::cout << "EKF::x = " << std::endl;
+#endif
+  x.print();
+#if defined(__linux__)
+  std::cout << std::endl << "EKF::P = " << std::endl;
+#endif
+  P.print();
+#if defined(__linux__)
+  std::cout << std::endl;
+#endif
+}
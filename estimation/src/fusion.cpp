@@ -0,0 +1,263 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       fusion.cpp
+ * \brief      implementation of time-stamped fusion with out-of-sequence 
+ *             updates
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <blob/fusion.h>
+#include <blob/matrix.h>
+
+#include <stdlib.h>
+
+/**
+ * Provides wrap-safe difference between timestamps a - b [us].
+ */
+static inline int32_t elapsed (uint32_t a, uint32_t b)
+{
+  return (int32_t)(a - b);
+}
+
+blob::Fusion::Fusion (Estimator* filter, estimator_function_t f, uint8_t l, 
+                      real_t* q, uint32_t t, uint8_t history, 
+                      uint8_t capacity)
+{
+  _filter = filter;
+  _f = f;
+  _l = l;
+  _q = q;
+  _c = filter? filter->getCheckpointLength() : 0;
+  _nsensors = 0;
+  _history = history? history : 1;
+  _capacity = capacity;
+  _head = 0;
+  _count = 0;
+  _size = 0;
+  _t = t;
+  _replays = 0;
+  _replayed = 0;
+  _dropped = 0;
+
+  // one allocation: checkpoints, inputs, time lapses, queue, timestamps
+  size_t size = sizeof(real_t)*(size_t)_history*(_c + _l + 1) + 
+                sizeof(fusion_measurement_t)*_capacity + 
+                sizeof(uint32_t)*_history;
+  _mem = malloc(size);
+  if(!_mem)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "Fusion::Fusion() error: unable to allocate " << size 
+              << " bytes" << std::endl;
+#endif
+    _history = 0;
+    _capacity = 0;
+  }
+  _checkpoints = (real_t*)_mem;
+  _inputs = _checkpoints + (size_t)_history*_c;
+  _dts = _inputs + (size_t)_history*_l;
+  _queue = (fusion_measurement_t*)(_dts + _history);
+  _times = (uint32_t*)(_queue + _capacity);
+}
+
+blob::Fusion::~Fusion ()
+{
+  free(_mem);
+}
+
+int8_t blob::Fusion::addSensor (estimator_function_t h, uint8_t m, real_t* r,
+                                const real_t& dt)
+{
+  if((_nsensors >= BLOB_FUSION_MAX_SENSORS) || 
+     (m > BLOB_ESTIMATOR_MAX_MEASUREMENT_LENGTH))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "Fusion::addSensor() error: " << (int)_nsensors << "<"
+              << BLOB_FUSION_MAX_SENSORS << "? " << (int)m << "<="
+              << BLOB_ESTIMATOR_MAX_MEASUREMENT_LENGTH << "?" << std::endl;
+#endif
+    return -1;
+  }
+  _sensors[_nsensors].h = h;
+  _sensors[_nsensors].m = m;
+  _sensors[_nsensors].r = r;
+  _sensors[_nsensors].dt = dt;
+  return _nsensors++;
+}
+
+bool blob::Fusion::predict (uint32_t t, const real_t* u)
+{
+  if(!_filter || !_history || (_l > BLOB_ESTIMATOR_MAX_LENGTH))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "Fusion::predict() error: no filter or buffers" << std::endl;
+#endif
+    return false;
+  }
+
+  // forget oldest tick and measurements that can no longer be replayed
+  if(_count == _history)
+  {
+    _head = tick(1);
+    _count--;
+    uint8_t purge = 0;
+    while((purge < _size) && 
+          (elapsed(_queue[purge].t, _times[tick(0)]) < 0))
+      purge++;
+    if(purge)
+    {
+      _size -= purge;
+      memmove(_queue, &_queue[purge], _size*sizeof(fusion_measurement_t));
+    }
+  }
+
+  uint8_t k = tick(_count);
+  _times[k] = t;
+  _dts[k] = (real_t)1e-6*elapsed(t, _t);
+  memcpy(&_inputs[(size_t)k*_l], u, _l*sizeof(real_t));
+
+  BLOB_MATRIX_ALIGNED real_t v[BLOB_ESTIMATOR_MAX_LENGTH];
+  memcpy(v, u, _l*sizeof(real_t));
+  bool result = _filter->predict(_f, _dts[k], _l, v, _q);
+  if(_c)
+    result &= _filter->checkpoint(&_checkpoints[(size_t)k*_c]);
+  _count++;
+  _t = t;
+  return result;
+}
+
+bool blob::Fusion::update (uint8_t sensor, uint32_t t, const real_t* z)
+{
+  if(sensor >= _nsensors)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "Fusion::update() error: unknown sensor " << (int)sensor 
+              << std::endl;
+#endif
+    return false;
+  }
+
+  // nothing to replay yet, or in order: not older than newest tick nor than
+  // any measurement kept, which is kept to replay later ones
+  if(!_count || ((elapsed(t, _t) >= 0) && 
+                 (!_size || (elapsed(t, _queue[_size-1].t) >= 0))))
+  {
+    fusion_measurement_t measurement;
+    measurement.t = t;
+    measurement.sensor = sensor;
+    memcpy(measurement.z, z, _sensors[sensor].m*sizeof(real_t));
+    if(_count)
+      insert(sensor, t, z);
+    return apply(measurement);
+  }
+
+  // late: latest tick not newer than measurement
+  int k = _count - 1;
+  while((k >= 0) && (elapsed(t, _times[tick(k)]) < 0))
+    k--;
+  if((k < 0) || !_c)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "Fusion::update() error: measurement " << elapsed(_t, t) 
+              << " us late dropped" << std::endl;
+#endif
+    _dropped++;
+    return false;
+  }
+
+  if(insert(sensor, t, z) < 0)
+    return false;
+  _replays++;
+  return replay(k);
+}
+
+bool blob::Fusion::apply (const fusion_measurement_t & measurement)
+{
+  const fusion_sensor_t & s = _sensors[measurement.sensor];
+  BLOB_MATRIX_ALIGNED real_t z[BLOB_ESTIMATOR_MAX_MEASUREMENT_LENGTH];
+  memcpy(z, measurement.z, s.m*sizeof(real_t));
+  return _filter->update(s.h, s.dt, s.m, z, s.r);
+}
+
+int blob::Fusion::insert (uint8_t sensor, uint32_t t, const real_t* z)
+{
+  int i = _size;
+  while((i > 0) && (elapsed(t, _queue[i-1].t) < 0))
+    i--;
+
+  // full: drop oldest measurement, which may be the new one
+  if(!_capacity)
+    return -1;
+  if(_size == _capacity)
+  {
+    _dropped++;
+    if(i == 0)
+    {
+#if defined(__DEBUG__) & defined(__linux__)
+      std::cerr << "Fusion::insert() error: queue full" << std::endl;
+#endif
+      return -1;
+    }
+    _size--;
+    i--;
+    memmove(_queue, &_queue[1], _size*sizeof(fusion_measurement_t));
+  }
+
+  memmove(&_queue[i+1], &_queue[i], (_size - i)*sizeof(fusion_measurement_t));
+  _queue[i].t = t;
+  _queue[i].sensor = sensor;
+  memcpy(_queue[i].z, z, _sensors[sensor].m*sizeof(real_t));
+  _size++;
+  return i;
+}
+
+bool blob::Fusion::replay (uint8_t k)
+{
+  bool result = _filter->restore(&_checkpoints[(size_t)tick(k)*_c]);
+
+  // first measurement of tick k
+  uint8_t i = 0;
+  while((i < _size) && (elapsed(_queue[i].t, _times[tick(k)]) < 0))
+    i++;
+
+  BLOB_MATRIX_ALIGNED real_t v[BLOB_ESTIMATOR_MAX_LENGTH];
+  for(uint8_t j = k; j < _count; j++)
+  {
+    uint8_t b = tick(j);
+    if(j > k)
+    {
+      memcpy(v, &_inputs[(size_t)b*_l], _l*sizeof(real_t));
+      result &= _filter->predict(_f, _dts[b], _l, v, _q);
+      result &= _filter->checkpoint(&_checkpoints[(size_t)b*_c]);
+      _replayed++;
+    }
+    // measurements up to next tick
+    while((i < _size) && ((j == _count - 1) || 
+          (elapsed(_queue[i].t, _times[tick(j+1)]) < 0)))
+      result &= apply(_queue[i++]);
+  }
+  return result;
+}
@@ -0,0 +1,458 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       pf.cpp
+ * \brief      implemention of generic particle filter
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <blob/pf.h>
+#include <blob/math.h>
+
+#include <stdlib.h>
+
+/**
+ * Mixes seed, step and chunk index into an independent, non-zero random 
+ * generator state (murmur3 finalizer).
+ */
+static uint32_t pfSeed (uint32_t seed, uint32_t step, uint32_t chunk)
+{
+  uint32_t h = seed ^ (step*0x9E3779B9u) ^ (chunk*0x85EBCA6Bu);
+  h ^= h >> 16; h *= 0x85EBCA6Bu;
+  h ^= h >> 13; h *= 0xC2B2AE35u;
+  h ^= h >> 16;
+  return h? h : 0x6D2B79F5u;
+}
+
+blob::PF::PF (uint8_t n, real_t *init_x, uint32_t np, real_t *init_s, 
+              uint32_t seed) : Estimator (n, init_x)
+{
+  _np = np;
+  _nchunks = (np + BLOB_PF_CHUNK - 1)/BLOB_PF_CHUNK;
+  _seed = seed? seed : 1;
+  _step = 0;
+  _resamplings = 0;
+  _scheme = PF_SYSTEMATIC;
+  _threshold = BLOB_PF_ESS_THRESHOLD;
+  _ess = np;
+#if defined(__linux__)
+  _pool = NULL;
+#endif
+
+  // one allocation: particles, scratch, weights, likelihoods, indexes, sums
+  size_t size = sizeof(real_t)*(2*(size_t)_n*np + 2*(size_t)np + 
+                                (size_t)_nchunks*(_n + 3)) + 
+                sizeof(uint32_t)*np;
+  _mem = malloc(size);
+  if(!_mem)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "PF::PF() error: unable to allocate " << np << " particles"
+              << std::endl;
+#endif
+    _np = 0;
+    _nchunks = 0;
+  }
+  _p = (real_t*)_mem;
+  _q = _p + (size_t)_n*_np;
+  _w = _q + (size_t)_n*_np;
+  _l = _w + _np;
+  _sums = _l + _np;
+  _idx = (uint32_t*)(_sums + (size_t)_nchunks*(_n + 3));
+
+  for(int i=0; i<_n; i++)
+    _rows[i] = _p + (size_t)i*_np;
+
+  // particles around init_x
+  BLOB_MATRIX_ALIGNED real_t e[BLOB_PF_MAX_N];
+  uint32_t s = pfSeed(_seed, 0xFFFFFFFFu, 0);
+  for(uint32_t k=0; k<_np; k++)
+  {
+    if(init_s)
+      gaussian(&s, e, _n);
+    for(int i=0; i<_n; i++)
+      _rows[i][k] = (init_x? init_x[i] : 0) + (init_s? init_s[i]*e[i] : 0);
+    _w[k] = (real_t)1/_np;
+  }
+  memset(_P, 0, sizeof(_P));
+}
+
+blob::PF::~PF ()
+{
+  free(_mem);
+}
+
+void blob::PF::gaussian (uint32_t* seed, real_t* g, int n)
+{
+  for(int i=0; i<n; i+=2)
+  {
+    // u1 in (0,1] to keep log finite
+    real_t u1 = 1 - uniform(seed);
+    real_t u2 = uniform(seed);
+    real_t r = blob::math::sqrtr(-2*blob::math::log(u1));
+    real_t a = 2*blob::pi*u2;
+    g[i] = r*blob::math::cos(a);
+    if(i+1 < n)
+      g[i+1] = r*blob::math::sin(a);
+  }
+}
+
+void blob::PF::setResampling (pf_resampling_t scheme, real_t threshold)
+{
+  _scheme = scheme;
+  _threshold = threshold;
+}
+
+void blob::PF::chunk (void* arg, uint32_t c)
+{
+  pf_job_t* job = (pf_job_t*)arg;
+  blob::PF* pf = job->pf;
+  int n = pf->_n;
+  uint32_t begin = c*BLOB_PF_CHUNK;
+  uint32_t end = (begin + BLOB_PF_CHUNK < pf->_np)? begin + BLOB_PF_CHUNK : 
+                                                    pf->_np;
+  uint32_t seed = pfSeed(pf->_seed, pf->_step, c);
+  real_t* const* x = pf->_rows;
+  real_t* w = pf->_w;
+  real_t* l = pf->_l;
+  real_t* sums = &pf->_sums[c*(n + 3)];
+
+  BLOB_MATRIX_ALIGNED real_t in[BLOB_PF_MAX_N], out[BLOB_PF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t e[BLOB_PF_MAX_N];
+
+  switch(job->stage)
+  {
+    case PF_PROPAGATE:
+      if(job->f)
+      {
+        job->f(job->dt, job->arg, x, begin, end, &seed, NULL);
+        break;
+      }
+      for(uint32_t k=begin; k<end; k++)
+      {
+        // x = f(x) + L*e, e ~ N(0,I)
+        for(int i=0; i<n; i++)
+          in[i] = x[i][k];
+        job->g(job->dt, job->arg, in, out);
+        if(job->L)
+        {
+          gaussian(&seed, e, n);
+          for(int i=0; i<n; i++)
+            out[job->piv[i]] += blob::MatrixR::dot(&job->L[i*n], 1, e, 1, i+1);
+        }
+        for(int i=0; i<n; i++)
+          x[i][k] = out[i];
+      }
+      break;
+
+    case PF_LIKELIHOOD:
+    {
+      if(job->f)
+        job->f(job->dt, job->arg, x, begin, end, &seed, l);
+      else
+      {
+        int m = job->m;
+        for(uint32_t k=begin; k<end; k++)
+        {
+          // l = -0.5*(z-h(x))'*inv(R)*(z-h(x)), with L*y = z-h(x)
+          for(int i=0; i<n; i++)
+            in[i] = x[i][k];
+          job->g(job->dt, NULL, in, out);
+          real_t d = 0;
+          for(int i=0; i<m; i++)
+          {
+            e[i] = (job->arg[i] - out[i] - 
+                    blob::MatrixR::dot(&job->L[i*m], 1, e, 1, i))/job->L[i*m+i];
+            d += e[i]*e[i];
+          }
+          l[k] = -0.5f*d;
+        }
+      }
+      real_t max = l[begin];
+      for(uint32_t k=begin+1; k<end; k++)
+        if(l[k] > max) 
+          max = l[k];
+      sums[2] = max;
+      return;
+    }
+
+    case PF_WEIGHT:
+      for(uint32_t k=begin; k<end; k++)
+        w[k] *= blob::math::exp(l[k] - job->max);
+      break;
+  }
+
+  // partial sum(w), sum(w^2) and sum(w*x) of chunk
+  int len = end - begin;
+  sums[0] = 0;
+  for(uint32_t k=begin; k<end; k++)
+    sums[0] += w[k];
+  sums[1] = blob::MatrixR::dot(&w[begin], 1, &w[begin], 1, len);
+  for(int i=0; i<n; i++)
+    sums[3+i] = blob::MatrixR::dot(&x[i][begin], 1, &w[begin], 1, len);
+}
+
+bool blob::PF::run (pf_job_t& job)
+{
+  if(!_mem)
+    return false;
+
+  job.pf = this;
+#if defined(__linux__)
+  if(_pool)
+    return _pool->run(chunk, &job, _nchunks);
+#endif
+  for(uint32_t c=0; c<_nchunks; c++)
+    chunk(&job, c);
+  return true;
+}
+
+bool blob::PF::reduce ()
+{
+  int n = _n;
+  real_t sw = 0, sw2 = 0;
+  BLOB_MATRIX_ALIGNED real_t sx[BLOB_PF_MAX_N];
+  memset(sx, 0, sizeof(sx));
+
+  // reduction in chunk order, independent of thread scheduling
+  for(uint32_t c=0; c<_nchunks; c++)
+  {
+    real_t* sums = &_sums[c*(n + 3)];
+    sw += sums[0];
+    sw2 += sums[1];
+    for(int i=0; i<n; i++)
+      sx[i] += sums[3+i];
+  }
+
+  if(!(sw > 0))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "PF::reduce() error: weights sum " << sw << std::endl;
+#endif
+    return false;
+  }
+
+  real_t iw = 1/sw;
+  for(int i=0; i<n; i++)
+    _x[i] = sx[i]*iw;
+  for(uint32_t k=0; k<_np; k++)
+    _w[k] *= iw;
+  _ess = sw*sw/sw2;
+
+  return true;
+}
+
+bool blob::PF::propagate (pf_job_t& job)
+{
+  bool retval = true;
+  job.stage = PF_PROPAGATE;
+  retval &= run(job);
+  retval &= reduce();
+  _step++;
+
+#if defined(__DEBUG__) & defined(__linux__)
+  if(retval == false)
+    std::cerr << "PF::predict() error" << std::endl;
+#endif
+
+  return retval;
+}
+
+bool blob::PF::weight (pf_job_t& job)
+{
+  bool retval = true;
+
+  job.stage = PF_LIKELIHOOD;
+  retval &= run(job);
+
+  // maximum log likelihood, so that the best particle gets exp(0) = 1
+  job.max = _sums[2];
+  for(uint32_t c=1; c<_nchunks; c++)
+    if(_sums[c*(_n + 3) + 2] > job.max)
+      job.max = _sums[c*(_n + 3) + 2];
+
+  job.stage = PF_WEIGHT;
+  retval &= (job.max == job.max) && run(job); // NaN likelihoods
+  retval &= reduce();
+  _step++;
+
+  if(retval && (_ess < _threshold*_np))
+    retval &= resample();
+
+#if defined(__DEBUG__) & defined(__linux__)
+  if(retval == false)
+    std::cerr << "PF::update() error" << std::endl;
+#endif
+
+  return retval;
+}
+
+bool blob::PF::predict (estimator_function_t function, const real_t& dt, 
+                        const uint8_t& l, real_t *u, real_t *q)
+{
+  BLOB_MATRIX_ALIGNED real_t L[BLOB_PF_MAX_N*BLOB_PF_MAX_N];
+  uint8_t piv[BLOB_PF_MAX_N];
+  pf_job_t job;
+  job.f = NULL;
+  job.g = function;
+  job.dt = dt;
+  job.arg = u;
+  job.m = 0;
+  job.L = NULL;
+  job.piv = piv;
+
+  for(int i=0; i<_n; i++)
+    piv[i] = i;
+
+  if(q)
+  {
+    // L*L' = Q, pivoted if Q is only semi-definite (e.g. noise on some 
+    // states only)
+    blob::MatrixR Lq(_n,_n,L);
+    blob::MatrixR Q(_n,_n,q);
+    bool retval = Lq.copy(Q);
+    if(!Lq.cholesky())
+      retval &= Lq.copy(Q) && Lq.pcholesky(piv);
+    if(!retval)
+      return false;
+    job.L = L;
+  }
+  return propagate(job);
+}
+
+bool blob::PF::update (estimator_function_t function, const real_t& dt, 
+                       const uint8_t& m, real_t *z, real_t *r)
+{
+  BLOB_MATRIX_ALIGNED real_t L[BLOB_PF_MAX_M*BLOB_PF_MAX_M];
+  pf_job_t job;
+  job.f = NULL;
+  job.g = function;
+  job.dt = dt;
+  job.arg = z;
+  job.m = m;
+  job.L = L;
+  job.piv = NULL;
+
+  // L*L' = R
+  blob::MatrixR Lr(m,m,L);
+  blob::MatrixR R(m,m,r);
+  if(!(Lr.copy(R) && Lr.cholesky()))
+    return false;
+
+  return weight(job);
+}
+
+bool blob::PF::predict (pf_function_t function, const real_t& dt, real_t *u)
+{
+  pf_job_t job;
+  job.f = function;
+  job.g = NULL;
+  job.dt = dt;
+  job.arg = u;
+  job.m = 0;
+  job.L = NULL;
+  job.piv = NULL;
+  return propagate(job);
+}
+
+bool blob::PF::update (pf_function_t function, const real_t& dt, real_t *z)
+{
+  pf_job_t job;
+  job.f = function;
+  job.g = NULL;
+  job.dt = dt;
+  job.arg = z;
+  job.m = 0;
+  job.L = NULL;
+  job.piv = NULL;
+  return weight(job);
+}
+
+bool blob::PF::resample ()
+{
+  if(!_mem)
+    return false;
+
+  // walk cumulative weights with sorted uniform samples (u+k)/N
+  uint32_t s = pfSeed(_seed, _step, 0xFFFFFFFFu);
+  real_t step = (real_t)1/_np;
+  real_t u0 = uniform(&s);
+  real_t c = _w[0];
+  uint32_t j = 0;
+  for(uint32_t k=0; k<_np; k++)
+  {
+    real_t u = (k + ((_scheme == PF_STRATIFIED)? uniform(&s) : u0))*step;
+    while((u > c) && (j < _np-1))
+      c += _w[++j];
+    _idx[k] = j;
+  }
+
+  // gather state rows into scratch and swap
+  for(int i=0; i<_n; i++)
+  {
+    real_t* src = _rows[i];
+    real_t* dst = _q + (size_t)i*_np;
+    for(uint32_t k=0; k<_np; k++)
+      dst[k] = src[_idx[k]];
+  }
+  real_t* aux = _p;
+  _p = _q;
+  _q = aux;
+  for(int i=0; i<_n; i++)
+    _rows[i] = _p + (size_t)i*_np;
+  for(uint32_t k=0; k<_np; k++)
+    _w[k] = step;
+  _ess = _np;
+  _resamplings++;
+
+  return true;
+}
+
+real_t* blob::PF::getCovariance ()
+{
+  // P = sum(w*(x-mu)*(x-mu)'), deviations into resampling scratch and 
+  // weighted deviations into likelihoods, only used within update()
+  if(_mem)
+    blob::MatrixR::weightedCov(_p, _n, _np, _w, _x, _P, _q, _l);
+  return _P;
+}
+
+void blob::PF::print ()
+{
+  blob::MatrixR x(_n,1,_x);
+  blob::MatrixR P(_n,_n,getCovariance());
+
+#if defined(__linux__)
+  std::cout << "PF::x = " << std::endl;
+#endif
+  x.print();
+#if defined(__linux__)
+  std::cout << std::endl << "PF::P = " << std::endl;
+#endif
+  P.print();
+#if defined(__linux__)
+  std::cout << std::endl << "PF::ess = " << _ess << "/" << _np << std::endl;
+#endif
+}
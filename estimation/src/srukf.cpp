@@ -0,0 +1,284 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       srukf.cpp
+ * \brief      implemention of generic square-root unscented kalman filter
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <blob/srukf.h>
+#include <blob/math.h>
+
+blob::SRUKF::SRUKF (uint8_t n, real_t *init_x, real_t alpha, real_t beta, 
+                    real_t ki) : Estimator (n, init_x)
+{
+  blob::MatrixR S(_n, _n, _S);
+  S.eye();
+  memset(_X, 0, sizeof(_X));
+
+  _alpha = alpha;                          // tunable
+  _ki = ki;                                // tunable
+  _beta = beta;                            // tunable
+  _lambda = _alpha*_alpha*(_n + _ki) - _n; // factor
+  _c = _n + _lambda;                       // factor
+  _wc[0] = _wm[0] = _lambda/_c; 
+  
+  for(int i = 1; i<2*_n+1; i++)
+    _wc[i] = _wm[i] = 0.5/_c;              // weights for means
+
+  _wc[0] = _wc[0]+(1-_alpha*_alpha+_beta); // weights for covariance
+
+  _c = blob::math::sqrtr(_c);
+}
+
+bool blob::SRUKF::sigmas (blob::MatrixR &x, blob::MatrixR &S, blob::MatrixR &X)
+{
+  BLOB_COUNT_TAG("sr.sigmas");
+  // X = [x Y+c*S Y-c*S], Y = x(:,ones(1,L));
+  BLOB_COUNT("sigmas", 3*_n*_n, sizeof(real_t)*(_n + _n*_n + _n*(2*_n+1)));
+  for(int i=0; i<_n; i++)
+  {
+    X(i,0) = x[i];
+    for(int j=0; j<_n; j++)
+    {
+      real_t a = _c*S(i,j);
+      X(i,j+1)    = x[i] + a;
+      X(i,j+1+_n) = x[i] - a;
+    }
+  }
+  return true;
+}
+
+bool blob::SRUKF::sqrtCov (blob::MatrixR& U, blob::MatrixR& Sn, 
+                           blob::MatrixR& u, blob::MatrixR& Us, 
+                           blob::MatrixR& S)
+{
+  bool retval = true;
+  int l = u.nrows();
+  int N = 2*_n+1;
+  BLOB_COUNT_TAG("sr.cov");
+
+  blob::MatrixR wm(N,1,_wm);
+  retval &= blob::MatrixR::weightedMean(U, wm, u);
+
+  // compound matrix A = [sqrt(Wc1)*Us(:,1:2n) Sn]' ((2n+l) x l)
+  BLOB_MATRIX_ALIGNED real_t a[(2*BLOB_SRUKF_MAX_N + BLOB_ESTIMATOR_MAX_LENGTH)
+                               *BLOB_ESTIMATOR_MAX_LENGTH];
+  BLOB_MATRIX_ALIGNED real_t r[BLOB_ESTIMATOR_MAX_LENGTH
+                               *BLOB_ESTIMATOR_MAX_LENGTH];
+  blob::MatrixR A(2*_n+l, l, a);
+  blob::MatrixR R(l, l, r);
+  real_t w1 = blob::math::sqrtr(blob::math::rabs(_wc[1]));
+  BLOB_COUNT("deviation", 2*l*N, sizeof(real_t)*(2*l*N + l*(2*_n+l)));
+  for(int i=0; i<l; i++)
+  {
+    for(int k=0; k<N; k++)
+      Us(i,k) = U(i,k) - u[i];
+    for(int k=1; k<N; k++)
+      a[(k-1)*l + i] = w1*Us(i,k);
+    for(int j=0; j<l; j++)
+      a[(2*_n+j)*l + i] = Sn(i,j);
+  }
+
+  // S = qr(A)', lower triangular
+  retval &= blob::MatrixR::qr(A, R);
+  retval &= blob::MatrixR::transpose(R, S);
+
+  // S = cholupdate(S, sqrt(|Wc0|)*Us(:,0), sign(Wc0))
+  BLOB_MATRIX_ALIGNED real_t v[BLOB_ESTIMATOR_MAX_LENGTH];
+  blob::MatrixR V(l, 1, v);
+  real_t w0 = blob::math::sqrtr(blob::math::rabs(_wc[0]));
+  for(int i=0; i<l; i++)
+    v[i] = w0*Us(i,0);
+  retval &= S.cholupdate(V, (_wc[0] < 0)? -1:1);
+
+  return retval;
+}
+
+bool blob::SRUKF::predict (estimator_function_t function, const real_t& dt, 
+                           const uint8_t& l, real_t *u, real_t *sq)
+{
+  bool retval = true;
+  BLOB_MATRIX_ALIGNED real_t in[BLOB_SRUKF_MAX_N], out[BLOB_SRUKF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t xs[(2*BLOB_SRUKF_MAX_N+1)*BLOB_SRUKF_MAX_N];
+
+  blob::MatrixR Sq(_n,_n,sq);
+  blob::MatrixR x(_n,1,_x);
+  blob::MatrixR S(_n,_n,_S);
+  blob::MatrixR X(_n,2*_n+1,_X);
+  blob::MatrixR Xs(_n,2*_n+1,xs);
+
+  // sigma points around x, X1(:,i) = f(X(:,i),fargs)
+  retval &= sigmas(x, S, X);
+  for(int k=0; k<2*_n+1; k++)
+  {
+    for(int i=0; i<_n; i++)
+      in[i] = X(i,k);
+    function(dt, u, in, out);
+    for(int i=0; i<_n; i++)
+      X(i,k) = out[i];
+  }
+  retval &= sqrtCov(X, Sq, x, Xs, S);
+
+#if defined(__DEBUG__) & defined(__linux__)
+  if(retval == false)
+    std::cerr << "SRUKF::predict() error" << std::endl;
+#endif
+
+  return retval;
+}
+
+bool blob::SRUKF::update  (estimator_function_t function, const real_t& dt,
+                           const uint8_t& m, real_t *z_, real_t *sr)
+{
+  bool retval = true;
+  int N = 2*_n+1;
+
+  BLOB_MATRIX_ALIGNED real_t in[BLOB_SRUKF_MAX_N], out[BLOB_SRUKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t xs[(2*BLOB_SRUKF_MAX_N+1)*BLOB_SRUKF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t z1_  [BLOB_SRUKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t sz_  [BLOB_SRUKF_MAX_M*BLOB_SRUKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t Z1_  [(2*BLOB_SRUKF_MAX_N+1)*BLOB_SRUKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t Z1s_ [(2*BLOB_SRUKF_MAX_N+1)*BLOB_SRUKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t pzx [BLOB_SRUKF_MAX_M*BLOB_SRUKF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t k [BLOB_SRUKF_MAX_N*BLOB_SRUKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t uk [BLOB_SRUKF_MAX_N*BLOB_SRUKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t v [BLOB_SRUKF_MAX_N];
+
+  if(m > BLOB_SRUKF_MAX_M)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "SRUKF::update() error: " << (int)m << " measurements > " 
+              << BLOB_SRUKF_MAX_M << std::endl;
+#endif
+    return false;
+  }
+
+  blob::MatrixR Sr(m,m,sr);
+  blob::MatrixR z(m,1,z_);
+  blob::MatrixR z1(m,1,z1_);
+  blob::MatrixR Sz(m,m,sz_);
+  blob::MatrixR Z1(m,N,Z1_);
+  blob::MatrixR Z1s(m,N,Z1s_);
+
+  blob::MatrixR x(_n,1,_x);
+  blob::MatrixR S(_n,_n,_S);
+  blob::MatrixR X(_n,N,_X);
+  blob::MatrixR Xs(_n,N,xs);
+  blob::MatrixR wc(N,1,_wc);
+
+  // prior sigma points around x and their deviation
+  retval &= sigmas(x, S, X);
+  for(int i=0; i<_n; i++)
+    for(int j=0; j<N; j++)
+      Xs(i,j) = X(i,j) - x[i];
+
+  // Z1(:,i) = h(X1(:,i),hargs), measurement mean and covariance square root
+  for(int c=0; c<N; c++)
+  {
+    for(int i=0; i<_n; i++)
+      in[i] = X(i,c);
+    function(dt, NULL, in, out);
+    for(int i=0; i<m; i++)
+      Z1(i,c) = out[i];
+  }
+  retval &= sqrtCov(Z1, Sr, z1, Z1s, Sz);
+
+  blob::MatrixR Pzx (m,_n,pzx);
+  blob::MatrixR K (_n,m,k);
+  blob::MatrixR U (_n,m,uk);
+  {
+    BLOB_COUNT_TAG("sr.gain");
+    // Pxz = X1s*diag(Wc)*Z1s', K = (Pxz/Sz')/Sz, i.e. Sz*Sz'*K' = Pxz'
+    retval &= blob::MatrixR::weightedCross(Z1s, Xs, wc, Pzx);
+    retval &= Sz.cholsolve(Pzx);
+    for(int i=0; i<_n; i++)
+      for(int j=0; j<m; j++)
+        K(i,j) = Pzx(j,i);
+    // U = K*Sz
+    retval &= blob::MatrixR::multiply(K, Sz, U);
+  }
+  {
+    BLOB_COUNT_TAG("sr.state");
+    // x = x + K*(z - z1)
+    retval &= z.substract(z1);
+    retval &= blob::MatrixR::gemv(K, z, x, 1, 1);
+  }
+  {
+    BLOB_COUNT_TAG("sr.cov");
+    // S = cholupdate(S, U(:,i), '-') for each column of U
+    blob::MatrixR V(_n,1,v);
+    for(int j=0; j<m && retval; j++)
+    {
+      for(int i=0; i<_n; i++)
+        v[i] = U(i,j);
+      retval &= S.cholupdate(V, -1);
+    }
+  }
+
+#if defined(__DEBUG__) & defined(__linux__)
+  if(retval == false)
+    std::cerr << "SRUKF::update() error" << std::endl;
+#endif
+
+  return retval;
+}
+
+bool blob::SRUKF::checkpoint (real_t* buffer)
+{
+  memcpy(buffer, _x, _n*sizeof(real_t));
+  memcpy(&buffer[_n], _S, _n*_n*sizeof(real_t));
+  return true;
+}
+
+bool blob::SRUKF::restore (const real_t* buffer)
+{
+  memcpy(_x, buffer, _n*sizeof(real_t));
+  memcpy(_S, &buffer[_n], _n*_n*sizeof(real_t));
+  return true;
+}
+
+void blob::SRUKF::print ()
+{
+  blob::MatrixR x(_n,1,_x);
+  blob::MatrixR S(_n,_n,_S);
+  blob::MatrixR X(_n,2*_n+1,_X);
+
+#if defined(__linux__)
+  std::cout << "SRUKF::x = " << std::endl;
+#endif
+  x.print();
+#if defined(__linux__)
+  std::cout << std::endl << "SRUKF::S = " << std::endl;
+#endif
+  S.print();
+#if defined(__linux__)
+  std::cout << std::endl << "SRUKF::X = " << std::endl;
+#endif
+  X.print();
+#if defined(__linux__)
+  std::cout << std::endl;
+#endif
+}
@@ -30,11 +30,16 @@
 
 #include <blob/ukf.h>
 #include <blob/math.h>
+#include <blob/tuner.h>
+
+#if defined(__linux__)
+  #include <time.h>
+#endif
 
 blob::UKF::UKF (uint8_t n, real_t *init_x, real_t alpha, real_t beta, real_t ki) : Estimator (n, init_x)
 {
 
-  blob::Matrix P(_n, _n, _P);
+  blob::MatrixR P(_n, _n, _P);
   P.eye();
   memset(_X, 0, sizeof(_X));
   memset(_Xs, 0, sizeof(_Xs));
@@ -51,31 +56,88 @@ blob::UKF::UKF (uint8_t n, real_t *init_x, real_t alpha, real_t beta, real_t ki)
 
   _wc[0] = _wc[0]+(1-_alpha*_alpha+_beta); // weights for covariance
 
-  _c = blob::math::sqrt(_c);
+  _c = blob::math::sqrtr(_c);
 #if defined(__DEBUG__) & defined(__linux__)
         std::cout << "[test] - created UKF " << _n << std::endl;
 #endif
   _updated = false;
+  _sequential = false;
+  _gate = 0;
+  _rejected = 0;
+#if defined(__linux__)
+  _pool = NULL;
+  _threshold = BLOB_UKF_POOL_THRESHOLD;
+#endif
+}
+
+void blob::UKF::chunk (void* arg, uint32_t c)
+{
+  ukf_job_t* job = (ukf_job_t*)arg;
+  int begin = job->first + c*job->size;
+  int end = (begin + job->size < job->s)? begin + job->size : job->s;
+
+  if(job->batch)
+  {
+    // sigma points are already stored by components, s elements per row
+    job->batch(job->dt, job->arg, job->X + begin, job->U + begin, end - begin,
+               job->s);
+    return;
+  }
+
+  BLOB_MATRIX_ALIGNED real_t in [BLOB_UKF_MAX_N];
+  BLOB_MATRIX_ALIGNED real_t out [BLOB_UKF_MAX_LENGTH];
+
+  for(int k=begin; k<end; k++)
+  {
+    // Y(:,i) = func(X(:,i),fargs);
+    for(int i=0; i<job->n; i++)
+      in[i] = job->X[i*job->s + k];
+
+    job->function(job->dt, job->arg, in, out);
+
+    for(int i=0; i<job->l; i++)
+      job->U[i*job->s + k] = out[i];
+  }
 }
 
-bool blob::UKF::sigmas (blob::Matrix &x, blob::Matrix &P, blob::Matrix &X)
+bool blob::UKF::sigmas (blob::MatrixR &x, blob::MatrixR &P, blob::MatrixR &X)
 {
   bool retval = true;
-  real_t aux[BLOB_UKF_MAX_N*BLOB_UKF_MAX_N];
-  blob::Matrix Aux(_n,_n, aux);
+  BLOB_MATRIX_ALIGNED real_t aux[BLOB_UKF_MAX_N*BLOB_UKF_MAX_N];
+  blob::MatrixR Aux(_n,_n, aux);
+
+  uint8_t piv[BLOB_UKF_MAX_N];
+  for(int i=0; i<_n; i++)
+    piv[i] = i;
 
   // A = c*chol(P)';
   retval &= Aux.copy(P);
-  retval &= Aux.cholesky();
+  if(!Aux.cholesky())
+  {
+    // near-singular or slightly indefinite P: rank-revealing factor of its
+    // positive semi-definite part, A(piv(i),:) = L(i,:)
+    uint8_t rank = 0;
+    retval &= Aux.copy(P);
+    retval &= Aux.pcholesky(piv, &rank);
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "UKF::sigmas() warning: P not positive definite, rank " 
+              << (int)rank << std::endl;
+#endif
+  }
   retval &= Aux.scale(_c);
 
-  // Y = x(:,ones(1,L));
-  for(int i=0; i<X.ncols(); i++)
-    retval &= X.copy(x,0,i);
-
-  // X = [x Y+A Y-A];
-  retval &= X.add(Aux,0,1);
-  retval &= X.substract(Aux,0,_n+1);
+  // X = [x Y+A Y-A], Y = x(:,ones(1,L));
+  BLOB_COUNT("sigmas", 2*_n*_n, sizeof(real_t)*(_n + _n*_n + _n*(2*_n+1)));
+  for(int i=0; i<_n; i++)
+  {
+    int r = piv[i];
+    X(r,0) = x[r];
+    for(int j=0; j<_n; j++)
+    {
+      X(r,j+1)    = x[r] + Aux(i,j);
+      X(r,j+1+_n) = x[r] - Aux(i,j);
+    }
+  }
 
 #if defined(__DEBUG__) & defined(__linux__)
   if(retval == false)
@@ -85,56 +147,80 @@ bool blob::UKF::sigmas (blob::Matrix &x, blob::Matrix &P, blob::Matrix &X)
   return retval;
 }
 
-bool blob::UKF::ut(estimator_function_t function, const real_t& dt, real_t *arg, 
-                   blob::Matrix& X, blob::Matrix& R, blob::Matrix& u, 
-                   blob::Matrix& Pu, blob::Matrix& U, blob::Matrix& Us)
+bool blob::UKF::ut(estimator_function_t function, 
+                   estimator_batch_function_t batch, const real_t& dt, 
+                   real_t *arg, blob::MatrixR& X, blob::MatrixR& R, 
+                   blob::MatrixR& u, blob::MatrixR& Pu, blob::MatrixR& U, 
+                   blob::MatrixR& Us)
 {
   bool retval = true;
-  real_t aux [(2*BLOB_UKF_MAX_N+1)*BLOB_UKF_MAX_LENGTH];
+  BLOB_MATRIX_ALIGNED real_t aux [(2*BLOB_UKF_MAX_N+1)*BLOB_UKF_MAX_LENGTH];
 
   int l = u.nrows();
 
-  blob::Matrix in (_n, 1, aux);
-  blob::Matrix out (l, 1, &(aux[(int)_n]));
-
-  blob::Matrix wc(2*_n+1,1,_wc);
-  
-  u.zero();
+  blob::MatrixR wc(2*_n+1,1,_wc);
   
-  for(int k=0; k<2*_n+1; k++)
-  {
-    // Y(:,i) = func(X(:,i),fargs);
-    for(int i=0; i<_n; i++)
-      in[i] = X(i,k);
-
-    function(dt, arg, in.data(), out.data());
+  // in place batch transformation writes to scratch, so that input and 
+  // result do not overlap
+  bool scratch = batch && (U.data() == X.data());
+  blob::MatrixR out (l, 2*_n+1, scratch? aux : U.data());
+
+  ukf_job_t job;
+  job.function = function;
+  job.batch = batch;
+  job.dt = dt;
+  job.arg = arg;
+  job.X = X.data();
+  job.U = out.data();
+  job.n = _n;
+  job.l = l;
+  job.s = 2*_n+1;
+  job.first = 0;
+  job.size = job.s;
 
-    for(int i=0; i<l; i++)
-      U(i,k) = out[i];
-
-    // y = y + Wm(i)*Y(:,i);  
-    retval &= out.scale(_wm[k]);
-
-    retval &= u.add(out);
-    
+#if defined(__linux__)
+  if(_pool && (_pool->getNumThreads() > 1))
+  {
+    // evaluate first point and time it
+    struct timespec t0, t1;
+    job.size = 1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    chunk(&job, 0);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    real_t us = 1e6*(t1.tv_sec - t0.tv_sec) + 1e-3*(t1.tv_nsec - t0.tv_nsec);
+
+    // remaining points: one chunk per point, or per thread if batch
+    job.first = 1;
+    job.size = job.s - 1;
+    if(us >= _threshold)
+    {
+      int nthreads = _pool->getNumThreads();
+      job.size = batch? (job.s - 1 + nthreads - 1)/nthreads : 1;
+      retval &= _pool->run(chunk, &job, (job.s - 1 + job.size - 1)/job.size);
+    }
+    else
+      chunk(&job, 0);
   }
+  else
+#endif
+    chunk(&job, 0);
 
-  // Ys = Y - y(:,ones(1,N));
-  retval &= Us.copy(U);
-  for(int i=0; i<U.ncols();i++)
-    retval &= Us.substract(u, 0, i);
-
-  // P = Ys*diag(Wc)*Ys' + R;
-  blob::Matrix Aux(l, 2*_n+1, aux);
+  if(scratch)
+    retval &= U.copy(out);
 
-  retval &= blob::Matrix::multiplyDiag(Us, wc, Aux);
-  
-  retval &= Us.transpose();
-  
-  retval &= blob::Matrix::multiply(Aux,Us,Pu);
-  retval &= Pu.add(R);
+  blob::MatrixR wm(2*_n+1,1,_wm);
+  {
+    BLOB_COUNT_TAG("ut.mean");
+    // y = Y*Wm
+    retval &= blob::MatrixR::weightedMean(U, wm, u);
+  }
 
-  retval &= Us.transpose(); // can be avoided with a copy
+  {
+    BLOB_COUNT_TAG("ut.cov");
+    // Ys = Y - y(:,ones(1,N)), P = Ys*diag(Wc)*Ys' + R;
+    retval &= blob::MatrixR::weightedCov(U, wc, u, Pu, &Us);
+    retval &= Pu.add(R);
+  }
   
 #if defined(__DEBUG__) & defined(__linux__)
   if(retval == false)
@@ -146,20 +232,96 @@ bool blob::UKF::ut(estimator_function_t function, const real_t& dt, real_t *arg,
 
 bool blob::UKF::predict (estimator_function_t function, const real_t& dt, 
                          const uint8_t& l, real_t *u, real_t *r)
+{
+  return propagate(function, NULL, dt, u, r);
+}
+
+bool blob::UKF::predict (estimator_batch_function_t function, const real_t& dt,
+                         const uint8_t& l, real_t *u, real_t *r)
+{
+  return propagate(NULL, function, dt, u, r);
+}
+
+bool blob::UKF::update  (estimator_function_t function, const real_t& dt,
+                         const uint8_t& m, real_t *z, real_t *q)
+{
+  return correct(function, NULL, dt, NULL, m, z, q);
+}
+
+bool blob::UKF::update  (estimator_batch_function_t function, const real_t& dt,
+                         const uint8_t& m, real_t *z, real_t *q)
+{
+  return correct(NULL, function, dt, NULL, m, z, q);
+}
+
+bool blob::UKF::update  (const uint8_t& k, estimator_function_t* functions,
+                         const real_t& dt, const uint8_t* m, real_t *z, 
+                         real_t **q)
+{
+  BLOB_MATRIX_ALIGNED real_t q_[BLOB_UKF_MAX_M*BLOB_UKF_MAX_M];
+
+  // stacked measurement length
+  int l = 0;
+  for(int s=0; s<k; s++)
+    l += m[s];
+  if((k == 0) || (l > BLOB_UKF_MAX_M))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "UKF::update() error: " << l << " stacked measurements of " 
+              << (int)k << " sensors" << std::endl;
+#endif
+    return false;
+  }
+
+  // block diagonal noise covariance Q = diag(q[0], q[1], ...)
+  bool retval = true;
+  blob::MatrixR Q(l,l,q_);
+  retval &= Q.zero();
+  for(int s=0, r=0; s<k; r+=m[s++])
+  {
+    blob::MatrixR Qs(m[s],m[s],q[s]);
+    retval &= Q.setBlock(Qs, r, r);
+  }
+
+  ukf_stack_t stacked;
+  stacked.k = k;
+  stacked.functions = functions;
+  stacked.m = m;
+
+  return retval && correct(stack, NULL, dt, (real_t*)&stacked, l, z, 
+                           Q.data());
+}
+
+void blob::UKF::stack (const real_t& dt, real_t* arg, real_t* x, real_t* res)
+{
+  ukf_stack_t* stacked = (ukf_stack_t*)arg;
+  for(int s=0; s<stacked->k; s++)
+  {
+    stacked->functions[s](dt, NULL, x, res);
+    res += stacked->m[s];
+  }
+}
+
+bool blob::UKF::propagate (estimator_function_t function, 
+                           estimator_batch_function_t batch, const real_t& dt,
+                           real_t *u, real_t *r)
 {
   bool retval = true;
 
-  blob::Matrix R(_n,_n,r);
+  blob::MatrixR R(_n,_n,r);
   
-  blob::Matrix x(_n,1,_x);
-  blob::Matrix P(_n,_n,_P);
-  blob::Matrix X(_n,2*_n+1,_X);
-  blob::Matrix Xs(_n,2*_n+1,_Xs);
+  blob::MatrixR x(_n,1,_x);
+  blob::MatrixR P(_n,_n,_P);
+  blob::MatrixR X(_n,2*_n+1,_X);
+  blob::MatrixR Xs(_n,2*_n+1,_Xs);
 
-  // calculate sigma points around x
-  retval &= sigmas(x, P, X);
+  {
+    BLOB_COUNT_TAG("predict.sigmas");
+    // calculate sigma points around x
+    retval &= sigmas(x, P, X);
+  }
   // unscented transformation of state
-  retval &= ut(function, dt, u, X, R, x, P, X, Xs);
+  retval &= ut(function, batch, dt, u, X, R, x, P, X, Xs);
 
   if(retval == true)
     _updated = false;  
@@ -172,71 +334,98 @@ bool blob::UKF::predict (estimator_function_t function, const real_t& dt,
   
 }
 
-bool blob::UKF::update  (estimator_function_t function, const real_t& dt,
-                         const uint8_t& m, real_t *z_, real_t *q)
+bool blob::UKF::correct (estimator_function_t function, 
+                         estimator_batch_function_t batch, const real_t& dt,
+                         real_t *arg, const uint8_t& m, real_t *z_, real_t *q)
 {
   bool retval = true;
 
-  real_t z1_  [BLOB_UKF_MAX_M];
-  real_t Pz_  [BLOB_UKF_MAX_M*BLOB_UKF_MAX_M];
-  real_t Z1_  [(2*BLOB_UKF_MAX_M+1)*BLOB_UKF_MAX_M];
-  real_t Z1s_ [(2*BLOB_UKF_MAX_M+1)*BLOB_UKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t z1_  [BLOB_UKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t Pz_  [BLOB_UKF_MAX_M*BLOB_UKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t Z1_  [(2*BLOB_UKF_MAX_M+1)*BLOB_UKF_MAX_M];
+  BLOB_MATRIX_ALIGNED real_t Z1s_ [(2*BLOB_UKF_MAX_M+1)*BLOB_UKF_MAX_M];
 
-  blob::Matrix Q(m,m,q);
+  blob::MatrixR Q(m,m,q);
 
-  blob::Matrix z(m,1,z_);
-  blob::Matrix z1(m,1,z1_);
-  blob::Matrix Pz(m,m,Pz_);
-  blob::Matrix Z1(m,2*_n+1,Z1_);
-  blob::Matrix Z1s(m,2*_n+1,Z1s_);
+  blob::MatrixR z(m,1,z_);
+  blob::MatrixR z1(m,1,z1_);
+  blob::MatrixR Pz(m,m,Pz_);
+  blob::MatrixR Z1(m,2*_n+1,Z1_);
+  blob::MatrixR Z1s(m,2*_n+1,Z1s_);
 
-  blob::Matrix x(_n,1,_x);
-  blob::Matrix P(_n,_n,_P);
-  blob::Matrix X(_n,2*_n+1,_X);
-  blob::Matrix Xs(_n,2*_n+1,_Xs);
-  blob::Matrix wc(2*_n+1,1,_wc);
+  blob::MatrixR x(_n,1,_x);
+  blob::MatrixR P(_n,_n,_P);
+  blob::MatrixR X(_n,2*_n+1,_X);
+  blob::MatrixR Xs(_n,2*_n+1,_Xs);
+  blob::MatrixR wc(2*_n+1,1,_wc);
   
   if(_updated) // if already updated at least once,
   {    
+    BLOB_COUNT_TAG("update.sigmas");
     // re-calculate sigma points around x
     retval &= sigmas(x,P,X);
     // re-calculate deviation of X
     retval &= Xs.copy(X);
-    for(int i=0; i<X.ncols(); i++)
-      retval &= Xs.substract(x,0,i);
+    BLOB_COUNT("deviation", _n*X.ncols(), 2*sizeof(real_t)*_n*X.ncols());
+    for(int i=0; i<_n; i++)
+      for(int k=0; k<X.ncols(); k++)
+        Xs(i,k) -= x[i];
   }
 
   // unscented transformation of measurments
-  ut(function, dt, NULL, X, Q, z1, Pz, Z1, Z1s);
+  ut(function, batch, dt, arg, X, Q, z1, Pz, Z1, Z1s);
 
-  real_t auxb[(2*BLOB_UKF_MAX_N+1)*BLOB_UKF_MAX_LENGTH];
-  real_t pxz [(2*BLOB_UKF_MAX_N+1)*BLOB_UKF_MAX_LENGTH];
-  real_t   k [BLOB_UKF_MAX_N*BLOB_UKF_MAX_M];
-  
-  blob::Matrix Pxz (_n,m,pxz);
-  blob::Matrix K (_n,m,k);
-  blob::Matrix aux (_n,2*_n+1,auxb);
-
-  // transformed cross-covariance: Pxz = X1s*diag(Wc)*Z1s'
-  retval &= blob::Matrix::multiplyDiag(Xs, wc, aux);
-  retval &= Z1s.transpose();
-  retval &= blob::Matrix::multiply(aux, Z1s, Pxz);
+  BLOB_MATRIX_ALIGNED real_t auxb[(2*BLOB_UKF_MAX_N+1)*BLOB_UKF_MAX_LENGTH];
+  BLOB_MATRIX_ALIGNED real_t pxz [(2*BLOB_UKF_MAX_N+1)*BLOB_UKF_MAX_LENGTH];
+  BLOB_MATRIX_ALIGNED real_t k [BLOB_UKF_MAX_N*BLOB_UKF_MAX_M];
   
-  // K = Pxz/Pz; 
-  retval &= blob::Matrix::divide(Pxz, Pz, K);
-  
-  // update state: x = x + K*(z - z1)
-  aux.refurbish(_n,1);
-  retval &= z.substract(z1);
-  retval &= blob::Matrix::multiply(K, z, aux);       
-  retval &= x.add(aux);
-
-  aux.refurbish(_n,_n);
-
-  // update covariance: P = P - K*Pxz'  
-  retval &= Pxz.transpose();
-  retval &= blob::Matrix::multiply(K, Pxz, aux);
-  retval &= P.substract(aux);
+  blob::MatrixR Pxz (_n,m,pxz);
+  blob::MatrixR K (_n,m,k);
+  blob::MatrixR aux (_n,2*_n+1,auxb);
+
+  {
+    BLOB_COUNT_TAG("update.xcov");
+    // transformed cross-covariance: Pxz = X1s*diag(Wc)*Z1s'
+    retval &= blob::MatrixR::weightedCross(Xs, Z1s, wc, Pxz);
+  }
+
+  // measurement noise components independent of each other?
+  bool diagonal = _sequential;
+  for(int i=0; diagonal && (i<m); i++)
+    for(int j=0; j<m; j++)
+      diagonal &= (i == j) || (Q(i,j) == 0);
+
+  _rejected = 0;
+  if(diagonal)
+  {
+    BLOB_COUNT_TAG("update.sequential");
+    retval &= sequential(z, z1, Pz, Pxz);
+  }
+  else
+  {
+    {
+      BLOB_COUNT_TAG("update.gain");
+      // K = Pxz/Pz; 
+      retval &= blob::MatrixR::divide(Pxz, Pz, K);
+    }
+    {
+      BLOB_COUNT_TAG("update.state");
+      // update state: x = x + K*(z - z1)
+      aux.refurbish(_n,1);
+      retval &= z.substract(z1);
+      retval &= blob::MatrixR::multiply(K, z, aux);       
+      retval &= x.add(aux);
+    }
+    {
+      BLOB_COUNT_TAG("update.cov");
+      aux.refurbish(_n,_n);
+
+      // update covariance: P = P - K*Pxz'  
+      retval &= Pxz.transpose();
+      retval &= blob::MatrixR::multiply(K, Pxz, aux);
+      retval &= P.substract(aux);
+    }
+  }
     
   if(retval == true)
     _updated = true;  
@@ -248,12 +437,112 @@ bool blob::UKF::update  (estimator_function_t function, const real_t& dt,
   return retval;
 }
 
+bool blob::UKF::sequential (blob::MatrixR& z, blob::MatrixR& z1, 
+                            blob::MatrixR& Pz, blob::MatrixR& Pxz)
+{
+  bool retval = true;
+  int m = z.nrows();
+  BLOB_MATRIX_ALIGNED real_t k_[BLOB_UKF_MAX_N];
+
+  blob::MatrixR x(_n,1,_x);
+  blob::MatrixR P(_n,_n,_P);
+  blob::MatrixR k(_n,1,k_);
+
+  // conditioning of state and remaining components (ger counts itself)
+  BLOB_COUNT("scalar", m*(3*_n + 2*_n*m + m*m), 
+                       sizeof(real_t)*m*(2*_n + 2*_n*m + m*m));
+  for(int j=0; j<m; j++)
+  {
+    // innovation of component j and its variance
+    real_t s = Pz(j,j);
+    real_t y = z[j] - z1[j];
+    z[j] = y;
+    if(!(s > 0))
+    {
+#if defined(__DEBUG__) & defined(__linux__)
+      std::cerr << "UKF::sequential() error: variance " << s 
+                << " of component " << j << std::endl;
+#endif
+      return false;
+    }
+
+    // optional outlier rejection: |y| > gate*sqrt(s)
+    if((_gate > 0) && (y*y > _gate*_gate*s))
+    {
+      _rejected++;
+      continue;
+    }
+
+    // x = x + k*y, P = P - k*k'*s, with k = Pxz(:,j)/s
+    for(int i=0; i<_n; i++)
+      k[i] = Pxz(i,j);
+    retval &= P.ger(k, k, -1/s);
+    retval &= k.scale(1/s);
+    for(int i=0; i<_n; i++)
+      x[i] += k[i]*y;
+
+    // condition remaining components on component j
+    for(int i=j+1; i<m; i++)
+    {
+      real_t a = Pz(i,j)/s;
+      z1[i] += a*y;
+      for(int l=0; l<_n; l++)
+        Pxz(l,i) -= a*Pxz(l,j);
+      for(int l=j+1; l<m; l++)
+        Pz(i,l) -= a*Pz(j,l);
+    }
+  }
+
+#if defined(__DEBUG__) & defined(__linux__)
+  if(retval == false)
+    std::cerr << "UKF::sequential() error" << std::endl;
+#endif
+
+  return retval;
+}
+
+bool blob::UKF::registerShapes (uint8_t m)
+{
+  uint8_t s = 2*_n+1;
+  bool retval = Tuner::registerShape(_n,s,_n);  // P = Xs*diag(Wc)*Xs'
+  if(m > 0)
+  {
+    retval &= Tuner::registerShape(m,s,m);      // Pz = Zs*diag(Wc)*Zs'
+    retval &= Tuner::registerShape(_n,s,m);     // Pxz = Xs*diag(Wc)*Zs'
+    retval &= Tuner::registerShape(_n,m,1);     // K*(z - z1)
+    retval &= Tuner::registerShape(_n,m,_n);    // K*Pxz'
+  }
+  return retval;
+}
+
+bool blob::UKF::checkpoint (real_t* buffer)
+{
+  int s = _n*(2*_n+1);
+  memcpy(buffer, _x, _n*sizeof(real_t));
+  memcpy(&buffer[_n], _P, _n*_n*sizeof(real_t));
+  memcpy(&buffer[_n + _n*_n], _X, s*sizeof(real_t));
+  memcpy(&buffer[_n + _n*_n + s], _Xs, s*sizeof(real_t));
+  buffer[_n + _n*_n + 2*s] = _updated? 1 : 0;
+  return true;
+}
+
+bool blob::UKF::restore (const real_t* buffer)
+{
+  int s = _n*(2*_n+1);
+  memcpy(_x, buffer, _n*sizeof(real_t));
+  memcpy(_P, &buffer[_n], _n*_n*sizeof(real_t));
+  memcpy(_X, &buffer[_n + _n*_n], s*sizeof(real_t));
+  memcpy(_Xs, &buffer[_n + _n*_n + s], s*sizeof(real_t));
+  _updated = (buffer[_n + _n*_n + 2*s] != 0);
+  return true;
+}
+
 void blob::UKF::print  ()
 {
-  blob::Matrix x(_n,1,_x);
-  blob::Matrix P(_n,_n,_P);
-  blob::Matrix X(_n,2*_n+1,_X);
-  blob::Matrix Xs(_n,2*_n+1,_Xs);
+  blob::MatrixR x(_n,1,_x);
+  blob::MatrixR P(_n,_n,_P);
+  blob::MatrixR X(_n,2*_n+1,_X);
+  blob::MatrixR Xs(_n,2*_n+1,_Xs);
   
 #if defined(__linux__)
   std::cout << "UKF::x = " << std::endl;
@@ -0,0 +1,315 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       imu7z3q.h
+ * \brief      imu attitude model and dataset reader shared by the imu7z3q 
+ *             estimation tests (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_IMU7Z3Q_H
+#define B_IMU7Z3Q_H
+
+#include <iostream>
+#include <sstream> 
+#include <fstream>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <blob/math.h>
+#include <blob/estimator.h>
+
+#define N   7   // Number of states
+
+#define T 0.01
+#define Tacc 0.02
+#define Tmag 0.05
+
+#define qq   0
+#define qbg  0.0001
+#define racc 0.1
+#define rmag 0.25
+
+#define qq_T_2   (qq*qq*T*T)
+#define qbg_T_2  (qbg*qbg*T*T)
+#define racc_T_2 (racc*racc*Tacc*Tacc)
+#define rmag_T_2 (rmag*rmag*Tmag*Tmag)
+
+void f(const real_t& dt, real_t* u, real_t* x, real_t* res)
+{
+  // x = [q0, q1, q2, q3, gbx, gby, gbz]
+  // u = [gx, gy, gz]
+
+  real_t q0 = x[0], q1 = x[1], q2 = x[2], q3 = x[3], gbx = x[4], gby = x[5], gbz = x[6];
+
+  real_t gx = u[0] - gbx; 
+  real_t gy = u[1] - gby; 
+  real_t gz = u[2] - gbz;
+
+  // predict new state (FRD)
+  res[0] = q0 + (-q1*gx - q2*gy - q3*gz)*dt/2;
+  res[1] = q1 + ( q0*gx + q3*gy - q2*gz)*dt/2;
+  res[2] = q2 + (-q3*gx + q0*gy + q1*gz)*dt/2;
+  res[3] = q3 + ( q2*gx - q1*gy + q0*gz)*dt/2;
+  res[4] = gbx;
+  res[5] = gby;
+  res[6] = gbz;
+
+  // re-normalize quaternion
+  real_t qnorm = blob::math::sqrtr(res[0]*res[0] + res[1]*res[1] + res[2]*res[2] + res[3]*res[3]);
+  res[0] = res[0]/qnorm;
+  res[1] = res[1]/qnorm;
+  res[2] = res[2]/qnorm;
+  res[3] = res[3]/qnorm;
+}
+
+void ha(const real_t& dt, real_t* arg, real_t* x, real_t* res)
+{
+  real_t q0 = x[0], q1 = x[1], q2 = x[2], q3 = x[3];
+
+  // estimated direction of gravity (NED)
+  res[0] =  2*(q0*q2 - q1*q3);             // ax
+  res[1] = -2*(q0*q1 + q2*q3);             // ay
+  res[2] = -q0*q0 + q1*q1 + q2*q2 - q3*q3; // az
+}
+
+void hm(const real_t& dt, real_t* arg, real_t* x, real_t* res)
+{
+  real_t q0 = x[0], q1 = x[1], q2 = x[2], q3 = x[3];
+
+  // estimated direction of flux (NED)
+  res[0] = q0*q0 + q1*q1 - q2*q2 - q3*q3; // mx
+  res[1] = 2*(q1*q2 - q0*q3);             // my
+  res[2] = 2*(q0*q2 + q1*q3);             // mz
+}
+
+// covariance of process
+real_t  q[] = { qq_T_2,  0,   0,   0,    0,    0,    0,      
+                 0, qq_T_2,  0,   0,    0,    0,    0,     
+                 0,   0, qq_T_2,  0,    0,    0,    0,     
+                 0,   0,   0, qq_T_2,   0,    0,    0,    
+                 0,   0,   0,   0, qbg_T_2,   0,    0,    
+                 0,   0,   0,   0,    0, qbg_T_2,   0,    
+                 0,   0,   0,   0,    0,    0, qbg_T_2 };
+
+// covariance of measurement
+real_t ra[] = { racc_T_2,    0,     0,
+                   0, racc_T_2,    0,
+                   0,     0, racc_T_2 };
+
+// covariance of measurement
+real_t rm[] = { rmag_T_2,    0,     0, 
+                   0, rmag_T_2,    0,
+                   0,     0, rmag_T_2 };
+
+double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+/**
+ * Provides maximum absolute difference between two state vectors.
+ */
+real_t difference (const real_t* a, const real_t* b)
+{
+  real_t d = 0;
+  for(int i = 0; i < N; i++)
+  {
+    real_t e = blob::math::rabs(a[i] - b[i]);
+    d = (e > d)? e : d;
+  }
+  return d;
+}
+
+/**
+ * Reads imu dataset samples (gyroscope, accelerometer and magnetometer), 
+ * normalises sensor measurements and tells which sensors are due for update
+ * at every sample.
+ */
+class Imu7z3q
+{
+  public:
+    /**
+     * Initializes reader with no samples read.
+     */
+    Imu7z3q () : steps(0), update_acc(false), update_mag(false), _ta(0), 
+                 _tm(0) {}
+
+    /**
+     * Opens input dataset and output file given as test arguments, printing
+     * usage or i/o errors.
+     * \param argc   number of test arguments
+     * \param argv   test arguments: input file, output file and up to extra 
+     *               optional arguments
+     * \param extra  number of optional arguments after output file
+     * \param usage  description of optional arguments for usage message
+     * \return true if successful, false otherwise
+     */
+    bool open (int argc, char* argv[], int extra = 0, const char* usage = "")
+    {
+      if((argc < 3) || (argc > 3 + extra))
+      {
+        std::cerr << "[test] - usage: ./test input_file output_file" << usage
+                  << std::endl;
+        return false;
+      }
+      _input.open(argv[1]);
+      if (!_input.is_open())
+      {
+        std::cerr << "[test] - file i/o error: unable to open file " << argv[1] << std::endl;
+        return false;
+      }
+      output.open(argv[2]);
+      if (!output.is_open())
+      {
+        std::cerr << "[test] - file i/o error: unable to open file " << argv[2] << std::endl;
+        return false;
+      }
+      return true;
+    }
+
+    /**
+     * Reads next dataset sample into u, za and zm, and sets update_acc and 
+     * update_mag if the accelerometer or magnetometer are due.
+     * \return true if a sample was read, false at end of dataset
+     */
+    bool next ()
+    {
+      std::string line;
+
+      while ( getline (_input,line) )
+      {
+        if((line[0] == '-') || ((line[0] >= '0')&&(line[0] <='9')))
+        {
+          real_t gx, gy, gz, ax, ay, az, mx, my, mz, anorm, mnorm;
+
+          std::stringstream lineinput(line);
+          lineinput >> gx >> gy >> gz >> ax >> ay >> az  >> mx >> my >> mz;
+          steps++;
+
+          _ta += T; 
+          _tm += T;
+
+          // normalise measurements
+          anorm = blob::math::sqrtr(ax*ax + ay*ay + az*az);
+          if (anorm > 0)
+          {
+            ax = ax/anorm;
+            ay = ay/anorm;
+            az = az/anorm;
+          }
+
+          mnorm = blob::math::sqrtr(mx*mx + my*my + mz*mz);
+          if (mnorm > 0)
+          {
+            mx = mx/mnorm;
+            my = my/mnorm;
+            mz = mz/mnorm;
+          }
+
+          u[0] = gx; u[1] = gy; u[2] = gz;
+          za[0] = ax; za[1] = ay; za[2] = az;
+          zm[0] = mx; zm[1] = my; zm[2] = mz;
+
+          update_acc = (_ta >= Tacc);
+          update_mag = (_tm >= Tmag);
+          if (update_acc)
+            _ta = 0;
+          if (update_mag)
+            _tm = 0;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /**
+     * Writes a state vector as a line of the output file.
+     * \param x  state vector
+     */
+    void write (const real_t* x)
+    {
+      for(int i = 0; i < N; i++)
+        output << x[i] << ((i < N-1)? " ":"");
+      output << std::endl;
+    }
+
+    real_t u[3];              /**< gyroscope sample [rad/s] */
+    real_t za[3];             /**< normalised accelerometer sample */
+    real_t zm[3];             /**< normalised magnetometer sample */
+    long steps;               /**< samples read */
+    bool update_acc;          /**< accelerometer update due */
+    bool update_mag;          /**< magnetometer update due */
+    std::ofstream output;     /**< output file */
+
+  private:
+    std::ifstream _input;     /**< input dataset */
+    real_t _ta;               /**< time since last accelerometer update [s] */
+    real_t _tm;               /**< time since last magnetometer update [s] */
+};
+
+/**
+ * Updates filter with accelerometer and magnetometer measurements if due. 
+ * Measurements are copied, as filters may use them as scratch.
+ * \param filter  estimator
+ * \param data    dataset reader with current sample
+ * \return true if successful, false otherwise
+ */
+bool update (blob::Estimator & filter, const Imu7z3q & data)
+{
+  bool result = true;
+  real_t z[3];
+  if (data.update_acc)
+  {
+    memcpy(z, data.za, sizeof(z));
+    result &= filter.update(&ha, Tacc, 3, z, ra);
+  }
+  if (data.update_mag)
+  {
+    memcpy(z, data.zm, sizeof(z));
+    result &= filter.update(&hm, Tmag, 3, z, rm);
+  }
+  return result;
+}
+
+/**
+ * Runs one filter step: prediction and due sensor updates.
+ * \param filter   estimator
+ * \param data     dataset reader with current sample
+ * \param process  process model function
+ * \return true if successful, false otherwise
+ */
+bool step (blob::Estimator & filter, Imu7z3q & data, 
+           blob::estimator_function_t process = &f)
+{
+  bool result = filter.predict(process, T, 3, data.u, q);
+  result &= update(filter, data);
+  return result;
+}
+
+#endif // B_IMU7Z3Q_H
@@ -0,0 +1,280 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       test_ekf_nav9z42_linux.cpp
+ * \brief      test for ekf library to estimate position and velocity, compared
+ *             with ukf over the same templated model functions (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <sstream> 
+#include <fstream>
+#include <math.h>
+#include <time.h>
+
+#include <blob/math.h>
+#include <blob/ukf.h>
+#include <blob/ekf.h>
+
+#define N   9   // Number of states
+#define L   6   // Length of control input
+
+#define T      0.01
+#define Tgps   0.1
+#define Tbaro  0.1
+
+#define rgps   0.001
+#define rvgps  0.01
+#define rbaro  0.005
+#define rbroc  0.05
+#define qba    0.001
+
+#define qba_T_2   (qba*qba*T*T)
+#define rgps_T_2  (rgps*rgps*Tgps*Tgps)
+#define rvgps_T_2 (rvgps*rvgps*Tgps*Tgps)
+#define rbaro_T_2 (rbaro*rbaro*Tbaro*Tbaro)
+#define rbroc_T_2 (rbroc*rbroc*Tbaro*Tbaro)
+
+typedef blob::Dual<N> D;
+
+long evaluations = 0; // number of model function evaluations
+
+template <typename S> void f(const real_t& dt, real_t* u, S* x, S* res)
+{
+  // x = [px, py, pz, vx, vy, vz, abx, aby, abz]
+  // u = [roll, pitch, yaw, ax, ay, az]
+  evaluations++;
+
+  real_t cr = cos(u[0]), sr = sin(u[0]);
+  real_t cp = cos(u[1]), sp = sin(u[1]);
+  real_t cy = cos(u[2]), sy = sin(u[2]);
+
+  S bx = u[3] - x[6], by = u[4] - x[7], bz = u[5] - x[8];
+
+  // rotate body acceleration to NED reference frame
+  S ax =  bx*(cp*cy) + by*(sr*sp*cy - cr*sy) + bz*(cr*sp*cy + sr*sy);
+  S ay =  bx*(cp*sy) + by*(sr*sp*sy + cr*cy) + bz*(cr*sp*sy - sr*cy);
+  S az = -bx*sp      + by*(sr*cp)            + bz*(cr*cp);
+
+  res[3] = x[3] + ax*dt;
+  res[4] = x[4] + ay*dt;
+  res[5] = x[5] + az*dt;
+  res[0] = x[0] + res[3]*dt;
+  res[1] = x[1] + res[4]*dt;
+  res[2] = x[2] + res[5]*dt;
+  res[6] = x[6];
+  res[7] = x[7];
+  res[8] = x[8];
+}
+
+template <typename S> void hgps(const real_t& dt, real_t* u, S* x, S* res)
+{
+  // z = [px, py, vx, vy]
+  evaluations++;
+  res[0] = x[0];
+  res[1] = x[1];
+  res[2] = x[3];
+  res[3] = x[4];
+}
+
+template <typename S> void hbaro(const real_t& dt, real_t* u, S* x, S* res)
+{
+  // z = [pz, vz]
+  evaluations++;
+  res[0] = x[2];
+  res[1] = x[5];
+}
+
+real_t q[] = { 0, 0, 0, 0, 0, 0,     0,        0,        0,
+               0, 0, 0, 0, 0, 0,     0,        0,        0,
+               0, 0, 0, 0, 0, 0,     0,        0,        0,
+               0, 0, 0, 0, 0, 0,     0,        0,        0,
+               0, 0, 0, 0, 0, 0,     0,        0,        0,
+               0, 0, 0, 0, 0, 0,     0,        0,        0,
+               0, 0, 0, 0, 0, 0, qba_T_2,      0,        0,
+               0, 0, 0, 0, 0, 0,     0,    qba_T_2,      0,
+               0, 0, 0, 0, 0, 0,     0,        0,    qba_T_2 };
+
+real_t rg[] = { rgps_T_2,     0,         0,         0,
+                   0,     rgps_T_2,      0,         0,
+                   0,         0,     rvgps_T_2,     0,
+                   0,         0,         0,     rvgps_T_2 };
+
+real_t rb[] = { rbaro_T_2,     0,
+                    0,     rbroc_T_2 };
+
+double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+int main(int argc, char* argv[])
+{
+  bool result = true;
+
+  real_t  x[N] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+  real_t  u[L] = {0, 0, 0, 0, 0, -9.8};
+  real_t zg[4], zb[2], zu[4];
+  
+  if(argc == 3)
+  {
+    std::ifstream input_file (argv[1]);
+    std::ofstream output_file (argv[2]);
+
+    if (input_file.is_open())
+    {
+      if (output_file.is_open())
+      {
+        std::string line;
+        
+        blob::UKF ukf(N, x);
+        blob::EKF ekf(N, x);
+        blob::EKF fdekf(N, x);
+
+        long steps = 0, ukf_evaluations = 0, ekf_evaluations = 0;
+        double ukf_time = 0, ekf_time = 0, t0;
+        real_t error = 0, fderror = 0;
+        real_t init_altitude = 0, prev_balt = 0;
+        int last_gps_index = 0;
+
+        while ( getline (input_file,line) )
+        {
+          if((line[0] == '-') || ((line[0] >= '0')&&(line[0] <='9')))
+          {
+            real_t baro, gps_x, gps_y, gps_vx, gps_vy;
+            int gps_index, gps_status;
+
+            std::stringstream lineinput(line);
+            lineinput >> u[0] >> u[1] >> u[2] >> u[3] >> u[4] >> u[5] >> baro 
+                      >> gps_x >> gps_y >> gps_vx >> gps_vy >> gps_index 
+                      >> gps_status;
+            steps++;
+            if(steps == 1)
+              init_altitude = baro;
+
+            // barometer altitude and rate of climb
+            real_t balt = baro - init_altitude;
+            real_t broc = (balt - prev_balt)/T;
+            prev_balt = balt;
+            if(gps_status < 1) // gps status not OK
+            {
+              init_altitude = 0.9*init_altitude + 0.1*baro;
+              balt = 0; broc = 0;
+              gps_x = 0; gps_y = 0; gps_vx = 0; gps_vy = 0;
+            }
+            bool update_baro = ((steps % 10) == 0);
+            bool update_gps = ((steps % 10) == 0) && 
+                              (gps_index != last_gps_index);
+            if(update_gps)
+              last_gps_index = gps_index;
+            zb[0] = -balt; zb[1] = -broc;
+            zg[0] = gps_x; zg[1] = gps_y; zg[2] = gps_vx; zg[3] = gps_vy;
+
+            // ukf: 2n+1 evaluations of each function
+            evaluations = 0;
+            t0 = now();
+            result &= ukf.predict(&f<real_t>, T, L, u, q);
+            if(update_baro)
+            {
+              memcpy(zu, zb, sizeof(zb));
+              result &= ukf.update(&hbaro<real_t>, Tbaro, 2, zu, rb);
+            }
+            if(update_gps)
+            {
+              memcpy(zu, zg, sizeof(zg));
+              result &= ukf.update(&hgps<real_t>, Tgps, 4, zu, rg);
+            }
+            ukf_time += now() - t0;
+            ukf_evaluations += evaluations;
+
+            // ekf: one evaluation of each function over dual numbers
+            evaluations = 0;
+            t0 = now();
+            result &= ekf.predict(&f<D>, T, L, u, q);
+            if(update_baro)
+              result &= ekf.update(&hbaro<D>, Tbaro, 2, zb, rb);
+            if(update_gps)
+              result &= ekf.update(&hgps<D>, Tgps, 4, zg, rg);
+            ekf_time += now() - t0;
+            ekf_evaluations += evaluations;
+
+            // ekf: jacobians by forward differences, n+1 evaluations
+            result &= fdekf.predict(&f<real_t>, T, L, u, q);
+            if(update_baro)
+            {
+              memcpy(zu, zb, sizeof(zb));
+              result &= fdekf.update(&hbaro<real_t>, Tbaro, 2, zu, rb);
+            }
+            if(update_gps)
+            {
+              memcpy(zu, zg, sizeof(zg));
+              result &= fdekf.update(&hgps<real_t>, Tgps, 4, zu, rg);
+            }
+
+            // linear model: both filters must agree
+            for(int i = 0; i < N; i++)
+            {
+              real_t e = blob::math::rabs(ekf.getState(i) - ukf.getState(i));
+              error = (e > error)? e : error;
+              e = blob::math::rabs(ekf.getState(i) - fdekf.getState(i));
+              fderror = (e > fderror)? e : fderror;
+              output_file << ekf.getState(i) << ((i < N-1)? " ":"");
+            }
+            output_file << std::endl;
+          }
+          if (result == false)
+          {
+            std::cerr << "[test] - filter error at step " << steps << std::endl;
+            return -1;
+          }
+        }
+        input_file.close();
+        output_file.close();
+
+        std::cout << "[test] - " << steps << " steps" << std::endl;
+        std::cout << "[test] - ukf: " << (real_t)ukf_evaluations/steps 
+                  << " evaluations/step, " << 1e6*ukf_time/steps << " us/step" 
+                  << std::endl;
+        std::cout << "[test] - ekf: " << (real_t)ekf_evaluations/steps 
+                  << " evaluations/step, " << 1e6*ekf_time/steps << " us/step" 
+                  << std::endl;
+        std::cout << "[test] - max |x_ekf - x_ukf| = " << error << std::endl;
+        std::cout << "[test] - max |x_ekf - x_ekf(differences)| = " << fderror
+                  << std::endl;
+      }
+      else 
+        std::cerr << "[test] - file i/o error: unable to open file " << argv[2] << std::endl;
+    }
+    else 
+      std::cerr << "[test] - file i/o error: unable to open file " << argv[1] << std::endl;
+  }
+  else
+    std::cerr << "[test] - usage: ./test input_file output_file" << std::endl;
+  
+  return 0;
+}
@@ -0,0 +1,187 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       test_fusion_imu7z3q_linux.cpp
+ * \brief      fuses magnetometer measurements delivered late through fusion 
+ *             front-end and compares with in order and naive fusion (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <blob/ukf.h>
+#include <blob/fusion.h>
+
+#include "imu7z3q.h"
+
+#define PERIOD 10000 // sample period [us]
+#define DELAY  15    // magnetometer delay [samples]
+#define OFFSET 4000000000u // clock at start [us], wraps during the dataset
+
+/**
+ * Magnetometer measurement waiting to be delivered.
+ */
+struct Delayed
+{
+  long step;
+  uint32_t t;
+  real_t z[3];
+};
+
+int main(int argc, char* argv[])
+{
+  bool result = true;
+
+  real_t x[N] = {1,  0,  0,  0,  0,  0,  0};
+  real_t z[3];
+  Imu7z3q data;
+
+  if (!data.open(argc, argv))
+    return 0;
+
+  blob::UKF ukf(N, x);    // in order, fused directly
+  blob::UKF fukf(N, x);   // in order, through fusion front-end
+  blob::UKF lukf(N, x);   // late magnetometer, through fusion front-end
+  blob::UKF nukf(N, x);   // late magnetometer, fused on arrival
+  blob::UKF oukf(N, x);   // in order, through fusion front-end, clock offset
+
+  blob::Fusion fusion(&fukf, &f, 3, q, 0);
+  blob::Fusion late(&lukf, &f, 3, q, 0);
+  blob::Fusion offset(&oukf, &f, 3, q, OFFSET);
+  int8_t fa = fusion.addSensor(&ha, 3, ra, Tacc);
+  int8_t fm = fusion.addSensor(&hm, 3, rm, Tmag);
+  int8_t la = late.addSensor(&ha, 3, ra, Tacc);
+  int8_t lm = late.addSensor(&hm, 3, rm, Tmag);
+  int8_t oa = offset.addSensor(&ha, 3, ra, Tacc);
+  int8_t om = offset.addSensor(&hm, 3, rm, Tmag);
+
+  Delayed queue[DELAY+1];
+  int head = 0, size = 0;
+
+  double late_time = 0;
+  real_t error = 0, late_error = 0, naive_error = 0, offset_error = 0;
+
+  while (data.next())
+  {
+    long steps = data.steps;
+    uint32_t t = steps*PERIOD;
+
+    // reference
+    result &= step(ukf, data);
+
+    // in order through fusion front-end
+    result &= fusion.predict(t, data.u);
+    if (data.update_acc)
+      result &= fusion.update(fa, t, data.za);
+    if (data.update_mag)
+      result &= fusion.update(fm, t, data.zm);
+
+    // same, timestamps from a clock that started at OFFSET
+    result &= offset.predict(OFFSET + t, data.u);
+    if (data.update_acc)
+      result &= offset.update(oa, OFFSET + t, data.za);
+    if (data.update_mag)
+      result &= offset.update(om, OFFSET + t, data.zm);
+
+    // magnetometer delivered DELAY samples late
+    if (data.update_mag)
+    {
+      Delayed & d = queue[(head + size++)%(DELAY+1)];
+      d.step = steps;
+      d.t = t;
+      memcpy(d.z, data.zm, 3*sizeof(real_t));
+    }
+    double t0 = now();
+    result &= late.predict(t, data.u);
+    if (data.update_acc)
+      result &= late.update(la, t, data.za);
+    for (int i = 0; i < size; i++)
+    {
+      Delayed & d = queue[(head + i)%(DELAY+1)];
+      if (d.step + DELAY <= steps)
+        result &= late.update(lm, d.t, d.z);
+    }
+    late_time += now() - t0;
+
+    result &= nukf.predict(&f, T, 3, data.u, q);
+    if (data.update_acc)
+    {
+      memcpy(z, data.za, 3*sizeof(real_t));
+      result &= nukf.update(&ha, Tacc, 3, z, ra);
+    }
+    while (size && (queue[head].step + DELAY <= steps))
+    {
+      memcpy(z, queue[head].z, 3*sizeof(real_t));
+      result &= nukf.update(&hm, Tmag, 3, z, rm);
+      head = (head + 1)%(DELAY+1);
+      size--;
+    }
+
+    real_t e = difference(fukf.getState(), ukf.getState());
+    error = (e > error)? e : error;
+    e = difference(oukf.getState(), fukf.getState());
+    offset_error = (e > offset_error)? e : offset_error;
+    e = difference(nukf.getState(), ukf.getState());
+    naive_error = (e > naive_error)? e : naive_error;
+
+    data.write(lukf.getState());
+
+    if (result == false)
+    {
+      std::cerr << "[test] - filter error at step " << steps << std::endl;
+      return -1;
+    }
+  }
+
+  // deliver remaining measurements and compare once all are fused
+  while (size)
+  {
+    result &= late.update(lm, queue[head].t, queue[head].z);
+    head = (head + 1)%(DELAY+1);
+    size--;
+  }
+  late_error = difference(lukf.getState(), fukf.getState());
+
+  std::cout << "[test] - " << data.steps << " steps, magnetometer " 
+            << DELAY*PERIOD/1000 << " ms late" << std::endl;
+  std::cout << "[test] - late fusion: " << 1e6*late_time/data.steps 
+            << " us/step, " << late.getReplays() << " replays of "
+            << (real_t)late.getReplayedTicks()/late.getReplays() 
+            << " ticks, " << late.getDropped() << " dropped" << std::endl;
+  std::cout << "[test] - max |x_fusion - x_ukf| in order = " << error
+            << std::endl;
+  std::cout << "[test] - max |x_offset - x_fusion| in order = " 
+            << offset_error << std::endl;
+  std::cout << "[test] - |x_late - x_fusion| once fused = " 
+            << late_error << std::endl;
+  std::cout << "[test] - max |x_naive - x_ukf| on arrival = " 
+            << naive_error << std::endl;
+  if (result == false)
+  {
+    std::cerr << "[test] - filter error delivering last measurements"
+              << std::endl;
+    return -1;
+  }
+  
+  return 0;
+}
@@ -0,0 +1,211 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       test_pf_linux.cpp
+ * \brief      test for pf library tracking a constant velocity target with 
+ *             range-bearing measurements (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <blob/math.h>
+#include <blob/pf.h>
+
+#define N      4      // Length of state vector [px py vx vy]
+#define M      2      // Length of measurement vector [range bearing]
+#define STEPS  200    // number of filter steps
+#define NP     100000 // particles of vectorized filter
+#define NP_REF 1000   // particles of per particle filter
+
+// sample time
+#define T 0.01
+
+// noise standard deviations
+#define SV 0.5   // velocity random walk [m/s/sqrt(s)]
+#define SR 0.05  // range [m]
+#define SB 0.01  // bearing [rad]
+
+real_t q[] = { 0, 0, 0, 0,
+               0, 0, 0, 0,
+               0, 0, SV*SV*T, 0,
+               0, 0, 0, SV*SV*T };
+
+real_t r[] = { SR*SR, 0,
+               0, SB*SB };
+
+real_t truth[STEPS][N];
+real_t measurements[STEPS][M];
+
+double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+void f(const real_t& dt, real_t* u, real_t* x, real_t* res)
+{
+  res[0] = x[0] + dt*x[2];
+  res[1] = x[1] + dt*x[3];
+  res[2] = x[2];
+  res[3] = x[3];
+}
+
+void h(const real_t& dt, real_t* u, real_t* x, real_t* res)
+{
+  res[0] = blob::math::sqrtr(x[0]*x[0] + x[1]*x[1]);
+  res[1] = blob::math::atan2(x[1], x[0]);
+}
+
+void fv(const real_t& dt, real_t* u, real_t* const* x, uint32_t begin, 
+        uint32_t end, uint32_t* seed, real_t* result)
+{
+  real_t *px = x[0], *py = x[1], *vx = x[2], *vy = x[3];
+  real_t s = SV*blob::math::sqrtr(dt);
+  real_t e[2];
+  for(uint32_t k=begin; k<end; k++)
+  {
+    blob::PF::gaussian(seed, e, 2);
+    px[k] += dt*vx[k];
+    py[k] += dt*vy[k];
+    vx[k] += s*e[0];
+    vy[k] += s*e[1];
+  }
+}
+
+void hv(const real_t& dt, real_t* z, real_t* const* x, uint32_t begin, 
+        uint32_t end, uint32_t* seed, real_t* result)
+{
+  real_t *px = x[0], *py = x[1];
+  const real_t ir = 1/(SR*SR), ib = 1/(SB*SB);
+  for(uint32_t k=begin; k<end; k++)
+  {
+    real_t dr = z[0] - blob::math::sqrtr(px[k]*px[k] + py[k]*py[k]);
+    real_t db = z[1] - blob::math::atan2(py[k], px[k]);
+    result[k] = -0.5f*(dr*dr*ir + db*db*ib);
+  }
+}
+
+void simulate()
+{
+  uint32_t seed = 12345;
+  real_t e[4];
+  real_t x[N] = { 5, 0, 0, 1 }; // circling-ish target around the sensor
+  for(int k=0; k<STEPS; k++)
+  {
+    blob::PF::gaussian(&seed, e, 4);
+    x[2] += SV*blob::math::sqrtr(T)*e[0];
+    x[3] += SV*blob::math::sqrtr(T)*e[1];
+    x[0] += T*x[2];
+    x[1] += T*x[3];
+    memcpy(truth[k], x, sizeof(x));
+    h(T, NULL, x, measurements[k]);
+    measurements[k][0] += SR*e[2];
+    measurements[k][1] += SB*e[3];
+  }
+}
+
+/**
+ * Runs filter over simulated measurements.
+ * \return  root mean square position error
+ */
+real_t run (blob::PF & pf, bool vectorized, double & seconds, real_t* x)
+{
+  bool result = true;
+  double sum = 0;
+  double t0 = now();
+  for(int k=0; (k<STEPS) && result; k++)
+  {
+    if(vectorized)
+    {
+      result &= pf.predict(&fv, T, NULL);
+      result &= pf.update(&hv, T, measurements[k]);
+    }
+    else
+    {
+      result &= pf.predict(&f, T, 0, NULL, q);
+      result &= pf.update(&h, T, M, measurements[k], r);
+    }
+    real_t dx = pf.getState()[0] - truth[k][0];
+    real_t dy = pf.getState()[1] - truth[k][1];
+    sum += dx*dx + dy*dy;
+  }
+  seconds = (now() - t0)/STEPS;
+  if(!result)
+    std::cerr << "[test] - filter error" << std::endl;
+  pf.getState(x);
+  return blob::math::sqrtr(sum/STEPS);
+}
+
+int main(int argc, char* argv[])
+{
+  real_t x0[N] = { 5, 0, 0, 1 };
+  real_t s0[N] = { 0.1, 0.1, 0.2, 0.2 };
+  real_t x1[N], x2[N], x3[N];
+  double t;
+
+  simulate();
+
+  // generic interface, per particle callbacks and gaussian noise models
+  blob::PF ref(N, x0, NP_REF, s0);
+  real_t e0 = run(ref, false, t, x1);
+  std::cout << "[test] - per particle: " << NP_REF << " particles, rmse=" 
+            << e0 << " m, " << 1e3*t << " ms/step, " 
+            << ref.getNumResamplings() << " resamplings" << std::endl;
+
+  // vectorized callbacks, caller thread only
+  blob::PF single(N, x0, NP, s0);
+  real_t e1 = run(single, true, t, x2);
+  std::cout << "[test] - vectorized: " << NP << " particles, rmse=" << e1 
+            << " m, " << 1e3*t << " ms/step, " << single.getNumResamplings() 
+            << " resamplings" << std::endl;
+
+  // same filter over worker pool: must reproduce caller only results
+  blob::Pool pool((argc > 1)? atoi(argv[1]) : 0);
+  blob::PF multi(N, x0, NP, s0);
+  multi.setPool(&pool);
+  real_t e2 = run(multi, true, t, x3);
+  std::cout << "[test] - vectorized: " << NP << " particles, " 
+            << (int)pool.getNumThreads() << " threads, rmse=" << e2 << " m, " 
+            << 1e3*t << " ms/step" << std::endl;
+  bool same = (memcmp(x2, x3, sizeof(x2)) == 0);
+  std::cout << "[test] - deterministic across threads: " << (same? "yes":"no")
+            << std::endl;
+
+  // stratified resampling, every step
+  blob::PF strat(N, x0, NP_REF, s0);
+  strat.setResampling(blob::PF_STRATIFIED, 1.1);
+  real_t e3 = run(strat, true, t, x1);
+  std::cout << "[test] - stratified: " << NP_REF << " particles, rmse=" << e3 
+            << " m, ess=" << strat.getEffectiveSampleSize() << std::endl;
+
+  strat.print();
+
+  return same? 0 : -1;
+}
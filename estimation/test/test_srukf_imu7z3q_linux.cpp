@@ -4,13 +4,16 @@
  * author: adrian jimenez-gonzalez
  * e-mail: blob.robotics@gmail.com
  /*************************************/
+
 #include <iostream>
 #include <sstream> 
 #include <fstream>
 #include <math.h>
+#include <time.h>
 
 #include <blob/math.h>
 #include <blob/srukf.h>
+#include <blob/ukf.h>
 
 #define N   7   // Number of states
 
@@ -23,45 +26,36 @@
 #define racc 0.1
 #define rmag 0.25
 
+#define SETTLE 100  // steps of initial transient from P = I, not compared
+
 #define qq_T   (qq*T)
-#define qbg_T  (qq*T)
+#define qbg_T  (qbg*T)
 #define racc_T (racc*Tacc)
 #define rmag_T (rmag*Tmag)
 
-typedef struct {
-  real_t u[3];
-  real_t dt;
-} fargs_t;
-
-typedef struct {
-  real_t dt;
-} hargs_t;
-
-void f(real_t *x, void *args, real_t * res)
+void f(const real_t& dt, real_t* u, real_t* x, real_t* res)
 {
   // x = [q0, q1, q2, q3, gbx, gby, gbz]
   // u = [gx, gy, gz]
 
-  fargs_t *fargs = (fargs_t *)args;
-  
   real_t q0 = x[0], q1 = x[1], q2 = x[2], q3 = x[3], gbx = x[4], gby = x[5], gbz = x[6];
 
-  real_t gx = fargs->u[0] - gbx; 
-  real_t gy = fargs->u[1] - gby; 
-  real_t gz = fargs->u[2] - gbz;
+  real_t gx = u[0] - gbx; 
+  real_t gy = u[1] - gby; 
+  real_t gz = u[2] - gbz;
 
   // predict new state (FRD)
 
-  res[0] = q0 + (-q1*gx - q2*gy - q3*gz)*fargs->dt/2;
-  res[1] = q1 + ( q0*gx + q3*gy - q2*gz)*fargs->dt/2;
-  res[2] = q2 + (-q3*gx + q0*gy + q1*gz)*fargs->dt/2;
-  res[3] = q3 + ( q2*gx - q1*gy + q0*gz)*fargs->dt/2;
+  res[0] = q0 + (-q1*gx - q2*gy - q3*gz)*dt/2;
+  res[1] = q1 + ( q0*gx + q3*gy - q2*gz)*dt/2;
+  res[2] = q2 + (-q3*gx + q0*gy + q1*gz)*dt/2;
+  res[3] = q3 + ( q2*gx - q1*gy + q0*gz)*dt/2;
   res[4] = gbx;
   res[5] = gby;
   res[6] = gbz;
 
   // re-normalize quaternion
-  real_t qnorm = blob::math::sqrt(res[0]*res[0] + res[1]*res[1] + res[2]*res[2] + res[3]*res[3]);
+  real_t qnorm = blob::math::sqrtr(res[0]*res[0] + res[1]*res[1] + res[2]*res[2] + res[3]*res[3]);
   res[0] = res[0]/qnorm;
   res[1] = res[1]/qnorm;
   res[2] = res[2]/qnorm;
@@ -69,10 +63,11 @@ void f(real_t *x, void *args, real_t * res)
 
 }
 
-void ha(real_t *x, void *args, real_t * res)
+void ha(const real_t& dt, real_t* arg, real_t* x, real_t* res)
 {
   // x = [q0, q1, q2, q3, gbx, gby, gbx]
   // z = [ax, ay, az]
+  // no args
 
   real_t q0 = x[0], q1 = x[1], q2 = x[2], q3 = x[3];
 
@@ -82,10 +77,11 @@ void ha(real_t *x, void *args, real_t * res)
   res[2] = -q0*q0 + q1*q1 + q2*q2 - q3*q3; // az
 }
 
-void hm(real_t *x, void *args, real_t * res)
+void hm(const real_t& dt, real_t* arg, real_t* x, real_t* res)
 {
   // x = [q0, q1, q2, q3, gbx, gby, gbx]
   // z = [mx, my, mz]
+  // no args
 
   real_t q0 = x[0], q1 = x[1], q2 = x[2], q3 = x[3];
 
@@ -96,32 +92,44 @@ void hm(real_t *x, void *args, real_t * res)
 
 }
 
-// covariance of process
-real_t  sq[] = { qq_T, 0,   0,   0,    0,    0,    0,      
-                 0,   qq_T, 0,   0,    0,    0,    0,     
-                 0,    0, qq_T,  0,    0,    0,    0,     
-                 0,    0,   0, qq_T,   0,    0,    0,    
-                 0,    0,   0,   0, qbg_T,   0,    0,    
-                 0,    0,   0,   0,    0, qbg_T,   0,    
-                 0,    0,   0,   0,    0,    0, qbg_T };
-
-// covariance of measurement
-real_t sa[] = { racc_T,   0,    0,
-                   0, racc_T,   0,
-                   0,     0, racc_T };
-
-// covariance of measurement
-real_t sm[] = { rmag_T,   0,     0, 
-                   0, rmag_T,    0,
-                   0,     0, rmag_T };
+// covariance square root of process
+real_t sq[] = { qq_T,  0,    0,    0,    0,     0,     0,      
+                 0,  qq_T,  0,    0,    0,     0,     0,     
+                 0,    0,  qq_T,  0,    0,     0,     0,     
+                 0,    0,    0,  qq_T,  0,     0,     0,    
+                 0,    0,    0,    0, qbg_T,   0,     0,    
+                 0,    0,    0,    0,    0,  qbg_T,   0,    
+                 0,    0,    0,    0,    0,     0, qbg_T };
+
+// covariance square root of measurement
+real_t sa[] = { racc_T,   0,      0,
+                   0,  racc_T,    0,
+                   0,     0,  racc_T };
+
+// covariance square root of measurement
+real_t sm[] = { rmag_T,   0,      0, 
+                   0,  rmag_T,    0,
+                   0,     0,  rmag_T };
+
+// covariances of UKF run for timing comparison
+real_t cq[N*N], ca[9], cm[9];
+
+double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
 
 int main(int argc, char* argv[])
 {
   bool result = true;
+
+  real_t  x[N] = {1,  0,  0,  0,  0,  0,  0};
+  real_t  u[3] = {0,  0, 0};    
   real_t za[3] = {0,  0, -1};
   real_t zm[3] = {0,  0,  0};
-  real_t x[N]  = {1,  0,  0,  0,  0,  0,  0};
-
+  
   if(argc == 3)
   {
     std::ifstream input_file (argv[1]);
@@ -136,8 +144,19 @@ int main(int argc, char* argv[])
         real_t ta = 0, tm = 0;
 
         blob::SRUKF srukf(N, x);
-        
-        fargs_t fargs;
+        blob::UKF ukf(N, x);
+
+        for(int i = 0; i < N*N; i++)
+          cq[i] = sq[i]*sq[i];
+        for(int i = 0; i < 9; i++)
+        {
+          ca[i] = sa[i]*sa[i];
+          cm[i] = sm[i]*sm[i];
+        }
+
+        long steps = 0;
+        double srukf_time = 0, ukf_time = 0, t0;
+        real_t z[3], error = 0;
 
         while ( getline (input_file,line) )
         {
@@ -154,12 +173,13 @@ int main(int argc, char* argv[])
             //else
             //  sscanf(line.c_str(),"%f %f %f %f %f %f %f %f %f"
             //                    , &gx, &gy, &gz, &ax, &ay, &az, &mx, &my, &mz);
+            steps++;
               
             ta += T; 
             tm += T;
 
             // normalise measurements
-            anorm = blob::math::sqrt(ax*ax + ay*ay + az*az);
+            anorm = blob::math::sqrtr(ax*ax + ay*ay + az*az);
             if (anorm > 0)
             {
               ax = ax/anorm;
@@ -167,7 +187,7 @@ int main(int argc, char* argv[])
               az = az/anorm;
             }
 
-            mnorm = blob::math::sqrt(mx*mx + my*my + mz*mz);
+            mnorm = blob::math::sqrtr(mx*mx + my*my + mz*mz);
             if (mnorm > 0)
             {
               mx = mx/mnorm;
@@ -175,16 +195,16 @@ int main(int argc, char* argv[])
               mz = mz/mnorm;
             }
 
-            fargs.u[0] = gx;
-            fargs.u[1] = gy;
-            fargs.u[2] = gz;
-            fargs.dt = T;
-
+            u[0] = gx;
+            u[1] = gy;
+            u[2] = gz;
+            
 #if defined(__DEBUG__) & defined(__linux__)
-            std::cout << "[test] - predicting over u=[" << fargs.u[0] << ", " << fargs.u[1] << 
-                         ", " << fargs.u[2] << "], dt=" << fargs.dt << std::endl;
+            std::cout << "[test] - predicting over u=[" << u[0] << ", " << u[1] << 
+                         ", " << u[2] << "], dt=" << T << std::endl;
 #endif
-            result &= srukf.predict(&f, &fargs, sq);
+            t0 = now();
+            result &= srukf.predict(&f, T, 3, u, sq);
 
             if ((result==true)&&(ta>=Tacc))
             {
@@ -193,8 +213,7 @@ int main(int argc, char* argv[])
             std::cout << "[test] - updating over za=[" << za[0] << ", " << za[1] << 
                          ", " << za[2] << "], dta=" << ta << std::endl;
 #endif
-              result &= srukf.update (&ha, NULL, 3, za, sa);
-              ta = 0;
+              result &= srukf.update (&ha, ta, 3, za, sa);
             }
             if ((result==true)&&(tm >= Tmag))
             {
@@ -203,18 +222,50 @@ int main(int argc, char* argv[])
             std::cout << "[test] - updating over zm=[" << zm[0] << ", " << zm[1] << 
                          ", " << zm[2] << "], dtm=" << tm << std::endl;
 #endif
-              result &= srukf.update (&hm, NULL, 3, zm, sm);
-              tm = 0;
+              result &= srukf.update (&hm, tm, 3, zm, sm);
             }
+            srukf_time += now() - t0;
+
+            // same steps with UKF, for timing comparison
+            t0 = now();
+            result &= ukf.predict(&f, T, 3, u, cq);
+            if ((result==true)&&(ta>=Tacc))
+            {
+              z[0] = ax; z[1] = ay; z[2] = az;
+              result &= ukf.update (&ha, ta, 3, z, ca);
+            }
+            if ((result==true)&&(tm >= Tmag))
+            {
+              z[0] = mx; z[1] = my; z[2] = mz;
+              result &= ukf.update (&hm, tm, 3, z, cm);
+            }
+            ukf_time += now() - t0;
+            if (ta >= Tacc)
+              ta = 0;
+            if (tm >= Tmag)
+              tm = 0;
 
             // re-normalize quaternion
             real_t *q = srukf.getState();
-            real_t qnorm = blob::math::sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+            real_t qnorm = blob::math::sqrtr(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
             q[0] = q[0]/qnorm;
             q[1] = q[1]/qnorm;
             q[2] = q[2]/qnorm;
             q[3] = q[3]/qnorm;
 
+            real_t *p = ukf.getState();
+            real_t pnorm = blob::math::sqrtr(p[0]*p[0] + p[1]*p[1] + p[2]*p[2] + p[3]*p[3]);
+            p[0] = p[0]/pnorm;
+            p[1] = p[1]/pnorm;
+            p[2] = p[2]/pnorm;
+            p[3] = p[3]/pnorm;
+
+            for(int i = 0; (steps > SETTLE) && (i < N); i++)
+            {
+              real_t e = blob::math::rabs(q[i] - p[i]);
+              error = (e > error)? e : error;
+            }
+
             roll = atan2(2*(q[0]*q[1] + q[2]*q[3]), 1 - 2*(q[1]*q[1] + q[2]*q[2]));
             pitch = asin(2*(q[0]*q[2] - q[1]*q[3]));
             yaw  = atan2(2*(q[0]*q[3] + q[1]*q[2]), 1 - 2*(q[2]*q[2] + q[3]*q[3]));
@@ -241,6 +292,18 @@ int main(int argc, char* argv[])
         }
         input_file.close();
         output_file.close();
+
+        std::cout << "[test] - " << steps << " steps" << std::endl;
+        std::cout << "[test] - UKF:   " << 1e6*ukf_time/steps << " us/step" 
+                  << std::endl;
+        std::cout << "[test] - SRUKF: " << 1e6*srukf_time/steps << " us/step" 
+                  << std::endl;
+        std::cout << "[test] - max |x_srukf - x_ukf| = " << error 
+                  << " (after " << SETTLE << " steps)" << std::endl;
+#if defined(BLOB_MATRIX_COUNTERS)
+        // flops, traffic and arithmetic intensity per filter phase
+        blob::Counters::dump(std::cout);
+#endif
       }
       else 
         std::cerr << "[test] - file i/o error: unable to open file " << argv[2] << std::endl;
@@ -253,4 +316,3 @@ int main(int argc, char* argv[])
   
   return 0;
 }
-
@@ -0,0 +1,237 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       test_ukf_batch_imu7z3q_linux.cpp
+ * \brief      test for ukf library with batch model functions that transform
+ *             all sigma points at once, compared with per point functions 
+ *             over the same imu dataset (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <blob/ukf.h>
+
+#include "imu7z3q.h"
+
+#define REPEAT 100  // model transform timing repetitions per timed sample
+#define TIMED  100  // model transforms are timed every TIMED samples
+
+// batch versions: every loop runs over points with unit stride, so that the 
+// compiler maps 8 (float) or 4 (double) points to each AVX instruction. Input
+// and result rows never overlap (ivdep), and the number of points is copied 
+// to a local, otherwise stores to res could change the loop count
+
+void fb(const real_t& dt, real_t* u, const real_t* x, real_t* res,
+        const uint8_t& npoints, const uint8_t& stride)
+{
+  const real_t *q0 = x, *q1 = x + stride, *q2 = x + 2*stride, 
+               *q3 = x + 3*stride, *gbx = x + 4*stride, *gby = x + 5*stride,
+               *gbz = x + 6*stride;
+  real_t *r0 = res, *r1 = res + stride, *r2 = res + 2*stride, 
+         *r3 = res + 3*stride, *r4 = res + 4*stride, *r5 = res + 5*stride,
+         *r6 = res + 6*stride;
+  real_t h = dt/2, ux = u[0], uy = u[1], uz = u[2];
+  int s = npoints;
+
+#pragma GCC ivdep
+  for(int k = 0; k < s; k++)
+  {
+    real_t gx = ux - gbx[k];
+    real_t gy = uy - gby[k];
+    real_t gz = uz - gbz[k];
+
+    // predict new state (FRD)
+    real_t a0 = q0[k] + (-q1[k]*gx - q2[k]*gy - q3[k]*gz)*h;
+    real_t a1 = q1[k] + ( q0[k]*gx + q3[k]*gy - q2[k]*gz)*h;
+    real_t a2 = q2[k] + (-q3[k]*gx + q0[k]*gy + q1[k]*gz)*h;
+    real_t a3 = q3[k] + ( q2[k]*gx - q1[k]*gy + q0[k]*gz)*h;
+
+    // re-normalize quaternion
+    real_t qnorm = blob::math::sqrtr(a0*a0 + a1*a1 + a2*a2 + a3*a3);
+    r0[k] = a0/qnorm;
+    r1[k] = a1/qnorm;
+    r2[k] = a2/qnorm;
+    r3[k] = a3/qnorm;
+    r4[k] = gbx[k];
+    r5[k] = gby[k];
+    r6[k] = gbz[k];
+  }
+}
+
+void hab(const real_t& dt, real_t* arg, const real_t* x, real_t* res,
+         const uint8_t& npoints, const uint8_t& stride)
+{
+  const real_t *q0 = x, *q1 = x + stride, *q2 = x + 2*stride, 
+               *q3 = x + 3*stride;
+  real_t *ax = res, *ay = res + stride, *az = res + 2*stride;
+  int s = npoints;
+
+  // estimated direction of gravity (NED)
+#pragma GCC ivdep
+  for(int k = 0; k < s; k++)
+  {
+    ax[k] =  2*(q0[k]*q2[k] - q1[k]*q3[k]);
+    ay[k] = -2*(q0[k]*q1[k] + q2[k]*q3[k]);
+    az[k] = -q0[k]*q0[k] + q1[k]*q1[k] + q2[k]*q2[k] - q3[k]*q3[k];
+  }
+}
+
+void hmb(const real_t& dt, real_t* arg, const real_t* x, real_t* res,
+         const uint8_t& npoints, const uint8_t& stride)
+{
+  const real_t *q0 = x, *q1 = x + stride, *q2 = x + 2*stride, 
+               *q3 = x + 3*stride;
+  real_t *mx = res, *my = res + stride, *mz = res + 2*stride;
+  int s = npoints;
+
+  // estimated direction of flux (NED)
+#pragma GCC ivdep
+  for(int k = 0; k < s; k++)
+  {
+    mx[k] = q0[k]*q0[k] + q1[k]*q1[k] - q2[k]*q2[k] - q3[k]*q3[k];
+    my[k] = 2*(q1[k]*q2[k] - q0[k]*q3[k]);
+    mz[k] = 2*(q0[k]*q2[k] + q1[k]*q3[k]);
+  }
+}
+
+/**
+ * Times the three model transforms over a full set of 2n+1 sigma points, 
+ * per point (copying each column as UKF::ut() does) and batch.
+ */
+void timeTransforms (blob::UKF & ukf, real_t* u, double & point_time, 
+                     double & batch_time)
+{
+  const int s = 2*N+1;
+  BLOB_MATRIX_ALIGNED real_t X[N*s], Y[N*s], in[N], out[N];
+
+  // called through pointers as the filter does, so they are not inlined
+  blob::estimator_function_t volatile fp = &f, hap = &ha, hmp = &hm;
+  blob::estimator_batch_function_t volatile fbp = &fb, habp = &hab, 
+                                            hmbp = &hmb;
+
+  // deterministic spread of points around current state
+  for(int i = 0; i < N; i++)
+  #pragma GCC ivdep
+  for(int k = 0; k < s; k++)
+      X[i*s + k] = ukf.getState(i) + 0.01*((k % N == i)? 1:-0.5);
+
+  double t0 = now();
+  for(int r = 0; r < REPEAT; r++)
+  {
+  #pragma GCC ivdep
+  for(int k = 0; k < s; k++)
+    {
+      for(int i = 0; i < N; i++)
+        in[i] = X[i*s + k];
+      fp(T, u, in, out);
+      for(int i = 0; i < N; i++)
+        Y[i*s + k] = out[i];
+      hap(Tacc, NULL, in, out);
+      for(int i = 0; i < 3; i++)
+        Y[i*s + k] = out[i];
+      hmp(Tmag, NULL, in, out);
+      for(int i = 0; i < 3; i++)
+        Y[i*s + k] = out[i];
+    }
+  }
+  double t1 = now();
+  for(int r = 0; r < REPEAT; r++)
+  {
+    fbp(T, u, X, Y, s, s);
+    habp(Tacc, NULL, X, Y, s, s);
+    hmbp(Tmag, NULL, X, Y, s, s);
+  }
+  double t2 = now();
+  point_time += (t1 - t0)/REPEAT;
+  batch_time += (t2 - t1)/REPEAT;
+}
+
+int main(int argc, char* argv[])
+{
+  bool result = true;
+
+  real_t x[N] = {1,  0,  0,  0,  0,  0,  0};
+  real_t z[3];
+  Imu7z3q data;
+
+  if (!data.open(argc, argv))
+    return 0;
+
+  blob::UKF ukf(N, x);    // per point functions
+  blob::UKF bukf(N, x);   // batch functions
+
+  long timed = 0;
+  double ukf_time = 0, bukf_time = 0, point_time = 0, batch_time = 0;
+  double t0;
+  real_t error = 0;
+
+  while (data.next())
+  {
+    t0 = now();
+    result &= step(ukf, data);
+    ukf_time += now() - t0;
+
+    t0 = now();
+    result &= bukf.predict(&fb, T, 3, data.u, q);
+    if (data.update_acc)
+    {
+      memcpy(z, data.za, sizeof(z));
+      result &= bukf.update (&hab, Tacc, 3, z, ra);
+    }
+    if (data.update_mag)
+    {
+      memcpy(z, data.zm, sizeof(z));
+      result &= bukf.update (&hmb, Tmag, 3, z, rm);
+    }
+    bukf_time += now() - t0;
+
+    if ((data.steps % TIMED) == 0)
+    {
+      timeTransforms(bukf, data.u, point_time, batch_time);
+      timed++;
+    }
+
+    real_t e = difference(bukf.getState(), ukf.getState());
+    error = (e > error)? e : error;
+    data.write(bukf.getState());
+
+    if (result == false)
+    {
+      std::cerr << "[test] - filter error at step " << data.steps << std::endl;
+      return -1;
+    }
+  }
+
+  std::cout << "[test] - " << data.steps << " steps, transforms timed at " 
+            << timed << std::endl;
+  std::cout << "[test] - per point functions: " 
+            << 1e6*ukf_time/data.steps << " us/step, transforms " 
+            << 1e9*point_time/timed << " ns" << std::endl;
+  std::cout << "[test] - batch functions:     " 
+            << 1e6*bukf_time/data.steps << " us/step, transforms " 
+            << 1e9*batch_time/timed << " ns" << std::endl;
+  std::cout << "[test] - max |x_batch - x_point| = " << error << std::endl;
+  
+  return 0;
+}
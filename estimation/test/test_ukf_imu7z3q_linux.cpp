@@ -74,7 +74,7 @@ void f(const real_t& dt, real_t* u, real_t* x, real_t* res)
   res[6] = gbz;
 
   // re-normalize quaternion
-  real_t qnorm = blob::math::sqrt(res[0]*res[0] + res[1]*res[1] + res[2]*res[2] + res[3]*res[3]);
+  real_t qnorm = blob::math::sqrtr(res[0]*res[0] + res[1]*res[1] + res[2]*res[2] + res[3]*res[3]);
   res[0] = res[0]/qnorm;
   res[1] = res[1]/qnorm;
   res[2] = res[2]/qnorm;
@@ -174,7 +174,7 @@ int main(int argc, char* argv[])
             tm += T;
 
             // normalise measurements
-            anorm = blob::math::sqrt(ax*ax + ay*ay + az*az);
+            anorm = blob::math::sqrtr(ax*ax + ay*ay + az*az);
             if (anorm > 0)
             {
               ax = ax/anorm;
@@ -182,7 +182,7 @@ int main(int argc, char* argv[])
               az = az/anorm;
             }
 
-            mnorm = blob::math::sqrt(mx*mx + my*my + mz*mz);
+            mnorm = blob::math::sqrtr(mx*mx + my*my + mz*mz);
             if (mnorm > 0)
             {
               mx = mx/mnorm;
@@ -223,7 +223,7 @@ int main(int argc, char* argv[])
 
             // re-normalize quaternion
             real_t *q = ukf.getState();
-            real_t qnorm = blob::math::sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+            real_t qnorm = blob::math::sqrtr(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
             q[0] = q[0]/qnorm;
             q[1] = q[1]/qnorm;
             q[2] = q[2]/qnorm;
@@ -255,6 +255,10 @@ int main(int argc, char* argv[])
         }
         input_file.close();
         output_file.close();
+#if defined(BLOB_MATRIX_COUNTERS)
+        // flops, traffic and arithmetic intensity per filter phase
+        blob::Counters::dump(std::cout);
+#endif
       }
       else 
         std::cerr << "[test] - file i/o error: unable to open file " << argv[2] << std::endl;
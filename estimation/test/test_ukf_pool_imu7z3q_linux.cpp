@@ -0,0 +1,145 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       test_ukf_pool_imu7z3q_linux.cpp
+ * \brief      test for ukf library evaluating an expensive process model in
+ *             parallel over a worker pool, compared with serial evaluation
+ *             over the same imu dataset (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <cstdlib>
+
+#include <blob/ukf.h>
+#include <blob/pool.h>
+
+#include "imu7z3q.h"
+
+#define SUBSTEPS 500  // integration substeps of process model
+#define STEPS    2000 // dataset samples to process
+
+void fs(const real_t& dt, real_t* u, real_t* x, real_t* res)
+{
+  // x = [q0, q1, q2, q3, gbx, gby, gbz]
+  // u = [gx, gy, gz]
+  // quaternion kinematics integrated in SUBSTEPS steps, standing for the 
+  // short physics integrations of expensive models
+
+  real_t q0 = x[0], q1 = x[1], q2 = x[2], q3 = x[3];
+  real_t gx = u[0] - x[4];
+  real_t gy = u[1] - x[5];
+  real_t gz = u[2] - x[6];
+  real_t h = dt/(2*SUBSTEPS);
+
+  for(int s = 0; s < SUBSTEPS; s++)
+  {
+    real_t a0 = q0 + (-q1*gx - q2*gy - q3*gz)*h;
+    real_t a1 = q1 + ( q0*gx + q3*gy - q2*gz)*h;
+    real_t a2 = q2 + (-q3*gx + q0*gy + q1*gz)*h;
+    real_t a3 = q3 + ( q2*gx - q1*gy + q0*gz)*h;
+
+    // re-normalize quaternion
+    real_t qnorm = blob::math::sqrtr(a0*a0 + a1*a1 + a2*a2 + a3*a3);
+    q0 = a0/qnorm;
+    q1 = a1/qnorm;
+    q2 = a2/qnorm;
+    q3 = a3/qnorm;
+  }
+
+  res[0] = q0;
+  res[1] = q1;
+  res[2] = q2;
+  res[3] = q3;
+  res[4] = x[4];
+  res[5] = x[5];
+  res[6] = x[6];
+}
+
+int main(int argc, char* argv[])
+{
+  bool result = true;
+
+  real_t x[N] = {1,  0,  0,  0,  0,  0,  0};
+  Imu7z3q data;
+
+  if (!data.open(argc, argv, 1, " [threads]"))
+    return 0;
+
+  int nthreads = (argc == 4)? atoi(argv[3]) : 4;
+
+  blob::Pool pool(nthreads);
+  blob::UKF ukf(N, x);    // serial
+  blob::UKF pukf(N, x);   // process model over pool, sensors serial
+  blob::UKF aukf(N, x);   // all functions over pool (threshold 0)
+  pukf.setPool(&pool);
+  aukf.setPool(&pool, 0);
+
+  double ukf_time = 0, pukf_time = 0, aukf_time = 0, t0;
+  bool identical = true;
+
+  while ((data.steps < STEPS) && data.next())
+  {
+    t0 = now();
+    result &= step(ukf, data, &fs);
+    ukf_time += now() - t0;
+
+    t0 = now();
+    result &= step(pukf, data, &fs);
+    pukf_time += now() - t0;
+
+    t0 = now();
+    result &= step(aukf, data, &fs);
+    aukf_time += now() - t0;
+
+    // evaluation order must not change results
+    for(int i = 0; i < N; i++)
+    {
+      identical &= (pukf.getState(i) == ukf.getState(i));
+      identical &= (aukf.getState(i) == ukf.getState(i));
+    }
+    data.write(pukf.getState());
+
+    if (result == false)
+    {
+      std::cerr << "[test] - filter error at step " << data.steps << std::endl;
+      return -1;
+    }
+  }
+
+  std::cout << "[test] - " << data.steps << " steps, " 
+            << (int)pool.getNumThreads() << " threads" << std::endl;
+  std::cout << "[test] - serial:            " << 1e6*ukf_time/data.steps 
+            << " us/step" << std::endl;
+  std::cout << "[test] - pool (threshold):  " << 1e6*pukf_time/data.steps 
+            << " us/step" << std::endl;
+  std::cout << "[test] - pool (always):     " << 1e6*aukf_time/data.steps 
+            << " us/step" << std::endl;
+  std::cout << "[test] - states " << (identical? "identical":"DIFFER")
+            << std::endl;
+  if(!identical)
+    return -1;
+  
+  return 0;
+}
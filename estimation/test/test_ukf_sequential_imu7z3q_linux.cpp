@@ -0,0 +1,166 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       test_ukf_sequential_imu7z3q_linux.cpp
+ * \brief      test for ukf library sequential scalar updates with diagonal
+ *             measurement noise and innovation gating, compared with joint 
+ *             updates over the same imu dataset (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <blob/ukf.h>
+
+#include "imu7z3q.h"
+
+#define OUTLIER 97   // every OUTLIER-th accelerometer sample is corrupted
+#define GATE    100  // innovation gate [std. dev.], ra and rm are tuned far
+                     // below actual sensor noise
+#define SETTLE  100  // steps of initial transient from P = I, not compared
+
+/**
+ * Updates filter with accelerometer and magnetometer measurements if due,
+ * accumulating update time.
+ */
+bool update (blob::UKF & ukf, bool update_acc, const real_t* za, 
+             bool update_mag, const real_t* zm, double & time)
+{
+  bool result = true;
+  real_t z[3];
+  double t0 = now();
+  if (update_acc)
+  {
+    memcpy(z, za, sizeof(z));
+    result &= ukf.update (&ha, Tacc, 3, z, ra);
+  }
+  if (update_mag)
+  {
+    memcpy(z, zm, sizeof(z));
+    result &= ukf.update (&hm, Tmag, 3, z, rm);
+  }
+  time += now() - t0;
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  bool result = true;
+
+  real_t x[N] = {1,  0,  0,  0,  0,  0,  0};
+  real_t zo[3];
+  Imu7z3q data;
+
+  if (!data.open(argc, argv))
+    return 0;
+
+  blob::UKF ukf(N, x);    // joint updates
+  blob::UKF sukf(N, x);   // sequential updates
+  blob::UKF jukf(N, x);   // joint updates with outliers
+  blob::UKF oukf(N, x);   // sequential updates with outliers
+  blob::UKF gukf(N, x);   // sequential gated updates with outliers
+  sukf.setSequential(true);
+  oukf.setSequential(true);
+  gukf.setSequential(true, GATE);
+
+  long outliers = 0, rejections = 0, false_rejections = 0;
+  double ukf_time = 0, sukf_time = 0, aux_time = 0;
+  real_t error = 0, jerror = 0, oerror = 0, gerror = 0;
+
+  while (data.next())
+  {
+    bool update_acc = data.update_acc, update_mag = data.update_mag;
+    bool outlier = update_acc && ((data.steps % OUTLIER) == 0);
+
+    // corrupted accelerometer: spike on x axis
+    memcpy(zo, data.za, sizeof(zo));
+    if (outlier)
+    {
+      zo[0] += 0.5;
+      outliers++;
+    }
+
+    result &= ukf.predict(&f, T, 3, data.u, q);
+    result &= sukf.predict(&f, T, 3, data.u, q);
+    result &= jukf.predict(&f, T, 3, data.u, q);
+    result &= oukf.predict(&f, T, 3, data.u, q);
+    result &= gukf.predict(&f, T, 3, data.u, q);
+
+    result &= update(ukf, update_acc, data.za, update_mag, data.zm, ukf_time);
+    result &= update(sukf, update_acc, data.za, update_mag, data.zm, 
+                     sukf_time);
+    result &= update(jukf, update_acc, zo, update_mag, data.zm, aux_time);
+    result &= update(oukf, update_acc, zo, update_mag, data.zm, aux_time);
+    if (update_acc)
+    {
+      result &= update(gukf, true, zo, false, data.zm, aux_time);
+      rejections += gukf.getRejections();
+      if (!outlier)
+        false_rejections += gukf.getRejections();
+    }
+    if (update_mag)
+    {
+      result &= update(gukf, false, zo, true, data.zm, aux_time);
+      rejections += gukf.getRejections();
+      false_rejections += gukf.getRejections();
+    }
+
+    // different approximations: compare once converged; filters with 
+    // outliers are compared with the same filter on clean measurements
+    if (data.steps > SETTLE)
+    {
+      real_t e = difference(sukf.getState(), ukf.getState());
+      error = (e > error)? e : error;
+      e = difference(jukf.getState(), ukf.getState());
+      jerror = (e > jerror)? e : jerror;
+      e = difference(oukf.getState(), sukf.getState());
+      oerror = (e > oerror)? e : oerror;
+      e = difference(gukf.getState(), sukf.getState());
+      gerror = (e > gerror)? e : gerror;
+    }
+
+    data.write(sukf.getState());
+
+    if (result == false)
+    {
+      std::cerr << "[test] - filter error at step " << data.steps << std::endl;
+      return -1;
+    }
+  }
+
+  std::cout << "[test] - " << data.steps << " steps" << std::endl;
+  std::cout << "[test] - joint updates:      " << 1e6*ukf_time/data.steps 
+            << " us/step" << std::endl;
+  std::cout << "[test] - sequential updates: " << 1e6*sukf_time/data.steps 
+            << " us/step" << std::endl;
+  std::cout << "[test] - max |x_sequential - x_joint| = " << error 
+            << " (after " << SETTLE << " steps)" << std::endl;
+  std::cout << "[test] - " << outliers << " outliers, " << rejections 
+            << " components rejected, " << false_rejections 
+            << " of clean samples" << std::endl;
+  std::cout << "[test] - outliers, max |x - x_clean| (after " << SETTLE 
+            << " steps): joint " << jerror << ", sequential " << oerror 
+            << ", sequential gated " << gerror << std::endl;
+  
+  return 0;
+}
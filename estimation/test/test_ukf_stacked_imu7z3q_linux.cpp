@@ -0,0 +1,126 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       test_ukf_stacked_imu7z3q_linux.cpp
+ * \brief      test for ukf library stacked updates of sensors sampled at the
+ *             same time, compared with one update per sensor over the same
+ *             imu dataset (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <blob/ukf.h>
+
+#include "imu7z3q.h"
+
+#define SETTLE 100  // steps of initial transient from P = I, not compared
+
+/**
+ * Updates filter with accelerometer and magnetometer measurements if due,
+ * stacking both in a single update if stack is true, and accumulating update
+ * time.
+ */
+bool update (blob::UKF & ukf, bool stack, const Imu7z3q & data, double & time)
+{
+  bool result = true;
+  real_t z[6];
+  double t0 = now();
+  if (stack && data.update_acc && data.update_mag)
+  {
+    blob::estimator_function_t h[2] = {&ha, &hm};
+    uint8_t m[2] = {3, 3};
+    real_t* r[2] = {ra, rm};
+    memcpy(z, data.za, 3*sizeof(real_t));
+    memcpy(&z[3], data.zm, 3*sizeof(real_t));
+    result &= ukf.update (2, h, Tacc, m, z, r);
+  }
+  else
+    result &= update(ukf, data);
+  time += now() - t0;
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  bool result = true;
+
+  real_t x[N] = {1,  0,  0,  0,  0,  0,  0};
+  Imu7z3q data;
+
+  if (!data.open(argc, argv))
+    return 0;
+
+  blob::UKF ukf(N, x);    // one update per sensor
+  blob::UKF sukf(N, x);   // stacked updates
+  blob::UKF qukf(N, x);   // stacked sequential scalar updates
+  qukf.setSequential(true);
+
+  long stacked = 0;
+  double ukf_time = 0, sukf_time = 0, qukf_time = 0;
+  real_t error = 0, qerror = 0;
+
+  while (data.next())
+  {
+    if (data.update_acc && data.update_mag)
+      stacked++;
+
+    result &= ukf.predict(&f, T, 3, data.u, q);
+    result &= sukf.predict(&f, T, 3, data.u, q);
+    result &= qukf.predict(&f, T, 3, data.u, q);
+
+    result &= update(ukf, false, data, ukf_time);
+    result &= update(sukf, true, data, sukf_time);
+    result &= update(qukf, true, data, qukf_time);
+
+    // different approximations: compare once converged
+    real_t e = (data.steps > SETTLE)? 
+               difference(sukf.getState(), ukf.getState()) : 0;
+    error = (e > error)? e : error;
+    e = difference(qukf.getState(), sukf.getState());
+    qerror = (e > qerror)? e : qerror;
+
+    data.write(sukf.getState());
+
+    if (result == false)
+    {
+      std::cerr << "[test] - filter error at step " << data.steps << std::endl;
+      return -1;
+    }
+  }
+
+  std::cout << "[test] - " << data.steps << " steps, " << stacked 
+            << " with both sensors" << std::endl;
+  std::cout << "[test] - one update per sensor: " << 1e6*ukf_time/data.steps 
+            << " us/step" << std::endl;
+  std::cout << "[test] - stacked updates:       " << 1e6*sukf_time/data.steps 
+            << " us/step" << std::endl;
+  std::cout << "[test] - stacked sequential:    " << 1e6*qukf_time/data.steps 
+            << " us/step" << std::endl;
+  std::cout << "[test] - max |x_stacked - x_per_sensor| = " << error 
+            << " (after " << SETTLE << " steps)" << std::endl;
+  std::cout << "[test] - max |x_stacked_sequential - x_stacked| = " 
+            << qerror << std::endl;
+  
+  return 0;
+}
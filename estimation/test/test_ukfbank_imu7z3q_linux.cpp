@@ -0,0 +1,249 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       test_ukfbank_imu7z3q_linux.cpp
+ * \brief      test for bank of ukf filters processed in lockstep, compared 
+ *             with one ukf object per filter over the same imu dataset, with
+ *             different gyroscope offsets per filter and magnetometer on 
+ *             half of them (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <vector>
+
+#include <blob/ukf.h>
+#include <blob/ukfn.h>
+#include <blob/ukfbank.h>
+
+#include "imu7z3q.h"
+
+#define FILTERS 1024 // number of filters
+#define STEPS   500  // number of dataset samples processed
+#define OFFSET  0.002 // gyroscope offset step between filters [rad/s]
+
+// block versions: every loop runs over filters with unit stride, so that the 
+// compiler maps several filters to each vector instruction. Input and result
+// rows never overlap (ivdep), and the number of filters is copied to a local,
+// otherwise stores to res could change the loop count
+
+void fk(const real_t& dt, const real_t* u, const real_t* x, real_t* res, 
+        const uint16_t& count, const uint16_t& stride)
+{
+  const real_t *q0 = x, *q1 = x + stride, *q2 = x + 2*stride, 
+               *q3 = x + 3*stride, *gbx = x + 4*stride, *gby = x + 5*stride,
+               *gbz = x + 6*stride;
+  const real_t *ux = u, *uy = u + stride, *uz = u + 2*stride;
+  real_t *r0 = res, *r1 = res + stride, *r2 = res + 2*stride, 
+         *r3 = res + 3*stride, *r4 = res + 4*stride, *r5 = res + 5*stride,
+         *r6 = res + 6*stride;
+  real_t h = dt/2;
+  int s = count;
+
+#pragma GCC ivdep
+  for(int w = 0; w < s; w++)
+  {
+    real_t gx = ux[w] - gbx[w]; 
+    real_t gy = uy[w] - gby[w]; 
+    real_t gz = uz[w] - gbz[w];
+
+    // predict new state (FRD)
+    real_t a0 = q0[w] + (-q1[w]*gx - q2[w]*gy - q3[w]*gz)*h;
+    real_t a1 = q1[w] + ( q0[w]*gx + q3[w]*gy - q2[w]*gz)*h;
+    real_t a2 = q2[w] + (-q3[w]*gx + q0[w]*gy + q1[w]*gz)*h;
+    real_t a3 = q3[w] + ( q2[w]*gx - q1[w]*gy + q0[w]*gz)*h;
+
+    // re-normalize quaternion
+    real_t qnorm = blob::math::sqrtr(a0*a0 + a1*a1 + a2*a2 + a3*a3);
+    r0[w] = a0/qnorm;
+    r1[w] = a1/qnorm;
+    r2[w] = a2/qnorm;
+    r3[w] = a3/qnorm;
+    r4[w] = gbx[w];
+    r5[w] = gby[w];
+    r6[w] = gbz[w];
+  }
+}
+
+void hak(const real_t& dt, const real_t* arg, const real_t* x, real_t* res, 
+         const uint16_t& count, const uint16_t& stride)
+{
+  const real_t *q0 = x, *q1 = x + stride, *q2 = x + 2*stride, 
+               *q3 = x + 3*stride;
+  real_t *ax = res, *ay = res + stride, *az = res + 2*stride;
+  int s = count;
+
+  // estimated direction of gravity (NED)
+#pragma GCC ivdep
+  for(int w = 0; w < s; w++)
+  {
+    ax[w] =  2*(q0[w]*q2[w] - q1[w]*q3[w]);
+    ay[w] = -2*(q0[w]*q1[w] + q2[w]*q3[w]);
+    az[w] = -q0[w]*q0[w] + q1[w]*q1[w] + q2[w]*q2[w] - q3[w]*q3[w];
+  }
+}
+
+void hmk(const real_t& dt, const real_t* arg, const real_t* x, real_t* res, 
+         const uint16_t& count, const uint16_t& stride)
+{
+  const real_t *q0 = x, *q1 = x + stride, *q2 = x + 2*stride, 
+               *q3 = x + 3*stride;
+  real_t *mx = res, *my = res + stride, *mz = res + 2*stride;
+  int s = count;
+
+  // estimated direction of flux (NED)
+#pragma GCC ivdep
+  for(int w = 0; w < s; w++)
+  {
+    mx[w] = q0[w]*q0[w] + q1[w]*q1[w] - q2[w]*q2[w] - q3[w]*q3[w];
+    my[w] = 2*(q1[w]*q2[w] - q0[w]*q3[w]);
+    mz[w] = 2*(q0[w]*q2[w] + q1[w]*q3[w]);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  bool result = true;
+
+  real_t x[N] = {1,  0,  0,  0,  0,  0,  0};
+  real_t z[3];
+  Imu7z3q data;
+
+  if (!data.open(argc, argv))
+    return 0;
+
+  std::vector<blob::UKF*> ukf(FILTERS);
+  std::vector<blob::UKFN<N,3>*> ukfn(FILTERS);
+  for(int k = 0; k < FILTERS; k++)
+  {
+    ukf[k] = new blob::UKF(N, x);
+    ukfn[k] = new blob::UKFN<N,3>(x);
+  }
+  blob::UKFBank<N,3> bank(FILTERS, x);
+
+  // inputs and measurements of all filters (K x 3)
+  std::vector<real_t> u(3*FILTERS), za(3*FILTERS), zm(3*FILTERS);
+  std::vector<uint8_t> mask(FILTERS);
+  for(int k = 0; k < FILTERS; k++)
+    mask[k] = (k%2 == 0);
+
+  double ukf_time = 0, ukfn_time = 0, bank_time = 0;
+
+  while ((data.steps < STEPS) && data.next())
+  {
+    bool update_acc = data.update_acc, update_mag = data.update_mag;
+
+    for(int k = 0; k < FILTERS; k++)
+    {
+      real_t o = OFFSET*(k%9 - 4);
+      u[3*k] = data.u[0] + o; u[3*k+1] = data.u[1] - o; 
+      u[3*k+2] = data.u[2] + o;
+      memcpy(&za[3*k], data.za, 3*sizeof(real_t));
+      memcpy(&zm[3*k], data.zm, 3*sizeof(real_t));
+    }
+
+    // one object per filter
+    double t0 = now();
+    for(int k = 0; k < FILTERS; k++)
+    {
+      result &= ukf[k]->predict(&f, T, 3, &u[3*k], q);
+      if (update_acc)
+      {
+        memcpy(z, &za[3*k], 3*sizeof(real_t));
+        result &= ukf[k]->update(&ha, Tacc, 3, z, ra);
+      }
+      if (update_mag && mask[k])
+      {
+        memcpy(z, &zm[3*k], 3*sizeof(real_t));
+        result &= ukf[k]->update(&hm, Tmag, 3, z, rm);
+      }
+    }
+    double t1 = now();
+    for(int k = 0; k < FILTERS; k++)
+    {
+      result &= ukfn[k]->predict(&f, T, 3, &u[3*k], q);
+      if (update_acc)
+      {
+        memcpy(z, &za[3*k], 3*sizeof(real_t));
+        result &= ukfn[k]->update(&ha, Tacc, 3, z, ra);
+      }
+      if (update_mag && mask[k])
+      {
+        memcpy(z, &zm[3*k], 3*sizeof(real_t));
+        result &= ukfn[k]->update(&hm, Tmag, 3, z, rm);
+      }
+    }
+    double t2 = now();
+
+    // bank of filters in lockstep
+    result &= bank.predict(&fk, T, 3, &u[0], q);
+    if (update_acc)
+      result &= bank.update(&hak, Tacc, 3, &za[0], ra);
+    if (update_mag)
+      result &= bank.update(&hmk, Tmag, 3, &zm[0], rm, &mask[0]);
+    double t3 = now();
+
+    ukf_time += t1 - t0;
+    ukfn_time += t2 - t1;
+    bank_time += t3 - t2;
+
+    real_t state[N];
+    bank.getState(1, state);
+    data.write(state);
+
+    if (result == false)
+    {
+      std::cerr << "[test] - filter error at step " << data.steps << std::endl;
+      return -1;
+    }
+  }
+
+  real_t error = 0, nerror = 0;
+  for(int k = 0; k < FILTERS; k++)
+  {
+    real_t state[N];
+    bank.getState(k, state);
+    real_t e = difference(state, ukf[k]->getState());
+    error = (e > error)? e : error;
+    e = difference(state, ukfn[k]->getState());
+    nerror = (e > nerror)? e : nerror;
+    delete ukf[k];
+    delete ukfn[k];
+  }
+
+  double n = (double)FILTERS*data.steps;
+  std::cout << "[test] - " << FILTERS << " filters, " << data.steps 
+            << " steps" << std::endl;
+  std::cout << "[test] - UKF objects:    " << 1e9*ukf_time/n 
+            << " ns/filter/step" << std::endl;
+  std::cout << "[test] - UKFN objects:   " << 1e9*ukfn_time/n 
+            << " ns/filter/step" << std::endl;
+  std::cout << "[test] - UKFBank:        " << 1e9*bank_time/n
+            << " ns/filter/step (x" << ukf_time/bank_time 
+            << " UKF, x" << ukfn_time/bank_time << " UKFN)" << std::endl;
+  std::cout << "[test] - max |x_bank - x_ukf| = " << error << std::endl;
+  std::cout << "[test] - max |x_bank - x_ukfn| = " << nerror << std::endl;
+  
+  return 0;
+}
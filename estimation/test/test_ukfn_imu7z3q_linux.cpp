@@ -0,0 +1,82 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       test_ukfn_imu7z3q_linux.cpp
+ * \brief      test for ukf with dimensions fixed at compile time, compared 
+ *             with ukf over the same imu dataset (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <blob/ukf.h>
+#include <blob/ukfn.h>
+
+#include "imu7z3q.h"
+
+int main(int argc, char* argv[])
+{
+  bool result = true;
+
+  real_t x[N] = {1,  0,  0,  0,  0,  0,  0};
+  Imu7z3q data;
+
+  if (!data.open(argc, argv))
+    return 0;
+
+  blob::UKF ukf(N, x);
+  blob::UKFN<N,3> ukfn(x);
+
+  double ukf_time = 0, ukfn_time = 0, t0;
+  real_t error = 0;
+
+  while (data.next())
+  {
+    t0 = now();
+    result &= step(ukf, data);
+    ukf_time += now() - t0;
+
+    t0 = now();
+    result &= step(ukfn, data);
+    ukfn_time += now() - t0;
+
+    real_t e = difference(ukfn.getState(), ukf.getState());
+    error = (e > error)? e : error;
+    data.write(ukfn.getState());
+
+    if (result == false)
+    {
+      std::cerr << "[test] - filter error at step " << data.steps << std::endl;
+      return -1;
+    }
+  }
+
+  std::cout << "[test] - " << data.steps << " steps" << std::endl;
+  std::cout << "[test] - UKF:       " << 1e6*ukf_time/data.steps 
+            << " us/step, " << sizeof(ukf) << " bytes" << std::endl;
+  std::cout << "[test] - UKFN<7,3>: " << 1e6*ukfn_time/data.steps 
+            << " us/step, " << sizeof(ukfn) << " bytes" << std::endl;
+  std::cout << "[test] - max |x_ukfn - x_ukf| = " << error << std::endl;
+  
+  return 0;
+}
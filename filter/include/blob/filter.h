@@ -41,7 +41,10 @@ namespace blob {
 class Filter
 {
   public:
-    
+    /**
+     * Initializes filter output.
+     */
+    Filter () : _output(0) {}
     /**
      * Adds a sample to filter and returns current filter output.
      * \param sample  new signal sample
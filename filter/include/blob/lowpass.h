@@ -32,6 +32,8 @@
 #define B_LOWPASS_H
 
 #include <blob/types.h>
+#include <blob/filter.h>
+#include <blob/fixed.h>
 
 namespace blob {
 
@@ -58,6 +60,32 @@ class LowPassF : public Filter
   protected:
     real_t _factor; /**< filtering factor */
 };
+
+/**
+ * Exponential lowpass filter in saturating fixed-point arithmetic (Q15, Q31).
+ */
+template <typename Q> class LowPassQ
+{
+  public:
+    /**
+     * Initializes filter factor.
+     * \param factor  filtering factor [0,1]
+     */
+    LowPassQ(const real_t& factor) : _factor(factor), _gain(1-factor) {}
+    /**
+     * Adds a sample to filter and returns current filter output.
+     * \param sample  new signal sample in range [-1,1)
+     * \param dt      time lapse in seconds (optional)
+     */
+    Q update (const Q& sample, const Q& dt=Q()) {
+      return (_output = _output*_factor + _gain*sample);
+    }
+
+  protected:
+    Q _output; /**< filter output */
+    Q _factor; /**< filtering factor */
+    Q _gain;   /**< sample gain (1-factor) */
+};
 }
 
 #endif // B_ESTIMATOR_H 
@@ -32,6 +32,9 @@
 #define B_RATE_LIMITER_H
 
 #include <blob/types.h>
+#include <blob/math.h>
+#include <blob/filter.h>
+#include <blob/fixed.h>
 
 namespace blob {
 
@@ -60,6 +63,35 @@ class RateLimiter : public Filter
   protected: 
     real_t _rate; /**< rate limit */
 };
+
+/**
+ * Rate limiter filter in saturating fixed-point arithmetic (Q15, Q31).
+ */
+template <typename Q> class RateLimiterQ
+{
+  public:
+    /**
+     * Initializes rate limit.
+     * \param rate  rate limit (per second if dt is provided, per sample 
+     *              otherwise) in range [0,1)
+     */
+    RateLimiterQ(const real_t& rate) : _rate(rate) {}
+    /**
+     * Adds a sample to filter and returns current filter output.
+     * \param sample  new signal sample in range [-1,1)
+     * \param dt      time lapse in seconds (optional)
+     */
+    Q update (const Q& sample, const Q& dt=Q())
+    {
+      Q limit = (dt!=Q())? _rate*dt : _rate;
+      _output += blob::math::constrained(sample-_output, -limit, limit);
+      return _output;
+    }
+
+  protected:
+    Q _output; /**< filter output */
+    Q _rate;   /**< rate limit */
+};
 }
 
 #endif // B_ESTIMATOR_H 
@@ -0,0 +1,294 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * \file       test_fixed_linux.cpp
+ * \brief      compares fixed-point (Q15/Q31) filters and matrix operations
+ *             against the floating point path on imu datasets (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2017 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <time.h>
+
+#include <blob/math.h>
+#include <blob/matrix.h>
+#include <blob/fixed.h>
+#include <blob/lowpass.h>
+#include <blob/ratelimiter.h>
+
+#define CHANNELS 9     // gx gy gz ax ay az mx my mz
+#define REPEAT   20    // timing repetitions over the whole dataset
+
+#define T        0.01  // sample period
+#define FACTOR   0.9   // lowpass filtering factor
+#define RATE     0.5   // rate limit per second
+
+// full scale of each channel so that samples fit in [-1,1)
+const real_t scale[CHANNELS] = { 2,  2,  2,   // gyro [rad/s]
+                                40, 40, 40,   // accelerometer [m/s^2]
+                                 2,  2,  2 }; // magnetometer [normalized]
+
+volatile double sink; // keeps results of timed loops alive
+
+double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+/**
+ * Accumulates error statistics of a fixed-point result against float.
+ */
+struct Error
+{
+  Error () : max(0), sum2(0), count(0) {}
+  void add (real_t reference, real_t value)
+  {
+    real_t e = blob::math::rabs(reference - value);
+    if (e > max) max = e;
+    sum2 += (double)e*e;
+    count++;
+  }
+  void print (const char * name, double ops)
+  {
+    std::cout << "  " << name << ": max error=" << max
+              << " rms error=" << blob::math::sqrtr(sum2/count)
+              << " ops/s=" << ops << std::endl;
+  }
+  real_t max;
+  double sum2;
+  long count;
+};
+
+template <typename Q> double timeLowPass (const std::vector<real_t> & samples)
+{
+  std::vector<Q> q(samples.size());
+  for (size_t i=0; i<samples.size(); i++)
+    q[i] = Q(samples[i]);
+
+  double t0 = now();
+  for (int r=0; r<REPEAT; r++)
+  {
+    blob::LowPassQ<Q> lp[CHANNELS] = { FACTOR, FACTOR, FACTOR, FACTOR, FACTOR,
+                                       FACTOR, FACTOR, FACTOR, FACTOR };
+    for (size_t i=0; i<q.size(); i++)
+      sink = lp[i%CHANNELS].update(q[i]).raw();
+  }
+  double t1 = now();
+  return REPEAT*samples.size()/(t1-t0);
+}
+
+double timeLowPassF (const std::vector<real_t> & samples)
+{
+  double t0 = now();
+  for (int r=0; r<REPEAT; r++)
+  {
+    blob::LowPassF lp[CHANNELS] = { FACTOR, FACTOR, FACTOR, FACTOR, FACTOR,
+                                    FACTOR, FACTOR, FACTOR, FACTOR };
+    for (size_t i=0; i<samples.size(); i++)
+      sink = lp[i%CHANNELS].update(samples[i]);
+  }
+  double t1 = now();
+  return REPEAT*samples.size()/(t1-t0);
+}
+
+template <typename Q> bool test_lowpass (const std::vector<real_t> & samples)
+{
+  blob::LowPassF lpf[CHANNELS] = { FACTOR, FACTOR, FACTOR, FACTOR, FACTOR,
+                                   FACTOR, FACTOR, FACTOR, FACTOR };
+  blob::LowPassQ<Q> lpq[CHANNELS] = { FACTOR, FACTOR, FACTOR, FACTOR, FACTOR,
+                                      FACTOR, FACTOR, FACTOR, FACTOR };
+  Error error;
+  for (size_t i=0; i<samples.size(); i++)
+  {
+    real_t f = lpf[i%CHANNELS].update(samples[i]);
+    Q q = lpq[i%CHANNELS].update(Q(samples[i]));
+    error.add(f, q.toReal());
+  }
+  error.print(sizeof(Q)==2? "LowPassQ<Q15>":"LowPassQ<Q31>",
+                                                    timeLowPass<Q>(samples));
+  return true;
+}
+
+template <typename Q> 
+double timeRateLimiter (const std::vector<real_t> & samples)
+{
+  std::vector<Q> q(samples.size());
+  for (size_t i=0; i<samples.size(); i++)
+    q[i] = Q(samples[i]);
+
+  Q dt(T);
+  double t0 = now();
+  for (int r=0; r<REPEAT; r++)
+  {
+    blob::RateLimiterQ<Q> rl[CHANNELS] = { RATE, RATE, RATE, RATE, RATE,
+                                           RATE, RATE, RATE, RATE };
+    for (size_t i=0; i<q.size(); i++)
+      sink = rl[i%CHANNELS].update(q[i], dt).raw();
+  }
+  double t1 = now();
+  return REPEAT*samples.size()/(t1-t0);
+}
+
+double timeRateLimiterF (const std::vector<real_t> & samples)
+{
+  double t0 = now();
+  for (int r=0; r<REPEAT; r++)
+  {
+    blob::RateLimiter rl[CHANNELS] = { RATE, RATE, RATE, RATE, RATE,
+                                       RATE, RATE, RATE, RATE };
+    for (size_t i=0; i<samples.size(); i++)
+      sink = rl[i%CHANNELS].update(samples[i], T);
+  }
+  double t1 = now();
+  return REPEAT*samples.size()/(t1-t0);
+}
+
+template <typename Q> bool test_ratelimiter (const std::vector<real_t> &samples)
+{
+  blob::RateLimiter rlf[CHANNELS] = { RATE, RATE, RATE, RATE, RATE,
+                                      RATE, RATE, RATE, RATE };
+  blob::RateLimiterQ<Q> rlq[CHANNELS] = { RATE, RATE, RATE, RATE, RATE,
+                                          RATE, RATE, RATE, RATE };
+  Error error;
+  Q dt(T);
+
+  for (size_t i=0; i<samples.size(); i++)
+  {
+    real_t f = rlf[i%CHANNELS].update(samples[i], T);
+    Q q = rlq[i%CHANNELS].update(Q(samples[i]), dt);
+    error.add(f, q.toReal());
+  }
+  error.print(sizeof(Q)==2? "RateLimiterQ<Q15>":"RateLimiterQ<Q31>",
+                                                timeRateLimiter<Q>(samples));
+  return true;
+}
+
+bool test_matrix (const std::vector<real_t> & samples)
+{
+  // S = [g; a; m]/2 (3x3) for every dataset sample, R = S*S'/3 + S
+  size_t n = samples.size()/CHANNELS;
+  std::vector<real_t> sf(9*n), rf(9*n);
+  std::vector<blob::Q31> sq(9*n), rq(9*n);
+
+  real_t st[9], aux[9];
+  blob::Q31 stq[9], auxq[9];
+  blob::Q31 third(1.0/3);
+
+  for (size_t i=0; i<9*n; i++)
+  {
+    sf[i] = samples[i]/2;
+    sq[i] = blob::Q31(sf[i]);
+  }
+
+  double t0 = now();
+  for (size_t k=0; k<n; k++)
+  {
+    blob::Matrix<real_t> S(3,3,&sf[9*k]);
+    blob::Matrix<real_t> St(3,3,st);
+    blob::Matrix<real_t> R(3,3,&rf[9*k]);
+    blob::Matrix<real_t>::transpose(S,St);
+    R.multiply(S,St);
+    R.scale(1.0/3);
+    blob::Matrix<real_t> Aux(3,3,aux);
+    Aux.copy(S);
+    R.add(Aux);
+  }
+  double t1 = now();
+  for (size_t k=0; k<n; k++)
+  {
+    blob::Matrix<blob::Q31> S(3,3,&sq[9*k]);
+    blob::Matrix<blob::Q31> St(3,3,stq);
+    blob::Matrix<blob::Q31> R(3,3,&rq[9*k]);
+    blob::Matrix<blob::Q31>::transpose(S,St);
+    R.multiply(S,St);
+    R.scale(third);
+    blob::Matrix<blob::Q31> Aux(3,3,auxq);
+    Aux.copy(S);
+    R.add(Aux);
+  }
+  double t2 = now();
+
+  Error error;
+  for (size_t i=0; i<9*n; i++)
+    error.add(rf[i], rq[i].toReal());
+
+  std::cout << "  Matrix<real_t>: ops/s=" << n/(t1-t0) << std::endl;
+  error.print("Matrix<Q31>", n/(t2-t1));
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc != 2)
+  {
+    std::cerr << "[test] - usage: ./test input_file" << std::endl;
+    return -1;
+  }
+
+  std::ifstream input_file (argv[1]);
+  if (!input_file.is_open())
+  {
+    std::cerr << "[test] - file i/o error: unable to open file " << argv[1]
+              << std::endl;
+    return -1;
+  }
+
+  // samples scaled to [-1,1): [gx gy gz ax ay az mx my mz]*
+  std::vector<real_t> samples;
+  std::string line;
+  while ( getline (input_file,line) )
+  {
+    if((line[0] == '-') || ((line[0] >= '0')&&(line[0] <='9')))
+    {
+      std::stringstream lineinput(line);
+      for(int i=0; i<CHANNELS; i++)
+      {
+        real_t value = 0;
+        lineinput >> value;
+        samples.push_back(value/scale[i]);
+      }
+    }
+  }
+  input_file.close();
+
+  std::cout << "[test] - " << samples.size()/CHANNELS << " samples"
+            << std::endl;
+
+  std::cout << "LowPassF: ops/s=" << timeLowPassF(samples) << std::endl;
+  test_lowpass<blob::Q15>(samples);
+  test_lowpass<blob::Q31>(samples);
+  std::cout << "RateLimiter: ops/s=" << timeRateLimiterF(samples) << std::endl;
+  test_ratelimiter<blob::Q15>(samples);
+  test_ratelimiter<blob::Q31>(samples);
+  std::cout << "Matrix: " << std::endl;
+  test_matrix(samples);
+
+  return 0;
+}
@@ -0,0 +1,110 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * \file       aligned.h
+ * \brief      interface for aligned (and padded) storage of matrix elements
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2017 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_ALIGNED_H
+#define B_ALIGNED_H
+
+#include <blob/types.h>
+
+#if !defined(BLOB_MATRIX_ALIGNMENT)
+ #if defined(__AVR__)
+  #define BLOB_MATRIX_ALIGNMENT 1   // no vector unit, do not waste ram
+ #else
+  #define BLOB_MATRIX_ALIGNMENT 32  // AVX (use 64 for AVX-512)
+ #endif
+#endif
+
+/**
+ * Aligns variable or member to BLOB_MATRIX_ALIGNMENT bytes.
+ */
+#define BLOB_MATRIX_ALIGNED __attribute__((aligned(BLOB_MATRIX_ALIGNMENT)))
+
+/**
+ * Rounds n elements of type T up to a whole number of alignment blocks, so 
+ * that consecutive rows of length BLOB_MATRIX_PAD(T,n) are all aligned.
+ */
+#define BLOB_MATRIX_PAD(T,n) ((((n)*sizeof(T) + BLOB_MATRIX_ALIGNMENT - 1)/\
+                          BLOB_MATRIX_ALIGNMENT)*BLOB_MATRIX_ALIGNMENT/sizeof(T))
+
+namespace blob {
+
+/**
+ * Checks if pointer is aligned to the given number of bytes.
+ * \param p      pointer to check
+ * \param bytes  alignment in bytes (power of 2)
+ * \return  true if aligned, false otherwise.
+ */
+inline bool isAligned (const void * p, int bytes=BLOB_MATRIX_ALIGNMENT)
+{
+  return ((uintptr_t)p & (uintptr_t)(bytes - 1)) == 0;
+}
+
+/**
+ * Implements fixed capacity storage of N elements aligned to 
+ * BLOB_MATRIX_ALIGNMENT bytes and padded to a whole number of alignment 
+ * blocks. Converts implicitly to T* so it can replace plain arrays.
+ */
+template <typename T, int N> class AlignedBuffer
+{
+  public:
+    /**
+     * Provides pointer to first (aligned) element.
+     * \return  pointer to first element
+     */
+    T * data () { return _data; }
+    const T * data () const { return _data; }
+    operator T * () { return _data; }
+    operator const T * () const { return _data; }
+    /**
+     * Provides number of usable elements including padding.
+     * \return  capacity in elements
+     */
+    static int capacity () { return BLOB_MATRIX_PAD(T,N); }
+    /**
+     * Provides row length padded so that every row of a matrix with ncols 
+     * columns starts aligned.
+     * \param ncols  number of columns
+     * \return  padded row length in elements
+     */
+    static int stride (int ncols) { return BLOB_MATRIX_PAD(T,ncols); }
+    /**
+     * Provides alignment of the storage.
+     * \return  alignment in bytes
+     */
+    static int alignment () { return BLOB_MATRIX_ALIGNMENT; }
+
+  protected:
+    T _data[BLOB_MATRIX_PAD(T,N)] BLOB_MATRIX_ALIGNED; /**< elements */
+};
+
+}
+
+#endif // B_ALIGNED_H
@@ -0,0 +1,249 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * \file       counters.h
+ * \brief      flop, memory traffic and call counters for matrix operations
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2017 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_COUNTERS_H
+#define B_COUNTERS_H
+
+#include <blob/types.h>
+
+#if defined(__linux__)
+  #include <string.h>
+  #include <iostream>
+#endif
+
+#if !defined(BLOB_COUNTERS_MAX_ENTRIES)
+ #define BLOB_COUNTERS_MAX_ENTRIES 64
+#endif
+
+// Counters are compiled in only if BLOB_MATRIX_COUNTERS is defined for every
+// translation unit (e.g. add_definitions(-DBLOB_MATRIX_COUNTERS)), otherwise 
+// BLOB_COUNT and BLOB_COUNT_TAG expand to nothing.
+#if defined(BLOB_MATRIX_COUNTERS)
+ #define BLOB_COUNT(op, flops, bytes) blob::Counters::add(op, flops, bytes)
+ #define BLOB_COUNT_TAG(tag) blob::CountersTag _blob_counters_tag(tag)
+#else
+ #define BLOB_COUNT(op, flops, bytes)
+ #define BLOB_COUNT_TAG(tag)
+#endif
+
+namespace blob {
+
+/**
+ * Implements global flop, memory traffic and call counters per operation and 
+ * per call site tag (e.g. "ut.cov", "update.gain").
+ */
+class Counters
+{
+  public:
+    /**
+     * Counter entry for one operation in one call site tag.
+     */
+    struct Entry
+    {
+      const char * op;  /**< operation name */
+      const char * tag; /**< call site tag */
+      uint32_t calls;   /**< number of calls */
+      uint64_t flops;   /**< floating point operations */
+      uint64_t bytes;   /**< bytes read and written */
+    };
+    /**
+     * Accounts one call of operation op in current tag.
+     * \param op     operation name (string literal)
+     * \param flops  floating point operations of the call
+     * \param bytes  bytes read and written by the call
+     */
+    static void add (const char * op, uint64_t flops, uint64_t bytes)
+    {
+      State & s = state();
+      int i = 0;
+      for(; i<s.count; i++)
+        if(same(s.entries[i].op, op) && same(s.entries[i].tag, s.tag))
+          break;
+      if(i == s.count)
+      {
+        if(s.count == BLOB_COUNTERS_MAX_ENTRIES)
+          return;
+        Entry & e = s.entries[s.count++];
+        e.op = op;
+        e.tag = s.tag;
+        e.calls = 0;
+        e.flops = 0;
+        e.bytes = 0;
+      }
+      s.entries[i].calls++;
+      s.entries[i].flops += flops;
+      s.entries[i].bytes += bytes;
+    }
+    /**
+     * Sets current call site tag.
+     * \param tag  call site tag (string literal)
+     * \return  previous call site tag
+     */
+    static const char * setTag (const char * tag)
+    {
+      const char * prev = state().tag;
+      state().tag = tag;
+      return prev;
+    }
+    /**
+     * Provides current call site tag.
+     * \return  current call site tag
+     */
+    static const char * tag () { return state().tag; }
+    /**
+     * Clears all counters.
+     */
+    static void reset () { state().count = 0; }
+    /**
+     * Provides number of counter entries.
+     * \return  number of entries
+     */
+    static int count () { return state().count; }
+    /**
+     * Provides counter entry.
+     * \param i  entry index
+     * \return  entry
+     */
+    static const Entry & entry (int i) { return state().entries[i]; }
+    /**
+     * Provides accumulated counters of a call site tag.
+     * \param tag    call site tag, NULL for all tags
+     * \param flops  resulting floating point operations
+     * \param bytes  resulting bytes read and written
+     * \return  number of calls
+     */
+    static uint32_t total (const char * tag, uint64_t & flops, uint64_t & bytes)
+    {
+      uint32_t calls = 0;
+      flops = bytes = 0;
+      for(int i=0; i<state().count; i++)
+      {
+        const Entry & e = state().entries[i];
+        if(tag == NULL || same(e.tag, tag))
+        {
+          calls += e.calls;
+          flops += e.flops;
+          bytes += e.bytes;
+        }
+      }
+      return calls;
+    }
+    /**
+     * Provides arithmetic intensity (flops per byte) of a call site tag.
+     * \param tag  call site tag, NULL for all tags
+     * \return  arithmetic intensity, 0 if no traffic was counted
+     */
+    static real_t intensity (const char * tag)
+    {
+      uint64_t flops, bytes;
+      total(tag, flops, bytes);
+      return (bytes > 0)? (real_t)flops/bytes : 0;
+    }
+#if defined(__linux__)
+    /**
+     * Outputs counters per tag and operation and arithmetic intensity of each
+     * tag (phase).
+     * \param os  output stream
+     */
+    static void dump (std::ostream & os)
+    {
+#if !defined(BLOB_MATRIX_COUNTERS)
+      os << "Counters: disabled (define BLOB_MATRIX_COUNTERS)" << std::endl;
+#endif
+      State & s = state();
+      const char * done[BLOB_COUNTERS_MAX_ENTRIES];
+      int ndone = 0;
+      for(int i=0; i<s.count; i++)
+      {
+        const char * tag = s.entries[i].tag;
+        bool found = false;
+        for(int j=0; j<ndone && !found; j++)
+          found = same(done[j], tag);
+        if(found)
+          continue;
+        done[ndone++] = tag;
+
+        uint64_t flops, bytes;
+        uint32_t calls = total(tag, flops, bytes);
+        os << "[" << name(tag) << "] calls=" << calls << " flops=" << flops 
+           << " bytes=" << bytes << " flops/byte=" << intensity(tag) 
+           << std::endl;
+        for(int j=i; j<s.count; j++)
+        {
+          const Entry & e = s.entries[j];
+          if(!same(e.tag, tag))
+            continue;
+          os << "  " << e.op << ": calls=" << e.calls << " flops=" << e.flops
+             << " bytes=" << e.bytes << " flops/byte=" 
+             << ((e.bytes > 0)? (real_t)e.flops/e.bytes : 0) << std::endl;
+        }
+      }
+    }
+#endif
+
+  protected:
+    /**
+     * Global counters state.
+     */
+    struct State
+    {
+      const char * tag;
+      int count;
+      Entry entries[BLOB_COUNTERS_MAX_ENTRIES];
+    };
+    static State & state ()
+    {
+      static State s = { NULL, 0 };
+      return s;
+    }
+    static bool same (const char * a, const char * b)
+    {
+      return (a == b) || (a && b && !strcmp(a, b));
+    }
+    static const char * name (const char * tag) { return tag? tag : "-"; }
+};
+
+/**
+ * Sets call site tag for the lifetime of this object (scope), restoring the
+ * previous tag on destruction. See BLOB_COUNT_TAG.
+ */
+class CountersTag
+{
+  public:
+    CountersTag (const char * tag) : _prev(Counters::setTag(tag)) {}
+    ~CountersTag () { Counters::setTag(_prev); }
+  protected:
+    const char * _prev; /**< previous call site tag */
+};
+
+}
+
+#endif // B_COUNTERS_H
@@ -0,0 +1,109 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * \file       discretizer.h
+ * \brief      interface for cached discretization of continuous linear models
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2017 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_DISCRETIZER_H
+#define B_DISCRETIZER_H
+
+#include <blob/types.h>
+#include <blob/matrix.h>
+
+#if !defined(BLOB_DISCRETIZER_MAX_N)
+ #define BLOB_DISCRETIZER_MAX_N 10
+#endif
+
+#if !defined(BLOB_DISCRETIZER_SIZE)
+ #define BLOB_DISCRETIZER_SIZE 4
+#endif
+
+#if !defined(BLOB_DISCRETIZER_DT_TOLERANCE)
+ #define BLOB_DISCRETIZER_DT_TOLERANCE 1e-6
+#endif
+
+namespace blob {
+
+/**
+ * Implements discretization (Van Loan) of continuous linear model 
+ * dx = A*x + w, E[w*w'] = Q with a least recently used cache keyed by sample
+ * period, so that sensors at fixed rates cost one lookup per discretization.
+ */
+class Discretizer
+{
+  public:
+    /**
+     * Initializes discretizer for the given continuous model. Matrices are
+     * referenced, not copied: call reset() whenever they change.
+     * \param A  continuous nxn state matrix (n <= BLOB_DISCRETIZER_MAX_N)
+     * \param Q  continuous nxn process noise spectral density
+     */
+    Discretizer (const MatrixR & A, const MatrixR & Q);
+    /**
+     * Provides discrete model for sample period dt, from cache if dt matches 
+     * a cached sample period within relative BLOB_DISCRETIZER_DT_TOLERANCE.
+     * \param dt   sample period
+     * \param Phi  resulting nxn state transition matrix
+     * \param Qd   resulting nxn discrete process noise covariance
+     * \return  true if successful, false otherwise.
+     */
+    bool discretize (real_t dt, MatrixR & Phi, MatrixR & Qd);
+    /**
+     * Invalidates all cached discretizations (e.g. after A or Q changed).
+     */
+    void reset ();
+    /**
+     * Provides number of discretizations served from cache.
+     * \return  number of cache hits
+     */
+    uint32_t hits () const { return _hits; }
+    /**
+     * Provides number of discretizations computed.
+     * \return  number of cache misses
+     */
+    uint32_t misses () const { return _misses; }
+
+  protected:
+    const MatrixR & _A; /**< continuous state matrix */
+    const MatrixR & _Q; /**< continuous process noise spectral density */
+
+    uint8_t  _count;                        /**< number of cached entries */
+    uint32_t _clock;                        /**< access counter */
+    uint32_t _hits;                         /**< cache hits */
+    uint32_t _misses;                       /**< cache misses */
+    real_t   _dt[BLOB_DISCRETIZER_SIZE];    /**< cached sample periods */
+    uint32_t _used[BLOB_DISCRETIZER_SIZE];  /**< last access of each entry */
+    real_t   _phi[BLOB_DISCRETIZER_SIZE]
+                 [BLOB_DISCRETIZER_MAX_N*BLOB_DISCRETIZER_MAX_N]; /**< Phi */
+    real_t   _qd[BLOB_DISCRETIZER_SIZE]
+                [BLOB_DISCRETIZER_MAX_N*BLOB_DISCRETIZER_MAX_N];  /**< Qd */
+};
+
+}
+
+#endif // B_DISCRETIZER_H
@@ -0,0 +1,246 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * \file       dual.h
+ * \brief      interface for dual numbers (forward-mode automatic 
+ *             differentiation)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2017 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_DUAL_H
+#define B_DUAL_H
+
+#include <blob/types.h>
+#include <blob/math.h>
+
+#if defined(__linux__)
+  #include <iostream>
+#endif
+
+namespace blob {
+
+/**
+ * Implements dual number v + sum(d[i]*e[i]) with N infinitesimal parts, so 
+ * that evaluating a function over duals seeded with d = e[i] for variable i 
+ * provides its value and its exact gradient (forward-mode automatic 
+ * differentiation). Functions written as templates over the scalar type, 
+ * calling unqualified sqrt(), sin(), atan2()..., can be evaluated either 
+ * over real_t or over Dual<N>.
+ */
+template <int N> class Dual
+{
+  public:
+    /**
+     * Initializes constant dual number to zero.
+     */
+    Dual () : _v(0) { zero(); }
+    /**
+     * Initializes constant dual number (all derivatives zero).
+     * \param v  real value
+     */
+    Dual (const real_t & v) : _v(v) { zero(); }
+    /**
+     * Initializes independent variable i: derivative 1 with respect to 
+     * itself and 0 with respect to others.
+     * \param v  real value
+     * \param i  variable index, in [0,N)
+     */
+    Dual (const real_t & v, int i) : _v(v) { zero(); _d[i] = 1; }
+    /**
+     * Provides real part.
+     * \return  value
+     */
+    const real_t & value () const { return _v; }
+    /**
+     * Provides derivative with respect to variable i.
+     * \param i  variable index, in [0,N)
+     * \return  derivative
+     */
+    const real_t & derivative (int i) const { return _d[i]; }
+    /**
+     * Provides pointer to N derivatives.
+     * \return  gradient
+     */
+    real_t * gradient () { return _d; }
+    const real_t * gradient () const { return _d; }
+    /**
+     * Provides number of infinitesimal parts.
+     * \return  N
+     */
+    static int size () { return N; }
+
+    Dual & operator += (const Dual & b)
+    { _v += b._v; for(int i=0; i<N; i++) _d[i] += b._d[i]; return *this; }
+    Dual & operator -= (const Dual & b)
+    { _v -= b._v; for(int i=0; i<N; i++) _d[i] -= b._d[i]; return *this; }
+    Dual & operator *= (const Dual & b)
+    { 
+      for(int i=0; i<N; i++) _d[i] = _d[i]*b._v + _v*b._d[i]; 
+      _v *= b._v; 
+      return *this; 
+    }
+    Dual & operator /= (const Dual & b)
+    {
+      real_t ib = 1/b._v, r = _v*ib;
+      for(int i=0; i<N; i++) _d[i] = (_d[i] - r*b._d[i])*ib;
+      _v = r;
+      return *this;
+    }
+    Dual & operator += (const real_t & b) { _v += b; return *this; }
+    Dual & operator -= (const real_t & b) { _v -= b; return *this; }
+    Dual & operator *= (const real_t & b) 
+    { _v *= b; for(int i=0; i<N; i++) _d[i] *= b; return *this; }
+    Dual & operator /= (const real_t & b) { return (*this *= 1/b); }
+
+    Dual operator - () const 
+    { Dual r; r._v = -_v; for(int i=0; i<N; i++) r._d[i] = -_d[i]; return r; }
+    Dual operator + () const { return *this; }
+
+    friend Dual operator + (Dual a, const Dual & b) { return a += b; }
+    friend Dual operator - (Dual a, const Dual & b) { return a -= b; }
+    friend Dual operator * (Dual a, const Dual & b) { return a *= b; }
+    friend Dual operator / (Dual a, const Dual & b) { return a /= b; }
+    friend Dual operator + (Dual a, const real_t & b) { return a += b; }
+    friend Dual operator - (Dual a, const real_t & b) { return a -= b; }
+    friend Dual operator * (Dual a, const real_t & b) { return a *= b; }
+    friend Dual operator / (Dual a, const real_t & b) { return a /= b; }
+    friend Dual operator + (const real_t & a, Dual b) { return b += a; }
+    friend Dual operator - (const real_t & a, const Dual & b) { return -b + a;}
+    friend Dual operator * (const real_t & a, Dual b) { return b *= a; }
+    friend Dual operator / (const real_t & a, const Dual & b) 
+    { return Dual(a) /= b; }
+
+    friend bool operator <  (const Dual & a, const Dual & b) {return a._v < b._v;}
+    friend bool operator >  (const Dual & a, const Dual & b) {return a._v > b._v;}
+    friend bool operator <= (const Dual & a, const Dual & b) {return a._v <= b._v;}
+    friend bool operator >= (const Dual & a, const Dual & b) {return a._v >= b._v;}
+    friend bool operator == (const Dual & a, const Dual & b) {return a._v == b._v;}
+    friend bool operator != (const Dual & a, const Dual & b) {return a._v != b._v;}
+
+    /**
+     * Applies chain rule: f(a) + f'(a)*a.d.
+     * \param a   dual argument
+     * \param f   value of function at real part of a
+     * \param df  derivative of function at real part of a
+     * \return  dual result
+     */
+    static Dual chain (const Dual & a, const real_t & f, const real_t & df)
+    {
+      Dual r;
+      r._v = f;
+      for(int i=0; i<N; i++) r._d[i] = df*a._d[i];
+      return r;
+    }
+
+  protected:
+    /**
+     * Sets all derivatives to zero.
+     */
+    void zero () { for(int i=0; i<N; i++) _d[i] = 0; }
+
+    real_t _v;    /**< real part */
+    real_t _d[N]; /**< infinitesimal parts (gradient) */
+};
+
+// keep libm overloads visible to unqualified calls inside namespace blob
+using ::sqrt; using ::sin; using ::cos; using ::tan; using ::asin; 
+using ::acos; using ::atan; using ::atan2; using ::exp; using ::log; 
+using ::fabs;
+
+template <int N> Dual<N> sqrt (const Dual<N> & a)
+{
+  real_t s = blob::math::sqrtr(a.value());
+  return Dual<N>::chain(a, s, (real_t)0.5/s);
+}
+template <int N> Dual<N> sin (const Dual<N> & a)
+{
+  return Dual<N>::chain(a, blob::math::sin(a.value()), 
+                           blob::math::cos(a.value()));
+}
+template <int N> Dual<N> cos (const Dual<N> & a)
+{
+  return Dual<N>::chain(a, blob::math::cos(a.value()), 
+                          -blob::math::sin(a.value()));
+}
+template <int N> Dual<N> tan (const Dual<N> & a)
+{
+  real_t t = blob::math::tan(a.value());
+  return Dual<N>::chain(a, t, 1 + t*t);
+}
+template <int N> Dual<N> asin (const Dual<N> & a)
+{
+  return Dual<N>::chain(a, blob::math::asin(a.value()), 
+                     1/blob::math::sqrtr(1 - a.value()*a.value()));
+}
+template <int N> Dual<N> acos (const Dual<N> & a)
+{
+  return Dual<N>::chain(a, blob::math::acos(a.value()), 
+                    -1/blob::math::sqrtr(1 - a.value()*a.value()));
+}
+template <int N> Dual<N> atan (const Dual<N> & a)
+{
+  return Dual<N>::chain(a, blob::math::atan(a.value()), 
+                           1/(1 + a.value()*a.value()));
+}
+template <int N> Dual<N> atan2 (const Dual<N> & y, const Dual<N> & x)
+{
+  // d(atan2(y,x)) = (x*dy - y*dx)/(x^2 + y^2)
+  real_t r2 = x.value()*x.value() + y.value()*y.value();
+  Dual<N> r = Dual<N>::chain(y, blob::math::atan2(y.value(), x.value()), 
+                             x.value()/r2);
+  r -= Dual<N>::chain(x, 0, y.value()/r2);
+  return r;
+}
+template <int N> Dual<N> exp (const Dual<N> & a)
+{
+  real_t e = blob::math::exp(a.value());
+  return Dual<N>::chain(a, e, e);
+}
+template <int N> Dual<N> log (const Dual<N> & a)
+{
+  return Dual<N>::chain(a, blob::math::log(a.value()), 1/a.value());
+}
+template <int N> Dual<N> fabs (const Dual<N> & a)
+{
+  return (a.value() < 0)? -a : a;
+}
+
+#if defined(__linux__)
+/**
+ * Outputs dual number as value and gradient to stream.
+ */
+template <int N> std::ostream & operator << (std::ostream & os, 
+                                             const Dual<N> & a)
+{
+  os << a.value() << " [";
+  for(int i=0; i<N; i++)
+    os << ((i>0)? " ":"") << a.derivative(i);
+  return os << "]";
+}
+#endif
+
+}
+
+#endif // B_DUAL_H
@@ -0,0 +1,268 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * \file       fixed.h
+ * \brief      interface for saturating fixed-point numbers (Q15 and Q31)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2017 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_FIXED_H
+#define B_FIXED_H
+
+#include <blob/types.h>
+#include <blob/matrix.h>
+
+#if defined(__linux__)
+  #include <iostream>
+#endif
+
+namespace blob {
+
+/**
+ * Implements saturating signed fixed-point number with F fractional bits
+ * stored in S and operated in wider type W, covering range [-1,1).
+ */
+template <typename S, typename W, int F> class Fixed
+{
+  public:
+    /**
+     * Initializes fixed-point number to zero.
+     */
+    Fixed () : _v(0) {}
+    /**
+     * Initializes fixed-point number from real number, saturating out of range
+     * values to the closest representable value.
+     * \param x  real number to convert
+     */
+    Fixed (const real_t & x) : _v(fromReal(x)) {}
+    /**
+     * Provides fixed-point number from its raw integer representation.
+     * \param v  raw integer representation
+     * \return  fixed-point number
+     */
+    static Fixed fromRaw (const S & v) { Fixed q; q._v = v; return q; }
+    /**
+     * Provides the raw integer representation of this number.
+     * \return  raw integer representation
+     */
+    S raw () const { return _v; }
+    /**
+     * Converts this number to real number.
+     * \return  real number
+     */
+    real_t toReal () const { return (real_t)_v/one(); }
+    /**
+     * Provides the largest representable number.
+     * \return  largest representable number in raw representation
+     */
+    static S maxRaw () { return (S)(((W)1<<F)-1); }
+    /**
+     * Provides the smallest representable number.
+     * \return  smallest representable number in raw representation
+     */
+    static S minRaw () { return (S)(-((W)1<<F)); }
+    /**
+     * Saturates wide value to storage range.
+     * \param w  wide value in raw representation
+     * \return  saturated value in raw representation
+     */
+    static S saturate (const W & w)
+    {
+      if(w > (W)maxRaw()) return maxRaw();
+      if(w < (W)minRaw()) return minRaw();
+      return (S)w;
+    }
+    /**
+     * Multiplies two raw values with rounding to nearest and saturation.
+     * \param a  left raw value
+     * \param b  right raw value
+     * \return  raw product
+     */
+    static S mul (const S & a, const S & b)
+    {
+      return saturate(((W)a*b + ((W)1<<(F-1))) >> F);
+    }
+
+    Fixed operator + (const Fixed & q) const {return fromRaw(saturate((W)_v+q._v));}
+    Fixed operator - (const Fixed & q) const {return fromRaw(saturate((W)_v-q._v));}
+    Fixed operator * (const Fixed & q) const {return fromRaw(mul(_v,q._v));}
+    Fixed operator - () const {return fromRaw(saturate(-(W)_v));}
+
+    Fixed & operator += (const Fixed & q) {_v = saturate((W)_v+q._v); return *this;}
+    Fixed & operator -= (const Fixed & q) {_v = saturate((W)_v-q._v); return *this;}
+    Fixed & operator *= (const Fixed & q) {_v = mul(_v,q._v); return *this;}
+
+    bool operator == (const Fixed & q) const {return _v == q._v;}
+    bool operator != (const Fixed & q) const {return _v != q._v;}
+    bool operator <  (const Fixed & q) const {return _v <  q._v;}
+    bool operator >  (const Fixed & q) const {return _v >  q._v;}
+    bool operator <= (const Fixed & q) const {return _v <= q._v;}
+    bool operator >= (const Fixed & q) const {return _v >= q._v;}
+
+  protected:
+    /**
+     * Provides the real value of one least significant bit inverse (2^F).
+     * \return  2^F as real number
+     */
+    static real_t one () { return (real_t)((W)1<<F); }
+    /**
+     * Converts real number to raw representation with rounding and saturation.
+     * \param x  real number to convert
+     * \return  raw representation
+     */
+    static S fromReal (const real_t & x)
+    {
+      if(x >= 1) return maxRaw();
+      if(x < -1) return minRaw();
+      real_t r = x*one();
+      return saturate((W)((r<0)? (r-0.5f):(r+0.5f)));
+    }
+
+    S _v; /**< raw integer representation */
+};
+
+/**
+ * Q15 fixed-point number: 16 bits with 15 fractional bits.
+ */
+typedef Fixed<int16_t,int32_t,15> Q15;
+/**
+ * Q31 fixed-point number: 32 bits with 31 fractional bits.
+ */
+typedef Fixed<int32_t,int64_t,31> Q31;
+
+/**
+ * Multiplies matrix A and B and stores the result into this matrix. Products
+ * are accumulated exactly, as a 64-bit sum of their upper bits (Q46, 17 guard
+ * bits) plus a separate sum of the 16 bits shifted out, and rounded and 
+ * saturated only once per element.
+ * \param A  left matrix to multiply.
+ * \param B  right matrix to multiply.
+ * \return  true if successful, false otherwise.
+ */
+template <> inline bool Matrix<Q31>::multiply (const Matrix<Q31> & A,
+                                               const Matrix<Q31> & B)
+{
+  if((A.ncols() != B.nrows()) ||
+     (this->nrows() != A.nrows()) ||
+     (this->ncols() != B.ncols()))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "Matrix<Q31>::multiply() error: "
+              << (int)A.ncols() << "==" << (int)B.nrows() << "?"
+              << (int)this->nrows() << "==" << (int)A.nrows() << "?"
+              << (int)this->ncols() << "==" << (int)B.ncols() << "?"
+              << std::endl;
+#endif
+    return false;
+  }
+
+  const Q31 *a = A.data();
+  const Q31 *b = B.data();
+  int n = A.ncols();
+  int p = B.ncols();
+
+  for (int i = 0; i < _nrows; i++)
+  {
+    for (int j = 0; j < _ncols; j++)
+    {
+      int64_t acc = 0;
+      uint64_t low = 0;
+      for (int k = 0; k < n; k++)
+      {
+        int64_t product = (int64_t)a[i*n + k].raw()*b[k*p + j].raw();
+        acc += product >> 16;
+        low += (uint64_t)product & 0xFFFF;
+      }
+      // carries of low bits; the bits still below Q46 cannot change rounding
+      acc += low >> 16;
+      _data[i*_ncols + j] = Q31::fromRaw(Q31::saturate((acc + (1<<14)) >> 15));
+    }
+  }
+  return true;
+}
+
+/**
+ * Scales this matrix with rounding and saturation.
+ * \param n  Scalar to scale this matrix.
+ * \return  true if successful, false otherwise.
+ */
+template <> inline bool Matrix<Q31>::scale (const Q31 & n)
+{
+  if(!_data)
+    return false;
+
+  int32_t s = n.raw();
+  for (int i = 0; i < _nrows*_ncols; i++)
+    _data[i] = Q31::fromRaw(Q31::mul(s, _data[i].raw()));
+  return true;
+}
+
+/**
+ * Adds matrix M elements to this matrix with saturation.
+ * \param M      matrix to add elements from.
+ * \param nrows  number of rows to sum.
+ * \param ncols  number of columns to sum.
+ * \param row0   first row to substitute in this matrix.
+ * \param col0   first column to substitute in this matrix.
+ * \return  true if successful, false otherwise.
+ */
+template <> inline bool Matrix<Q31>::add (const Matrix<Q31> & M,
+                                          uint8_t nrows, uint8_t ncols,
+                                          uint8_t row0, uint8_t col0)
+{
+  if ((row0+nrows)>M.nrows()     || (col0+ncols)>M.ncols() ||
+      (row0+nrows)>this->nrows() || (col0+ncols)>this->ncols())
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "Matrix<Q31>::add() error: "
+              << (int)_nrows << ">=" << (int)(M.nrows()+row0) << "?"
+              << (int)_ncols << ">=" << (int)(M.ncols()+col0) << "?"
+              << std::endl;
+#endif
+    return false;
+  }
+
+  const Q31 *m = M.data();
+  for (int i=row0; i<row0+nrows; i++)
+    for (int j=col0; j<col0+ncols; j++)
+      _data[i*_ncols + j] = Q31::fromRaw(Q31::saturate(
+                       (int64_t)_data[i*_ncols + j].raw() + m[i*M.ncols() + j].raw()));
+  return true;
+}
+
+#if defined(__linux__)
+/**
+ * Outputs fixed-point number as real number to stream.
+ */
+template <typename S, typename W, int F>
+std::ostream & operator << (std::ostream & os, const Fixed<S,W,F> & q)
+{
+  return os << q.toReal();
+}
+#endif
+
+}
+
+#endif // B_FIXED_H
@@ -63,7 +63,7 @@ class math
     static real_t rabs (const real_t & x) 
     {
 #if defined(__linux__)
-      return using_double()?fabsf(x):fabs(x);
+      return using_double()? ::fabs(x) : ::fabsf(x);
 #elif defined(__AVR_ATmega32U4__)
       return fabs(x);
 #endif //if defined(__linux__)
@@ -76,7 +76,7 @@ class math
     static real_t sqrtr (const real_t & x) 
     {
 #if defined(__linux__)
-      return using_double()?sqrt(x):sqrtf(x); 
+      return using_double()? ::sqrt(x) : ::sqrtf(x);
 #elif defined(__AVR_ATmega32U4__)
       return sqrt(x);
 #endif //if defined(__linux__)
@@ -87,7 +87,7 @@ class math
      * \return cosine of input real number
      */ 
     static real_t cos (const real_t & x) {
-      return using_double()? cos(x) : cosf(x);
+      return using_double()? ::cos(x) : ::cosf(x);
     }
     /**
      * Sine of real number
@@ -95,7 +95,7 @@ class math
      * \return sine of input real number
      */
     static real_t sin (const real_t & x) {
-      return using_double()? sin(x) : sinf(x);
+      return using_double()? ::sin(x) : ::sinf(x);
     }
     /**
      * Tangent of real number
@@ -103,7 +103,7 @@ class math
      * \return tangent of input real number
      */
     static real_t tan (const real_t & x) {
-      return using_double()? tan(x) : tanf(x);
+      return using_double()? ::tan(x) : ::tanf(x);
     }
     /**
      * Arcsine of real number
@@ -111,7 +111,7 @@ class math
      * \return arcsine of input real number
      */
     static real_t asin (const real_t & x) {
-      return using_double()? asin(x) : asinf(x);
+      return using_double()? ::asin(x) : ::asinf(x);
     }
     /**
      * Arccosine of real number
@@ -119,7 +119,7 @@ class math
      * \return arccosine of input real number
      */
     static real_t acos (const real_t & x) {
-      return using_double()? acos(x) : acosf(x);
+      return using_double()? ::acos(x) : ::acosf(x);
     }
     /**
      * Arctangent of real number
@@ -127,7 +127,7 @@ class math
      * \return arctangent of input real number
      */
     static real_t atan (const real_t & x) {
-      return using_double()? atan(x) : atanf(x);
+      return using_double()? ::atan(x) : ::atanf(x);
     }
     /**
      * Two argument arctangent of real number
@@ -136,7 +136,23 @@ class math
      * \return two argument arctangent of input real number
      */
     static real_t atan2 (const real_t & y, const real_t& x) {
-      return using_double()? atan2(y, x) : atan2f(y, x);
+      return using_double()? ::atan2(y, x) : ::atan2f(y, x);
+    }
+    /**
+     * Exponential of real number
+     * \param x  real number to calculate the exponential of
+     * \return exponential of input real number
+     */
+    static real_t exp (const real_t & x) {
+      return using_double()? ::exp(x) : ::expf(x);
+    }
+    /**
+     * Natural logarithm of real number
+     * \param x  real number to calculate the natural logarithm of
+     * \return natural logarithm of input real number
+     */
+    static real_t log (const real_t & x) {
+      return using_double()? ::log(x) : ::logf(x);
     }
     /**
      * Sign of a number
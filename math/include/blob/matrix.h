@@ -33,6 +33,8 @@
 
 #include <blob/types.h>
 #include <blob/math.h>
+#include <blob/counters.h>
+#include <blob/aligned.h>
 
 #if defined(__linux__)  
 #include <string.h>
@@ -46,6 +48,32 @@ namespace blob {
 const int MATRIX_MAX_ROWCOL (50); 
 const int MATRIX_MAX_LENGTH (MATRIX_MAX_ROWCOL*MATRIX_MAX_ROWCOL);
 
+/**
+ * Accumulation policy applied to dot products and reductions.
+ */
+enum accumulation_t
+{
+  ACCUMULATION_NAIVE    = 0, /**< running sum in T (fastest) */
+  ACCUMULATION_KAHAN    = 1, /**< compensated (Kahan-Babuska) running sum */
+  ACCUMULATION_PAIRWISE = 2, /**< pairwise (cascade) sum */
+  ACCUMULATION_WIDE     = 3  /**< running sum in wider type (e.g. double) */
+};
+
+#if !defined(BLOB_MATRIX_ACCUMULATION)
+ #define BLOB_MATRIX_ACCUMULATION blob::ACCUMULATION_NAIVE
+#endif
+
+#if !defined(BLOB_MATRIX_PAIRWISE_BLOCK)
+ #define BLOB_MATRIX_PAIRWISE_BLOCK 8
+#endif
+
+/**
+ * Provides wider type to accumulate in (same type by default).
+ */
+template <typename T> struct wide { typedef T type; };
+template <> struct wide<float> { typedef double type; };
+template <> struct wide<double> { typedef long double type; };
+
 /**
  * Implements generic Matrix object and operations.
  */
@@ -85,6 +113,29 @@ template <typename T> class Matrix
      * \return pointer to matrix data array.
      */     
     T * data () const { return _data; } 
+    /**
+     * Checks if matrix data array is aligned to the given number of bytes.
+     * \param bytes  alignment in bytes (power of 2)
+     * \return  true if aligned, false otherwise.
+     */
+    bool isAligned (int bytes=BLOB_MATRIX_ALIGNMENT) const 
+    { 
+      return blob::isAligned(_data, bytes); 
+    }
+    /**
+     * Provides alignment (up to 64 bytes) guaranteed for the start of every 
+     * row, so that kernels can take aligned fast paths. Rows keep the data
+     * alignment only if their length is padded (see BLOB_MATRIX_PAD).
+     * \return  row alignment in bytes
+     */
+    int alignment () const
+    {
+      uintptr_t a = (uintptr_t)_data | (uintptr_t)(sizeof(T)*_ncols);
+      int bytes = 1;
+      while(bytes < 64 && !(a & bytes))
+        bytes <<= 1;
+      return bytes;
+    }
     /**
      * Changes matrix size and if necessary data array.
      * \param rows   matrix number of rows.
@@ -116,6 +167,7 @@ template <typename T> class Matrix
     {
       for(int i=0;i<length();i++)
         _data[i]=1;
+      return true;
     }
     /**
      * Makes identity matrix if matrix is square (nrows=ncols). Identity matrix 
@@ -153,6 +205,7 @@ template <typename T> class Matrix
       
       if (M.nrows()==_nrows && M.ncols()==_ncols)
       {
+        BLOB_COUNT("copy", 0, 2*sizeof(T)*this->length());
         memcpy(this->data(), M.data(), sizeof(T)*this->length());
         retval = true;
       }
@@ -198,6 +251,67 @@ template <typename T> class Matrix
       return retval;
     }
 
+    /**
+     * Fills block of this matrix starting at row0, col0 with whole matrix M, 
+     * one row memcpy at a time.
+     * \param M     matrix to copy from.
+     * \param row0  first row of block in this matrix.
+     * \param col0  first column of block in this matrix.
+     * \return  true if successful, false otherwise.
+     */
+    bool setBlock (const Matrix<T> & M, uint8_t row0=0, uint8_t col0=0)
+    {
+      if ((row0+M.nrows())>_nrows || (col0+M.ncols())>_ncols)
+      {
+    #if defined(__DEBUG__) & defined(__linux__)
+        std::cerr << "Matrix::setBlock() error: " 
+                  << (int)_nrows << ">=" << (int)(M.nrows()+row0) << "?" 
+                  << (int)_ncols << ">=" << (int)(M.ncols()+col0) << "?" 
+                  << std::endl;
+    #endif
+        return false;
+      }
+      BLOB_COUNT("setBlock", 0, 2*sizeof(T)*M.length());
+      const T * m = M.data();
+      T * d = &_data[_ncols*row0 + col0];
+      if (M.ncols() == _ncols)
+        memcpy(d, m, sizeof(T)*M.length());
+      else
+        for (int i=0; i<M.nrows(); i++, d+=_ncols, m+=M.ncols())
+          memcpy(d, m, sizeof(T)*M.ncols());
+      return true;
+    }
+    /**
+     * Fills whole matrix M with block of this matrix starting at row0, col0,
+     * one row memcpy at a time.
+     * \param M     matrix to copy to.
+     * \param row0  first row of block in this matrix.
+     * \param col0  first column of block in this matrix.
+     * \return  true if successful, false otherwise.
+     */
+    bool getBlock (Matrix<T> & M, uint8_t row0=0, uint8_t col0=0) const
+    {
+      if ((row0+M.nrows())>_nrows || (col0+M.ncols())>_ncols)
+      {
+    #if defined(__DEBUG__) & defined(__linux__)
+        std::cerr << "Matrix::getBlock() error: " 
+                  << (int)_nrows << ">=" << (int)(M.nrows()+row0) << "?" 
+                  << (int)_ncols << ">=" << (int)(M.ncols()+col0) << "?" 
+                  << std::endl;
+    #endif
+        return false;
+      }
+      BLOB_COUNT("getBlock", 0, 2*sizeof(T)*M.length());
+      T * m = M.data();
+      const T * d = &_data[_ncols*row0 + col0];
+      if (M.ncols() == _ncols)
+        memcpy(m, d, sizeof(T)*M.length());
+      else
+        for (int i=0; i<M.nrows(); i++, d+=_ncols, m+=M.ncols())
+          memcpy(m, d, sizeof(T)*M.ncols());
+      return true;
+    }
+
     /**
      * Provides element in given row and col.
      * \param row row the element is in.
@@ -386,6 +500,7 @@ template <typename T> class Matrix
           (row0+nrows)<=this->nrows() && (col0+ncols)<=this->ncols())
       {
         retval = true;
+        BLOB_COUNT("add", nrows*ncols, 3*sizeof(T)*nrows*ncols);
         for (int i=row0; i<row0+nrows; i++)
           for (int j=col0; j<col0+ncols; j++)
             _data[i*_ncols + j] += M(i,j);
@@ -426,6 +541,7 @@ template <typename T> class Matrix
           (row0+nrows)<=this->nrows() && (col0+ncols)<=this->ncols())
       {
         retval = true;
+        BLOB_COUNT("substract", nrows*ncols, 3*sizeof(T)*nrows*ncols);
         for (int i=row0; i<row0+nrows; i++)
           for (int j=col0; j<col0+ncols; j++)
             _data[i*_ncols + j] -= M(i,j);
@@ -454,16 +570,23 @@ template <typename T> class Matrix
          (this->nrows() == A.nrows()) && 
          (this->ncols() == B.ncols()))
       {
+        // matrix-vector and outer products
+        if (B.ncols() == 1)
+          return gemv(A, B, *this);
+        if (A.nrows() == 1)
+          return gemvT(B, A, *this);
+        if (A.ncols() == 1)
+          return (this->zero() && this->ger(A, B));
+
+        BLOB_COUNT("multiply", 2*(uint64_t)_nrows*_ncols*A.ncols(), 
+                   sizeof(T)*(A.length() + B.length() + this->length()));
         for (int i = 0; i < this->nrows(); i++)
         {
           for (int j = 0; j < this->ncols(); j++)
           {
-            uint8_t index = i*this->ncols() + j;
-            _data[index] = 0;
-            for (int k = 0; k < A.ncols(); k++)
-            {
-              _data[index] += A[i*A.ncols()+k]*B[k*B.ncols()+j]; 
-            }
+            _data[i*this->ncols() + j] = dot(&A.data()[i*A.ncols()], 1,
+                                             &B.data()[j], B.ncols(), 
+                                             A.ncols());
           }
         }
         retval = true;
@@ -478,6 +601,37 @@ template <typename T> class Matrix
     #endif
       return retval;
     }
+    /**
+     * Adds rank-1 outer product to this matrix: this = this + alpha*x*y'.
+     * \param x      vector (row or column) with this number of rows elements.
+     * \param y      vector (row or column) with this number of columns elements.
+     * \param alpha  scale of outer product.
+     * \return  true if successful, false otherwise.
+     */
+    bool ger (const Matrix<T> & x, const Matrix<T> & y, const T & alpha=1)
+    {
+      if (!isVector(x, _nrows) || !isVector(y, _ncols))
+      {
+    #if defined(__DEBUG__) & defined(__linux__)
+        std::cerr << "Matrix::ger() error: " << (int)x.length() << "==" 
+                  << (int)_nrows << "?" << (int)y.length() << "==" 
+                  << (int)_ncols << "?" << std::endl;
+    #endif
+        return false;
+      }
+      BLOB_COUNT("ger", 2*(uint64_t)_nrows*_ncols, 
+                 sizeof(T)*(2*this->length() + _nrows + _ncols));
+      const T * a = x.data();
+      const T * b = y.data();
+      for (int i=0; i<_nrows; i++)
+      {
+        T ai = (alpha == (T)1)? a[i] : alpha*a[i];
+        T * r = &_data[i*_ncols];
+        for (int j=0; j<_ncols; j++)
+          r[j] += ai*b[j];
+      }
+      return true;
+    }
     /**
      * Multiplies this matrix with diagonal elements in unidimensional matrix D 
      * (row matrix or column matrix).
@@ -491,6 +645,8 @@ template <typename T> class Matrix
       if (((d.nrows()==_ncols)&&(d.ncols()==1)) || // this*d
           ((d.ncols()==_ncols)&&(d.nrows()==1)) && (_nrows==d.length()))
       {
+        BLOB_COUNT("multiplyDiag", this->length(), 
+                   sizeof(T)*(2*this->length() + d.length()));
         for (int i=0; i<_nrows; i++)
           for (int j=0; j<_ncols; j++)
             _data[_ncols*i + j] *= d[j];
@@ -500,6 +656,8 @@ template <typename T> class Matrix
       else if (((d.nrows()==_nrows)&&(d.ncols()==1)) || // D*this
                ((d.ncols()==_nrows)&&(d.nrows()==1)) && (_ncols==d.length()))
       {
+        BLOB_COUNT("multiplyDiag", this->length(), 
+                   sizeof(T)*(2*this->length() + d.length()));
         for (int i=0; i<_nrows; i++)
           for (int j=0; j<_ncols; j++)
             _data[_ncols*i + j] *= d[i];
@@ -527,6 +685,7 @@ template <typename T> class Matrix
 
       if ((M.nrows()==_nrows)&&(M.ncols()==_ncols))
       {
+        BLOB_COUNT("multiplyElem", this->length(), 3*sizeof(T)*this->length());
         for (int i=0; i < _nrows; i++)
           for (int j=0; j < _ncols; j++)
             _data[_ncols*i+j] *= M[j];
@@ -546,6 +705,7 @@ template <typename T> class Matrix
       
       if(_data)
       {
+        BLOB_COUNT("scale", this->length(), 2*sizeof(T)*this->length());
         for (int i = 0; i < _nrows*_ncols; i++) 
         {
           _data[i] = n*_data[i];
@@ -563,6 +723,7 @@ template <typename T> class Matrix
       int start, next, i;
       T tmp;
      
+      BLOB_COUNT("transpose", 0, 2*sizeof(T)*this->length());
       for (start = 0; start <= _ncols*_nrows - 1; start++) {
         next = start;
         i = 0;
@@ -593,16 +754,30 @@ template <typename T> class Matrix
      */
     T squareNorm () const
     {
-      T ret=0;
-      for(int i=0;i<this->length();i++)
-        ret+=_data[i]*_data[i];
-      return ret;
+      return dot(_data, 1, _data, 1, this->length());
     }
     /**
      * Euclidean norm of the matrix
      * \return  Euclidean norm of the matrix
      */
     real_t norm () const { return math::sqrtr(this->squareNorm()); }
+    /**
+     * 1-norm of the matrix (maximum absolute column sum)
+     * \return  1-norm of the matrix
+     */
+    T norm1 () const
+    {
+      T ret=0;
+      for(int j=0;j<_ncols;j++)
+      {
+        T sum=0;
+        for(int i=0;i<_nrows;i++)
+          sum+=(_data[i*_ncols+j]<0)? -_data[i*_ncols+j]:_data[i*_ncols+j];
+        if(sum>ret)
+          ret=sum;
+      }
+      return ret;
+    }
     /**
      * Normalizes (divides by norm) the matrix so that its norm is 1.0
      * \return  true if successful, false otherwise.
@@ -707,6 +882,74 @@ template <typename T> class Matrix
     #endif
       }
     }
+    /**
+     * Sets the accumulation policy of dot products and reductions.
+     * \param policy  accumulation policy
+     */
+    static void setAccumulation (accumulation_t policy) {_accumulation=policy;}
+    /**
+     * Provides the accumulation policy of dot products and reductions.
+     * \return  accumulation policy
+     */
+    static accumulation_t getAccumulation () {return _accumulation;}
+    /**
+     * Dot product of two strided arrays, accumulated with the current 
+     * accumulation policy.
+     * \param a     first array
+     * \param inca  stride between elements of first array
+     * \param b     second array
+     * \param incb  stride between elements of second array
+     * \param n     number of elements
+     * \return  sum of a[i*inca]*b[i*incb] for i in [0,n)
+     */
+    static T dot (const T * a, int inca, const T * b, int incb, int n)
+    {
+      switch (_accumulation)
+      {
+        case ACCUMULATION_KAHAN:
+        {
+          T sum = 0, c = 0;
+          for (int i=0; i<n; i++)
+          {
+            T p = a[i*inca]*b[i*incb];
+            T t = sum + p;
+            if (((sum<0)? -sum:sum) >= ((p<0)? -p:p))
+              c += (sum - t) + p;
+            else
+              c += (p - t) + sum;
+            sum = t;
+          }
+          return sum + c;
+        }
+        case ACCUMULATION_PAIRWISE:
+        {
+          if (n <= BLOB_MATRIX_PAIRWISE_BLOCK)
+          {
+            T sum = 0;
+            for (int i=0; i<n; i++)
+              sum += a[i*inca]*b[i*incb];
+            return sum;
+          }
+          int h = n/2;
+          return dot(a, inca, b, incb, h) + 
+                 dot(&a[h*inca], inca, &b[h*incb], incb, n-h);
+        }
+        case ACCUMULATION_WIDE:
+        {
+          typename wide<T>::type sum = 0;
+          for (int i=0; i<n; i++)
+            sum += (typename wide<T>::type)a[i*inca]*b[i*incb];
+          return (T)sum;
+        }
+        default:
+        {
+          T sum = 0;
+          for (int i=0; i<n; i++)
+            sum += a[i*inca]*b[i*incb];
+          return sum;
+        }
+      }
+    }
     /**
      * Adds matrix M elements to this matrix.
      * \param A matrix to sum.
@@ -821,13 +1064,268 @@ template <typename T> class Matrix
     {
       return (R.copy(A) && R.transpose());
     }
+    /**
+     * Multiplies matrix by vector: y = alpha*A*x + beta*y, one contiguous dot 
+     * product per row of A. y is not read if beta is zero.
+     * \param A      m x n matrix.
+     * \param x      n elements vector (row or column).
+     * \param y      m elements vector (row or column), result.
+     * \param alpha  scale of product.
+     * \param beta   scale of initial y.
+     * \return  true if successful, false otherwise.
+     */
+    static bool gemv (const Matrix<T> & A, const Matrix<T> & x, Matrix<T> & y,
+                      const T & alpha=1, const T & beta=0)
+    {
+      if (!isVector(x, A.ncols()) || !isVector(y, A.nrows()))
+      {
+    #if defined(__DEBUG__) & defined(__linux__)
+        std::cerr << "Matrix::gemv() error: " << (int)x.length() << "==" 
+                  << (int)A.ncols() << "?" << (int)y.length() << "==" 
+                  << (int)A.nrows() << "?" << std::endl;
+    #endif
+        return false;
+      }
+      int m = A.nrows(), n = A.ncols();
+      BLOB_COUNT("gemv", 2*(uint64_t)m*n, sizeof(T)*(A.length() + n + 2*m));
+      const T * a = A.data();
+      const T * b = x.data();
+      T * r = y.data();
+      for (int i=0; i<m; i++)
+      {
+        T t = dot(&a[i*n], 1, b, 1, n);
+        if (alpha != (T)1)
+          t = alpha*t;
+        r[i] = (beta == (T)0)? t : t + beta*r[i];
+      }
+      return true;
+    }
+    /**
+     * Multiplies transposed matrix by vector: y = alpha*A'*x + beta*y, 
+     * sweeping rows of A (axpy) with naive accumulation. y is not read if 
+     * beta is zero.
+     * \param A      m x n matrix.
+     * \param x      m elements vector (row or column).
+     * \param y      n elements vector (row or column), result.
+     * \param alpha  scale of product.
+     * \param beta   scale of initial y.
+     * \return  true if successful, false otherwise.
+     */
+    static bool gemvT (const Matrix<T> & A, const Matrix<T> & x, Matrix<T> & y,
+                       const T & alpha=1, const T & beta=0)
+    {
+      if (!isVector(x, A.nrows()) || !isVector(y, A.ncols()))
+      {
+    #if defined(__DEBUG__) & defined(__linux__)
+        std::cerr << "Matrix::gemvT() error: " << (int)x.length() << "==" 
+                  << (int)A.nrows() << "?" << (int)y.length() << "==" 
+                  << (int)A.ncols() << "?" << std::endl;
+    #endif
+        return false;
+      }
+      int m = A.nrows(), n = A.ncols();
+      BLOB_COUNT("gemvT", 2*(uint64_t)m*n, sizeof(T)*(A.length() + m + 2*n));
+      const T * a = A.data();
+      const T * b = x.data();
+      T * r = y.data();
+      BLOB_MATRIX_ALIGNED T t[n];
+      if (_accumulation == ACCUMULATION_NAIVE)
+      {
+        // same summation order as column dot products
+        for (int j=0; j<n; j++)
+          t[j] = 0;
+        for (int k=0; k<m; k++)
+        {
+          T bk = b[k];
+          const T * ak = &a[k*n];
+          for (int j=0; j<n; j++)
+            t[j] += bk*ak[j];
+        }
+      }
+      else
+      {
+        for (int j=0; j<n; j++)
+          t[j] = dot(&a[j], n, b, 1, m);
+      }
+      for (int j=0; j<n; j++)
+      {
+        T tj = (alpha != (T)1)? alpha*t[j] : t[j];
+        r[j] = (beta == (T)0)? tj : tj + beta*r[j];
+      }
+      return true;
+    }
+    /**
+     * Multiplies symmetric matrix by vector: y = alpha*A*x + beta*y, reading 
+     * only the lower triangle of A. y is not read if beta is zero.
+     * \param A      n x n symmetric matrix.
+     * \param x      n elements vector (row or column).
+     * \param y      n elements vector (row or column), result.
+     * \param alpha  scale of product.
+     * \param beta   scale of initial y.
+     * \return  true if successful, false otherwise.
+     */
+    static bool symv (const Matrix<T> & A, const Matrix<T> & x, Matrix<T> & y,
+                      const T & alpha=1, const T & beta=0)
+    {
+      int n = A.nrows();
+      if (A.ncols() != n || !isVector(x, n) || !isVector(y, n))
+      {
+    #if defined(__DEBUG__) & defined(__linux__)
+        std::cerr << "Matrix::symv() error: " << (int)A.nrows() << "==" 
+                  << (int)A.ncols() << "==" << (int)x.length() << "==" 
+                  << (int)y.length() << "?" << std::endl;
+    #endif
+        return false;
+      }
+      BLOB_COUNT("symv", 2*(uint64_t)n*n, sizeof(T)*(n*(n+1)/2 + 3*n));
+      const T * a = A.data();
+      const T * b = x.data();
+      T * r = y.data();
+      BLOB_MATRIX_ALIGNED T t[n];
+      for (int i=0; i<n; i++)
+        t[i] = a[i*n+i]*b[i];
+      for (int i=1; i<n; i++)
+      {
+        // row i of lower triangle contributes to y(i) and, by symmetry, y(j)
+        const T * ai = &a[i*n];
+        T bi = b[i];
+        t[i] += dot(ai, 1, b, 1, i);
+        for (int j=0; j<i; j++)
+          t[j] += ai[j]*bi;
+      }
+      for (int i=0; i<n; i++)
+      {
+        T ti = (alpha != (T)1)? alpha*t[i] : t[i];
+        r[i] = (beta == (T)0)? ti : ti + beta*r[i];
+      }
+      return true;
+    }
+    /**
+     * Assembles block diagonal matrix R = [A 0; 0 B] (e.g. augmented state, 
+     * process noise and measurement noise covariance).
+     * \param A  upper left block.
+     * \param B  lower right block.
+     * \param R  resulting (A.nrows()+B.nrows())x(A.ncols()+B.ncols()) matrix.
+     * \return  true if successful, false otherwise.
+     */
+    static bool blkdiag (const Matrix<T> & A, const Matrix<T> & B, 
+                                                                 Matrix<T> & R)
+    {
+      const Matrix<T> * blocks[] = { &A, &B };
+      return blkdiag(blocks, 2, R);
+    }
+    /**
+     * Assembles block diagonal matrix R = [A 0 0; 0 B 0; 0 0 C].
+     * \param A  upper left block.
+     * \param B  center block.
+     * \param C  lower right block.
+     * \param R  resulting matrix.
+     * \return  true if successful, false otherwise.
+     */
+    static bool blkdiag (const Matrix<T> & A, const Matrix<T> & B, 
+                         const Matrix<T> & C, Matrix<T> & R)
+    {
+      const Matrix<T> * blocks[] = { &A, &B, &C };
+      return blkdiag(blocks, 3, R);
+    }
+    /**
+     * Assembles block diagonal matrix R from n blocks.
+     * \param blocks  array of n blocks, from upper left to lower right.
+     * \param n       number of blocks.
+     * \param R       resulting matrix.
+     * \return  true if successful, false otherwise.
+     */
+    static bool blkdiag (const Matrix<T> * const * blocks, uint8_t n, 
+                                                                 Matrix<T> & R)
+    {
+      int rows = 0, cols = 0;
+      for (int k=0; k<n; k++)
+      {
+        rows += blocks[k]->nrows();
+        cols += blocks[k]->ncols();
+      }
+      if (rows != R.nrows() || cols != R.ncols())
+      {
+    #if defined(__DEBUG__) & defined(__linux__)
+        std::cerr << "Matrix::blkdiag() error: " 
+                  << (int)R.nrows() << "x" << (int)R.ncols() << "=="
+                  << rows << "x" << cols << "?" << std::endl;
+    #endif
+        return false;
+      }
+      R.zero();
+      for (int k=0, i=0, j=0; k<n; k++)
+      {
+        R.setBlock(*blocks[k], i, j);
+        i += blocks[k]->nrows();
+        j += blocks[k]->ncols();
+      }
+      return true;
+    }
+    /**
+     * Stacks matrices horizontally R = [A B].
+     * \param A  left matrix.
+     * \param B  right matrix with same number of rows.
+     * \param R  resulting A.nrows()x(A.ncols()+B.ncols()) matrix.
+     * \return  true if successful, false otherwise.
+     */
+    static bool hstack (const Matrix<T> & A, const Matrix<T> & B, Matrix<T> & R)
+    {
+      if (A.nrows() != B.nrows() || R.nrows() != A.nrows() || 
+          R.ncols() != A.ncols() + B.ncols())
+      {
+    #if defined(__DEBUG__) & defined(__linux__)
+        std::cerr << "Matrix::hstack() error: " 
+                  << (int)R.nrows() << "==" << (int)A.nrows() << "=="
+                  << (int)B.nrows() << "?" << (int)R.ncols() << "==" 
+                  << (int)(A.ncols()+B.ncols()) << "?" << std::endl;
+    #endif
+        return false;
+      }
+      return (R.setBlock(A, 0, 0) && R.setBlock(B, 0, A.ncols()));
+    }
+    /**
+     * Stacks matrices vertically R = [A; B] (e.g. pre-array of QR updates).
+     * \param A  upper matrix.
+     * \param B  lower matrix with same number of columns.
+     * \param R  resulting (A.nrows()+B.nrows())xA.ncols() matrix.
+     * \return  true if successful, false otherwise.
+     */
+    static bool vstack (const Matrix<T> & A, const Matrix<T> & B, Matrix<T> & R)
+    {
+      if (A.ncols() != B.ncols() || R.ncols() != A.ncols() || 
+          R.nrows() != A.nrows() + B.nrows())
+      {
+    #if defined(__DEBUG__) & defined(__linux__)
+        std::cerr << "Matrix::vstack() error: " 
+                  << (int)R.ncols() << "==" << (int)A.ncols() << "=="
+                  << (int)B.ncols() << "?" << (int)R.nrows() << "==" 
+                  << (int)(A.nrows()+B.nrows()) << "?" << std::endl;
+    #endif
+        return false;
+      }
+      return (R.setBlock(A, 0, 0) && R.setBlock(B, A.nrows(), 0));
+    }
     
   protected:
+    /**
+     * Checks if matrix is a row or column vector of n elements.
+     */
+    static bool isVector (const Matrix<T> & v, int n)
+    {
+      return (v.length() == n) && ((v.nrows() == 1) || (v.ncols() == 1));
+    }
+
     uint8_t _nrows; /**< matrix number of rows */
     uint8_t _ncols; /**< matrix number of columns */
     T * _data;      /**< pointer to matrix element array */
+
+    static accumulation_t _accumulation; /**< dot products accumulation */
 };
 
+template <typename T> 
+accumulation_t Matrix<T>::_accumulation = BLOB_MATRIX_ACCUMULATION;
+
 /**
  * Implements real number Matrix object and operations.
  */
@@ -842,6 +1340,66 @@ class MatrixR : public Matrix<real_t>
      *               distribution: [row0 row1 row2 ... rowN].
      */
     MatrixR (uint8_t rows = 0, uint8_t cols = 0, real_t *data = NULL);
+
+    using Matrix<real_t>::multiply;
+    /**
+     * Multiplies matrix A and B and stores the result into R with the kernel
+     * tuned for their shape (see Tuner), scalar kernel if not tuned.
+     * \param A  left matrix to multiply.
+     * \param B  right matrix to multiply.
+     * \param R  resulting matrix.
+     * \return  true if successful, false otherwise.
+     */
+    static bool multiply (const MatrixR & A, const MatrixR & B, MatrixR & R);
+    /**
+     * Calculates weighted mean of sample set U (one sample per column, e.g. 
+     * sigma points, particles or ensemble members): mu = U*w.
+     * \param U   l x N sample matrix
+     * \param w   N weights vector
+     * \param mu  resulting l mean vector
+     * \return  true if successful, false otherwise.
+     */
+    static bool weightedMean (const MatrixR & U, const MatrixR & w, MatrixR & mu);
+    /**
+     * Calculates weighted covariance of sample set U around mu, sweeping 
+     * samples once row by row: D = U - mu, P = D*diag(w)*D'. Only the lower 
+     * triangle is computed, P is exactly symmetric.
+     * \param U   l x N sample matrix
+     * \param w   N weights vector
+     * \param mu  l mean vector
+     * \param P   resulting l x l covariance matrix
+     * \param D   if not NULL, resulting l x N deviations matrix
+     * \return  true if successful, false otherwise.
+     */
+    static bool weightedCov (const MatrixR & U, const MatrixR & w, 
+                             const MatrixR & mu, MatrixR & P, MatrixR * D=NULL);
+    /**
+     * Calculates weighted cross-covariance of two deviation sets with the same
+     * number of samples: P = A*diag(w)*B'.
+     * \param A  la x N deviations matrix
+     * \param B  lb x N deviations matrix
+     * \param w  N weights vector
+     * \param P  resulting la x lb cross-covariance matrix
+     * \return  true if successful, false otherwise.
+     */
+    static bool weightedCross (const MatrixR & A, const MatrixR & B, 
+                               const MatrixR & w, MatrixR & P);
+    /**
+     * Calculates weighted mean of l x N row-major sample set U (see 
+     * weightedMean()), for sets with more than 255 samples.
+     */
+    static void weightedMean (const real_t * U, int l, int N, const real_t * w, 
+                              real_t * mu);
+    /**
+     * Calculates weighted covariance of l x N row-major sample set U (see 
+     * weightedCov()), for sets with more than 255 samples. Nothing is placed
+     * on the stack: storage for deviations and scratch comes from caller.
+     * \param D   resulting l x N deviations
+     * \param wd  scratch of N elements
+     */
+    static void weightedCov (const real_t * U, int l, int N, const real_t * w, 
+                             const real_t * mu, real_t * P, real_t * D, 
+                             real_t * wd);
     /**
      * Calculates this matrix Cholesky decomposition, resulting in a triangular 
      * matrix. https://en.wikipedia.org/wiki/Cholesky_decomposition
@@ -858,6 +1416,30 @@ class MatrixR : public Matrix<real_t>
      * \return  true if successful, false otherwise.
      */
     bool cholupdate (MatrixR & v, int sign);
+    /**
+     * Calculates this symmetric positive semi-definite matrix pivoted 
+     * (rank-revealing) Cholesky decomposition P'*A*P = L*L' in place, choosing
+     * the largest remaining diagonal as pivot and stopping when it falls below
+     * tol. Columns of L beyond the numerical rank are zero and the upper 
+     * triangle is converted to zeros. Rows of S, S(piv[i],:) = L(i,:), give 
+     * A = S*S'. Only the lower triangle is used.
+     * \param piv   if not NULL, resulting permutation (n elements): row i of 
+     *              L corresponds to row piv[i] of A
+     * \param rank  if not NULL, resulting numerical rank
+     * \param tol   stopping pivot, negative for n*eps*max(diag(A))
+     * \return  true if successful, false otherwise.
+     */
+    bool pcholesky (uint8_t * piv=NULL, uint8_t * rank=NULL, real_t tol=-1);
+    /**
+     * Calculates Gill-Murray modified Cholesky decomposition L*L' = A + E in 
+     * place, with E a non-negative diagonal matrix, null if this symmetric 
+     * matrix is sufficiently positive definite. Succeeds for indefinite 
+     * matrices. Only the lower triangle is used and the upper triangle is 
+     * converted to zeros.
+     * \param shift  if not NULL, resulting largest element of E
+     * \return  true if successful, false otherwise.
+     */
+    bool mcholesky (real_t * shift=NULL);
     /**
      * Restores original matrix from its Cholesky decomposition.
      * https://en.wikipedia.org/wiki/Cholesky_decomposition
@@ -881,6 +1463,40 @@ class MatrixR : public Matrix<real_t>
      * \return  true if successful, false otherwise.
      */
     bool lurestore ();
+    /**
+     * Performs square root free LDL' factorization in place: unit lower 
+     * triangular L stored below the diagonal (ones implied) and D on the 
+     * diagonal. Only the lower triangle of this symmetric matrix is used.
+     * \param zero  if true, upper triangle converted to zeros
+     * \return  true if successful, false otherwise (zero pivot).
+     */
+    bool ldl (bool zero=true);
+    /**
+     * Updates in place LDL' factorization (see ldl()) to the one of 
+     * L*D*L' + alpha*v*v' in O(n^2) without square roots (Agee-Turner rank-1 
+     * modification, as in Bierman/Thornton UD filters). v is overwritten.
+     * \param v      column or row vector of length n
+     * \param alpha  scale of rank-1 term, negative for downdate
+     * \return  true if successful, false otherwise (result not definite).
+     */
+    bool ldlupdate (MatrixR & v, real_t alpha=1);
+    /**
+     * Solves L*D*L'*X = B in place from LDL' factorization (see ldl()).
+     * \param X  right hand side matrix B with n rows, resulting solution X
+     * \return  true if successful, false otherwise.
+     */
+    bool ldlsolve (MatrixR & X) const;
+    /**
+     * Solves L*L'*X = B in place from this lower triangular Cholesky factor.
+     * \param X  right hand side matrix B with n rows, resulting solution X
+     * \return  true if successful, false otherwise.
+     */
+    bool cholsolve (MatrixR & X) const;
+    /**
+     * Restores original symmetric matrix from its in place LDL' factorization.
+     * \return  true if successful, false otherwise.
+     */
+    bool ldlrestore ();
     /**
      * Inverses matrix based on Cholesky decomposition (if positive-definite) or
      * LU decomposition otherwise.
@@ -892,8 +1508,19 @@ class MatrixR : public Matrix<real_t>
     /**
      * Forces matrix definite positiveness.
      * \return  true if successful, false otherwise.
+     * \sa regularize()
      */ 
     bool forcePositive ();
+    /**
+     * Regularizes symmetric positive semi-definite matrix (e.g. covariance) 
+     * adding to its diagonal the smallest jitter that makes its estimated 
+     * reciprocal condition number at least rcondMin. Well-conditioned 
+     * matrices are left untouched.
+     * \param rcondMin  minimum acceptable reciprocal condition number (0,1)
+     * \param rcond     if not NULL, resulting reciprocal condition number
+     * \return  true if successful, false otherwise.
+     */
+    bool regularize (real_t rcondMin, real_t * rcond=NULL);
     /**
      * Forces matrix simmetry.
      * \return  true if successful, false otherwise.
@@ -931,12 +1558,31 @@ class MatrixR : public Matrix<real_t>
      * \return  true if successful, false otherwise.
      */
     static bool cholinverse (const MatrixR & L, MatrixR & R);
+    /**
+     * Estimates the reciprocal condition number in 1-norm of a symmetric 
+     * positive definite matrix A from its Cholesky factor in O(n^2) 
+     * (Hager/Higham estimator). 
+     * \param anorm  1-norm of original matrix A (see norm1())
+     * \param L      lower triangular Cholesky factor of A (see cholesky())
+     * \return  estimated 1/(norm1(A)*norm1(inv(A))), 0 if singular
+     */
+    static real_t cholrcond (real_t anorm, const MatrixR & L);
+    /**
+     * Estimates the reciprocal condition number in 1-norm of a matrix A from
+     * its LU factorization in O(n^2) (Hager/Higham estimator).
+     * \param anorm  1-norm of original matrix A (see norm1())
+     * \param LU     lower and upper triangular matrix represented in same
+     *               matrix (see lu())
+     * \return  estimated 1/(norm1(A)*norm1(inv(A))), 0 if singular
+     */
+    static real_t lurcond (real_t anorm, const MatrixR & LU);
     /**
      * Calculates this matrix LDL decomposition, resulting in a triangular 
      * matrix and diagolar elements vector.
      * https://es.mathworks.com/help/dsp/ref/ldlfactorization.html
      * \param A  original matrix
-     * \param L  resulting cholesky decomposed lower triangular matrix
+     * \param L  resulting unit lower triangular matrix
+     * \param d  resulting diagonal elements vector
      * \return  true if successful, false otherwise.
      */
     static bool ldl (const MatrixR & A, MatrixR & L, MatrixR & d);
@@ -948,6 +1594,16 @@ class MatrixR : public Matrix<real_t>
      * \return  true if successful, false otherwise.
      */
     static bool qr (const MatrixR & A, MatrixR & Q, MatrixR & R);
+    /**
+     * Matrix economy QR decomposition without Q (Householder reflections 
+     * applied in place), e.g. triangularization of square-root filter 
+     * compound matrices. R diagonal is non-negative, so R' is the lower 
+     * Cholesky factor of A'*A.
+     * \param A  original mxn matrix A=Q*R, m>=n
+     * \param R  resulting nxn upper triangular matrix
+     * \return  true if successful, false otherwise.
+     */
+    static bool qr (const MatrixR & A, MatrixR & R);
     /**
      * Matrix LU decomposition with partial pivoting.
      * \param A  original matrix P*A=L*U
@@ -973,6 +1629,64 @@ class MatrixR : public Matrix<real_t>
      * \return  true if successful, false otherwise.
      */
     static bool lu (const MatrixR & A, MatrixR & R);
+    /**
+     * Symmetric eigenvalue decomposition A=V*diag(d)*V' by cyclic Jacobi 
+     * rotations, intended for small matrices (n<=20). Sweeps stop as soon as 
+     * the off-diagonal norm is negligible. Eigenvalues are sorted ascending.
+     * https://en.wikipedia.org/wiki/Jacobi_eigenvalue_algorithm
+     * \param A     original symmetric nxn matrix (upper triangle not needed)
+     * \param V     resulting nxn orthogonal matrix of eigenvectors (columns);
+     *              initial guess of eigenvectors if warm is true
+     * \param d     resulting nx1 vector of eigenvalues
+     * \param warm  if true, rotations start from V'*A*V, which is almost 
+     *              diagonal when A changed little since V was computed
+     * \return  true if successful, false otherwise.
+     */
+    static bool eig (const MatrixR & A, MatrixR & V, MatrixR & d, 
+                                                           bool warm=false);
+    /**
+     * Singular value decomposition A=U*diag(s)*V' by one-sided Jacobi 
+     * (Hestenes) rotations, intended for small matrices (n<=20). Singular 
+     * values are sorted descending.
+     * https://en.wikipedia.org/wiki/Jacobi_rotation
+     * \param A  original mxn matrix with m>=n
+     * \param U  resulting mxn matrix of left singular vectors (columns)
+     * \param s  resulting nx1 vector of singular values
+     * \param V  resulting nxn orthogonal matrix of right singular vectors
+     * \return  true if successful, false otherwise.
+     */
+    static bool svd (const MatrixR & A, MatrixR & U, MatrixR & s, MatrixR & V);
+    /**
+     * Moore-Penrose pseudo-inverse from singular value decomposition.
+     * https://en.wikipedia.org/wiki/Moore-Penrose_inverse
+     * \param A    original mxn matrix
+     * \param R    resulting nxm pseudo-inverse matrix
+     * \param tol  singular values below tol are treated as zero; if negative,
+     *             max(m,n)*max(s)*eps is used
+     * \return  true if successful, false otherwise.
+     */
+    static bool pinv (const MatrixR & A, MatrixR & R, real_t tol=-1);
+    /**
+     * Matrix exponential by scaling and squaring with degree 6 Pade 
+     * approximant. https://en.wikipedia.org/wiki/Matrix_exponential
+     * \param A  original nxn matrix
+     * \param R  resulting nxn matrix exp(A)
+     * \return  true if successful, false otherwise.
+     */
+    static bool expm (const MatrixR & A, MatrixR & R);
+    /**
+     * Discretizes continuous linear model dx = A*x + w, E[w*w'] = Q with Van 
+     * Loan method: Phi = exp(A*dt), Qd = integral(exp(A*t)*Q*exp(A*t)',0,dt).
+     * \sa Discretizer to cache results for repeated sample periods.
+     * \param A    continuous nxn state matrix
+     * \param Q    continuous nxn process noise spectral density
+     * \param dt   sample period
+     * \param Phi  resulting nxn state transition matrix
+     * \param Qd   resulting nxn discrete process noise covariance
+     * \return  true if successful, false otherwise.
+     */
+    static bool discretize (const MatrixR & A, const MatrixR & Q, real_t dt,
+                                                  MatrixR & Phi, MatrixR & Qd);
 };
 
 }
@@ -0,0 +1,215 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * \file       series.h
+ * \brief      interface for binary memory-mappable matrix/time-series files
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2017 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_SERIES_H
+#define B_SERIES_H
+
+#include <blob/types.h>
+
+#if defined(__linux__)
+  #include <stdio.h>
+#endif
+
+#if !defined(BLOB_SERIES_ALIGNMENT)
+ #define BLOB_SERIES_ALIGNMENT 64 // payload offset alignment in bytes
+#endif
+
+#if !defined(BLOB_SERIES_MAX_COLS)
+ #define BLOB_SERIES_MAX_COLS 64
+#endif
+
+#if !defined(BLOB_SERIES_MAX_NAME)
+ #define BLOB_SERIES_MAX_NAME 32 // maximum column name length (with '\0')
+#endif
+
+namespace blob {
+
+/**
+ * Element types of series payload (value is element size in bytes).
+ */
+enum series_dtype_t
+{
+  SERIES_FLOAT32 = 4, /**< 32 bits IEEE 754 */
+  SERIES_FLOAT64 = 8  /**< 64 bits IEEE 754 */
+};
+
+/**
+ * Fixed header at the beginning of a series file (little-endian). Column names
+ * follow as ncols '\0'-terminated strings, then padding up to offset, where 
+ * the row-major nrows x ncols payload starts (BLOB_SERIES_ALIGNMENT aligned).
+ */
+struct SeriesHeader
+{
+  char     magic[8]; /**< "BLOBSER" */
+  uint32_t version;  /**< format version (1) */
+  uint32_t dtype;    /**< element type (series_dtype_t) */
+  uint64_t nrows;    /**< number of rows (updated on flush) */
+  uint32_t ncols;    /**< number of columns */
+  uint32_t offset;   /**< payload offset from start of file in bytes */
+  double   dt;       /**< sample period of rows, 0 if not a time-series */
+};
+
+#if defined(__linux__)
+
+/**
+ * Implements zero-copy reader of series files through read-only mmap. 
+ */
+class SeriesReader
+{
+  public:
+    SeriesReader ();
+    ~SeriesReader ();
+    /**
+     * Maps series file. Rows are counted from file size, so files of an 
+     * interrupted writer are readable up to their last complete row.
+     * \param filename  file to map
+     * \return  true if successful, false otherwise.
+     */
+    bool open (const char * filename);
+    /**
+     * Unmaps series file.
+     */
+    void close ();
+
+    uint64_t nrows () const { return _nrows; }
+    uint32_t ncols () const { return _header? _header->ncols : 0; }
+    series_dtype_t dtype () const 
+    { 
+      return (series_dtype_t)(_header? _header->dtype : 0); 
+    }
+    double dt () const { return _header? _header->dt : 0; }
+    /**
+     * Provides column name.
+     * \param col  column index
+     * \return  column name, NULL if out of range
+     */
+    const char * name (uint32_t col) const;
+    /**
+     * Provides column index from name.
+     * \param name  column name
+     * \return  column index, -1 if not found
+     */
+    int column (const char * name) const;
+    /**
+     * Provides payload without copy if element type is T.
+     * \return  pointer to first element of row-major payload, NULL if element 
+     *          type is not T
+     */
+    template <typename T> const T * data () const
+    {
+      return (_header && sizeof(T) == _header->dtype)? (const T*)_payload:NULL;
+    }
+    /**
+     * Provides row without copy if element type is T.
+     * \param i  row index
+     * \return  pointer to row, NULL if out of range or type is not T
+     */
+    template <typename T> const T * row (uint64_t i) const
+    {
+      const T * d = data<T>();
+      return (d && i < _nrows)? &d[i*_header->ncols] : NULL;
+    }
+    /**
+     * Provides element converted to real_t, whatever the element type.
+     * \param i    row index
+     * \param col  column index
+     * \return  element value
+     */
+    real_t value (uint64_t i, uint32_t col) const;
+
+  protected:
+    void * _map;                  /**< mapped file */
+    size_t _size;                 /**< mapped file size */
+    const SeriesHeader * _header; /**< file header */
+    const char * _payload;        /**< first payload element */
+    uint64_t _nrows;              /**< complete rows in file */
+    const char * _names[BLOB_SERIES_MAX_COLS]; /**< column names */
+};
+
+/**
+ * Implements append-only writer of series files.
+ */
+class SeriesWriter
+{
+  public:
+    SeriesWriter ();
+    ~SeriesWriter ();
+    /**
+     * Creates series file, or opens it for appending if it exists with the 
+     * same number of columns and element type.
+     * \param filename  file to write
+     * \param ncols     number of columns
+     * \param names     column names (NULL for c0, c1, ...)
+     * \param dt        sample period of rows, 0 if not a time-series
+     * \param dtype     element type
+     * \return  true if successful, false otherwise.
+     */
+    bool open (const char * filename, uint32_t ncols, 
+               const char * const * names=NULL, double dt=0,
+               series_dtype_t dtype=(series_dtype_t)sizeof(real_t));
+    /**
+     * Appends rows, converting them to file element type.
+     * \param rows  row-major n x ncols values
+     * \param n     number of rows
+     * \return  true if successful, false otherwise.
+     */
+    bool append (const real_t * rows, uint32_t n=1);
+    /**
+     * Flushes rows and updates row count in header.
+     * \return  true if successful, false otherwise.
+     */
+    bool flush ();
+    /**
+     * Flushes and closes file.
+     */
+    void close ();
+    uint64_t nrows () const { return _header.nrows; }
+    /**
+     * Converts whitespace separated text dataset to series file. A non 
+     * numeric first line provides column names and optional "(dt=...)".
+     * \param textfile  text dataset to read
+     * \param filename  series file to write
+     * \param dtype     element type
+     * \return  number of rows converted, -1 if failed
+     */
+    static long convert (const char * textfile, const char * filename,
+                         series_dtype_t dtype=(series_dtype_t)sizeof(real_t));
+
+  protected:
+    FILE * _file;         /**< output file */
+    SeriesHeader _header; /**< file header */
+};
+
+#endif // defined(__linux__)
+
+}
+
+#endif // B_SERIES_H
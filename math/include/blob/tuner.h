@@ -0,0 +1,164 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * \file       tuner.h
+ * \brief      interface for auto-tuned selection of matrix kernels per shape
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2017 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_TUNER_H
+#define B_TUNER_H
+
+#include <blob/types.h>
+#include <blob/matrix.h>
+
+#if !defined(BLOB_TUNER_MAX_SHAPES)
+ #define BLOB_TUNER_MAX_SHAPES 32
+#endif
+
+#if !defined(BLOB_TUNER_BLOCK)
+ #define BLOB_TUNER_BLOCK 8
+#endif
+
+#if !defined(BLOB_TUNER_REPETITIONS)
+ #define BLOB_TUNER_REPETITIONS 15
+#endif
+
+namespace blob {
+
+/**
+ * Candidate kernels for matrix product R = A*B.
+ */
+enum kernel_t
+{
+  KERNEL_SCALAR   = 0, /**< dot product per element (honors accumulation) */
+  KERNEL_UNROLLED = 1, /**< dot product per element unrolled by 4 */
+  KERNEL_STREAM   = 2, /**< row streaming (axpy), vectorizable inner loop */
+  KERNEL_BLOCKED  = 3, /**< row streaming in BLOB_TUNER_BLOCK tiles */
+  KERNEL_COUNT    = 4
+};
+
+/**
+ * Implements auto-tuner that benchmarks candidate matrix product kernels for
+ * each shape registered by the application, keeps the winners in a dispatch
+ * table used by MatrixR::multiply(A,B,R), and persists the table to a file.
+ */
+class Tuner
+{
+  public:
+    /**
+     * Registers product shape (mxk)*(kxn) to be tuned. Already registered 
+     * shapes are ignored.
+     * \param m  rows of A and R
+     * \param k  columns of A and rows of B
+     * \param n  columns of B and R
+     * \return  true if successful, false if dispatch table is full.
+     */
+    static bool registerShape (uint8_t m, uint8_t k, uint8_t n);
+    /**
+     * Benchmarks candidate kernels for every registered shape not tuned yet
+     * (e.g. not loaded from file) and stores the fastest one.
+     * \param force  if true, re-tunes all registered shapes
+     * \return  number of shapes tuned
+     */
+    static int tune (bool force=false);
+    /**
+     * Provides tuned kernel for product shape.
+     * \return  tuned kernel, KERNEL_SCALAR if shape is not tuned
+     */
+    static kernel_t kernel (uint8_t m, uint8_t k, uint8_t n);
+    /**
+     * Multiplies matrix A and B with the given kernel.
+     * \param kernel  kernel to use
+     * \param A       left matrix to multiply
+     * \param B       right matrix to multiply
+     * \param R       resulting matrix
+     * \return  true if successful, false otherwise.
+     */
+    static bool multiply (kernel_t kernel, const MatrixR & A, 
+                                           const MatrixR & B, MatrixR & R);
+    /**
+     * Multiplies matrix A and B with the tuned kernel for their shape.
+     * \param A  left matrix to multiply
+     * \param B  right matrix to multiply
+     * \param R  resulting matrix
+     * \return  true if successful, false otherwise.
+     */
+    static bool multiply (const MatrixR & A, const MatrixR & B, MatrixR & R)
+    {
+      return multiply(_count? kernel(A.nrows(),A.ncols(),B.ncols()) : 
+                                                     KERNEL_SCALAR, A, B, R);
+    }
+    /**
+     * Saves dispatch table to file, tagged with precision and cpu model.
+     * \param filename  file to write
+     * \return  true if successful, false otherwise.
+     */
+    static bool save (const char * filename);
+    /**
+     * Loads dispatch table from file saved on the same hardware and 
+     * precision, so that loaded shapes are not tuned again.
+     * \param filename  file to read
+     * \return  true if successful, false if missing or from other hardware.
+     */
+    static bool load (const char * filename);
+    /**
+     * Clears dispatch table.
+     */
+    static void reset () { _count = 0; }
+    /**
+     * Provides kernel name.
+     * \param kernel  kernel
+     * \return  kernel name
+     */
+    static const char * name (kernel_t kernel);
+#if defined(__linux__)
+    /**
+     * Outputs dispatch table.
+     * \param os  output stream
+     */
+    static void print (std::ostream & os);
+#endif
+
+  protected:
+    /**
+     * Dispatch table entry.
+     */
+    struct Shape
+    {
+      uint8_t m, k, n;  /**< product shape (mxk)*(kxn) */
+      kernel_t kernel;  /**< fastest kernel */
+      bool tuned;       /**< kernel has been benchmarked or loaded */
+    };
+    static int find (uint8_t m, uint8_t k, uint8_t n);
+
+    static Shape _shapes[BLOB_TUNER_MAX_SHAPES]; /**< dispatch table */
+    static int _count;                           /**< registered shapes */
+};
+
+}
+
+#endif // B_TUNER_H
@@ -58,10 +58,7 @@ class Vector : public Matrix<T>
     {
       if(this->length()!=v.length())
         return 0;
-      T sum=0;
-      for(int i=0;i<this->length();i++)
-        sum+=this->_data[i]*v[i];  
-      return sum;
+      return Matrix<T>::dot(this->_data, 1, v.data(), 1, this->length());
     }
     /**
      * Provides the angle between this vector and another vector
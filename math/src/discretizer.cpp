@@ -0,0 +1,102 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * \file       discretizer.cpp
+ * \brief      implementation of cached discretization of continuous models
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2017 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include "blob/discretizer.h"
+#include "blob/math.h"
+
+#if defined(__DEBUG__) & defined(__linux__)
+ #include <iostream>
+#endif
+
+blob::Discretizer::Discretizer (const MatrixR & A, const MatrixR & Q) : 
+                                                            _A(A), _Q(Q)
+{
+  _hits = 0;
+  _misses = 0;
+  reset();
+}
+
+void blob::Discretizer::reset ()
+{
+  _count = 0;
+  _clock = 0;
+}
+
+bool blob::Discretizer::discretize (real_t dt, MatrixR & Phi, MatrixR & Qd)
+{
+  int n = _A.nrows();
+  if(n > BLOB_DISCRETIZER_MAX_N)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "Discretizer::discretize() error: n=" << n << " > " 
+              << BLOB_DISCRETIZER_MAX_N << std::endl;
+#endif
+    return false;
+  }
+
+  _clock++;
+
+  // lookup
+  for(int k=0; k<_count; k++)
+  {
+    if(math::rabs(_dt[k] - dt) <= BLOB_DISCRETIZER_DT_TOLERANCE*math::rabs(dt))
+    {
+      MatrixR CPhi(n,n,_phi[k]), CQd(n,n,_qd[k]);
+      if(!Phi.copy(CPhi) || !Qd.copy(CQd))
+        return false;
+      _used[k] = _clock;
+      _hits++;
+      return true;
+    }
+  }
+
+  // miss: compute and store into free or least recently used entry
+  if(!MatrixR::discretize(_A, _Q, dt, Phi, Qd))
+    return false;
+  _misses++;
+
+  int k = _count;
+  if(_count < BLOB_DISCRETIZER_SIZE)
+    _count++;
+  else
+  {
+    k = 0;
+    for(int i=1; i<_count; i++)
+      if(_used[i] < _used[k])
+        k = i;
+  }
+  MatrixR CPhi(n,n,_phi[k]), CQd(n,n,_qd[k]);
+  CPhi.copy(Phi);
+  CQd.copy(Qd);
+  _dt[k] = dt;
+  _used[k] = _clock;
+  return true;
+}
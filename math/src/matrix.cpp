@@ -29,14 +29,247 @@
  ******************************************************************************/
 #include "blob/matrix.h"
 #include "blob/math.h"
+#include "blob/tuner.h"
 
 #if defined(__linux__)
  #include <iostream>
 #endif
 
+#if !defined(BLOB_MATRIX_JACOBI_SWEEPS)
+ #define BLOB_MATRIX_JACOBI_SWEEPS 30
+#endif
+
+#if !defined(BLOB_MATRIX_EPS)
+ #define BLOB_MATRIX_EPS ((sizeof(real_t)==sizeof(float))? 1.19e-7:2.22e-16)
+#endif
+
+#if !defined(BLOB_MATRIX_EXPM_PADE)
+ #define BLOB_MATRIX_EXPM_PADE 6
+#endif
+
+#if !defined(BLOB_MATRIX_RCOND_ITERATIONS)
+ #define BLOB_MATRIX_RCOND_ITERATIONS 5
+#endif
+
+#if !defined(BLOB_MATRIX_REGULARIZE_ITERATIONS)
+ #define BLOB_MATRIX_REGULARIZE_ITERATIONS 8
+#endif
+
 blob::MatrixR::MatrixR (uint8_t rows, uint8_t cols, real_t *data) : 
                                               Matrix<real_t>(rows,cols,data) {};
 
+bool blob::MatrixR::multiply (const MatrixR & A, const MatrixR & B, MatrixR & R)
+{
+  // vector operands go to gemv/gemvT/ger kernels
+  if((B.ncols() == 1) || (A.nrows() == 1) || (A.ncols() == 1))
+    return R.Matrix<real_t>::multiply(A,B);
+  return Tuner::multiply(A,B,R);
+}
+
+void blob::MatrixR::weightedMean (const real_t * U, int l, int N, 
+                                  const real_t * w, real_t * mu)
+{
+  BLOB_COUNT("weightedMean", 2*(uint64_t)l*N, sizeof(real_t)*(l*N + N + l));
+  for(int i=0; i<l; i++)
+    mu[i] = dot(&U[i*N], 1, w, 1, N);
+}
+
+void blob::MatrixR::weightedCov (const real_t * U, int l, int N, 
+                                 const real_t * w, const real_t * mu, 
+                                 real_t * P, real_t * D, real_t * wd)
+{
+  BLOB_COUNT("weightedCov", (uint64_t)l*N*(l + 3), 
+             sizeof(real_t)*(2*l*N + N + l + l*l));
+  for(int i=0; i<l; i++)
+  {
+    const real_t * u = &U[i*N];
+    real_t * di = &D[i*N];
+    for(int k=0; k<N; k++)
+      di[k] = u[k] - mu[i];
+    for(int k=0; k<N; k++)
+      wd[k] = di[k]*w[k];
+    for(int j=0; j<=i; j++)
+      P[i*l+j] = P[j*l+i] = dot(wd, 1, &D[j*N], 1, N);
+  }
+}
+
+bool blob::MatrixR::weightedMean (const MatrixR & U, const MatrixR & w, 
+                                  MatrixR & mu)
+{
+  if((w.length() != U.ncols())||(mu.length() != U.nrows())||
+     ((w.nrows() != 1)&&(w.ncols() != 1))||((mu.nrows() != 1)&&(mu.ncols() != 1)))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::weightedMean() error: " << (int)w.length() << "==" 
+              << (int)U.ncols() << "?" << (int)mu.length() << "==" 
+              << (int)U.nrows() << "?" << std::endl;
+#endif
+    return false;
+  }
+  weightedMean(U.data(), U.nrows(), U.ncols(), w.data(), mu.data());
+  return true;
+}
+
+bool blob::MatrixR::weightedCov (const MatrixR & U, const MatrixR & w, 
+                                 const MatrixR & mu, MatrixR & P, MatrixR * D)
+{
+  uint8_t l = U.nrows();
+  if((w.length() != U.ncols())||(mu.length() != l)||
+     (P.nrows() != l)||(P.ncols() != l)||
+     (D && ((D->nrows() != l)||(D->ncols() != U.ncols()))))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::weightedCov() error: " << (int)w.length() << "==" 
+              << (int)U.ncols() << "?" << (int)mu.length() << "==" << (int)l 
+              << "?" << (int)P.nrows() << "x" << (int)P.ncols() << "==" 
+              << (int)l << "x" << (int)l << "?" << std::endl;
+#endif
+    return false;
+  }
+  BLOB_MATRIX_ALIGNED real_t wd[U.ncols()]; // w.*D(i,:)
+  BLOB_MATRIX_ALIGNED real_t d[D? 1 : l*U.ncols()];
+  weightedCov(U.data(), l, U.ncols(), w.data(), mu.data(), P.data(), 
+              D? D->data() : d, wd);
+  return true;
+}
+
+bool blob::MatrixR::weightedCross (const MatrixR & A, const MatrixR & B, 
+                                   const MatrixR & w, MatrixR & P)
+{
+  int N = A.ncols();
+  if((B.ncols() != N)||(w.length() != N)||
+     (P.nrows() != A.nrows())||(P.ncols() != B.nrows()))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::weightedCross() error: " << (int)B.ncols() << "==" 
+              << N << "==" << (int)w.length() << "?" << (int)P.nrows() << "x" 
+              << (int)P.ncols() << "==" << (int)A.nrows() << "x" 
+              << (int)B.nrows() << "?" << std::endl;
+#endif
+    return false;
+  }
+
+  BLOB_MATRIX_ALIGNED real_t wa[N]; // w.*A(i,:)
+  BLOB_COUNT("weightedCross", (uint64_t)A.nrows()*N*(2*B.nrows() + 1), 
+             sizeof(real_t)*(A.length() + B.length() + N + P.length()));
+  const real_t * a = A.data();
+  const real_t * b = B.data();
+  for(int i=0; i<A.nrows(); i++)
+  {
+    for(int k=0; k<N; k++)
+      wa[k] = a[i*N+k]*w[k];
+    for(int j=0; j<B.nrows(); j++)
+      P(i,j) = dot(wa, 1, &b[j*N], 1, N);
+  }
+  return true;
+}
+
+// solves A*x=b (or A'*x=b if trans) in place from Cholesky (A=L*L') or LU 
+// (A=L*U, unit L) factor F; returns false on zero pivot
+static bool factorSolve (const blob::MatrixR & F, bool lu, bool trans, 
+                                                             real_t * x)
+{
+  int n = F.nrows();
+  const real_t *f = F.data();
+
+  if(!lu || !trans)
+  {
+    // forward solve L*y = b (Cholesky: L, LU: unit L)
+    for(int i=0; i<n; i++)
+    {
+      x[i] -= blob::MatrixR::dot(&f[i*n], 1, x, 1, i);
+      if(!lu)
+      {
+        if(f[i*n + i] == 0) return false;
+        x[i] /= f[i*n + i];
+      }
+    }
+    // backward solve L'*x = y (Cholesky) or U*x = y (LU)
+    for(int i=n-1; i>=0; i--)
+    {
+      if(lu)
+        x[i] -= blob::MatrixR::dot(&f[i*n + i+1], 1, &x[i+1], 1, n-i-1);
+      else
+        x[i] -= blob::MatrixR::dot(&f[(i+1)*n + i], n, &x[i+1], 1, n-i-1);
+      if(f[i*n + i] == 0) return false;
+      x[i] /= f[i*n + i];
+    }
+  }
+  else
+  {
+    // forward solve U'*y = b
+    for(int i=0; i<n; i++)
+    {
+      x[i] -= blob::MatrixR::dot(&f[i], n, x, 1, i);
+      if(f[i*n + i] == 0) return false;
+      x[i] /= f[i*n + i];
+    }
+    // backward solve L'*x = y (unit L)
+    for(int i=n-1; i>=0; i--)
+      x[i] -= blob::MatrixR::dot(&f[(i+1)*n + i], n, &x[i+1], 1, n-i-1);
+  }
+  return true;
+}
+
+// estimates norm1(inv(A)) from factor F of A (Hager/Higham), -1 if singular
+static real_t invnorm1 (const blob::MatrixR & F, bool lu)
+{
+  int n = F.nrows();
+  real_t x[n], y[n], z[n];
+  real_t est = 0;
+
+  for(int i=0; i<n; i++)
+    x[i] = (real_t)1/n;
+
+  for(int it=0; it<BLOB_MATRIX_RCOND_ITERATIONS; it++)
+  {
+    // y = inv(A)*x
+    memcpy(y, x, sizeof(real_t)*n);
+    if(!factorSolve(F, lu, false, y))
+      return -1;
+
+    real_t ny = 0;
+    for(int i=0; i<n; i++)
+      ny += blob::math::rabs(y[i]);
+    if(it > 0 && ny <= est)
+      break;
+    est = ny;
+
+    // z = inv(A)'*sign(y)
+    for(int i=0; i<n; i++)
+      z[i] = (y[i] < 0)? -1:1;
+    if(!factorSolve(F, lu, true, z))
+      return -1;
+
+    int j = 0;
+    real_t ztx = 0;
+    for(int i=0; i<n; i++)
+    {
+      ztx += z[i]*x[i];
+      if(blob::math::rabs(z[i]) > blob::math::rabs(z[j]))
+        j = i;
+    }
+    if(it > 0 && blob::math::rabs(z[j]) <= ztx)
+      break;
+
+    // x = e(j)
+    memset(x, 0, sizeof(real_t)*n);
+    x[j] = 1;
+  }
+
+  // alternative estimate (Higham) for matrices where Hager underestimates
+  for(int i=0; i<n; i++)
+    x[i] = ((i%2)? -1:1)*(1 + ((n>1)? (real_t)i/(n-1):0));
+  if(!factorSolve(F, lu, false, x))
+    return -1;
+  real_t alt = 0;
+  for(int i=0; i<n; i++)
+    alt += blob::math::rabs(x[i]);
+  alt = 2*alt/(3*n);
+
+  return (alt > est)? alt:est;
+}
+
 bool blob::MatrixR::cholesky (bool zero)
 {
   bool retval = true;
@@ -45,18 +278,14 @@ bool blob::MatrixR::cholesky (bool zero)
   {
     real_t t;
     uint8_t n = _nrows;
-    int i=0,j=0,k=0;
+    int i=0,j=0;
+    BLOB_COUNT("cholesky", (uint64_t)n*n*n/3, 2*sizeof(real_t)*n*n);
     for(i=0 ; i<n && retval == true; i++) 
     {
       if(i > 0) 
       {
         for(j=i; j<n; j++) 
-        {
-          t = 0;
-          for(k=0; k<i; k++)
-            t += _data[j*n + k]*_data[i*n + k];
-          _data[j*n+i] -= t;
-        }
+          _data[j*n+i] -= dot(&_data[j*n], 1, &_data[i*n], 1, i);
       }
       if(_data[i*n + i] <= 0) 
       {
@@ -125,6 +354,7 @@ bool blob::MatrixR::cholupdate (MatrixR & v, int sign)
     return false;
   }
 
+  BLOB_COUNT("cholupdate", 4*(uint64_t)n*n, sizeof(real_t)*(2*n*n + 2*n));
   for (int i=0; i<n; i++)
   {
     real_t sr = _data[i*n+i]*_data[i*n+i] + (real_t)sign*v[i]*v[i];
@@ -170,6 +400,173 @@ bool blob::MatrixR::cholupdate (MatrixR & v, int sign)
   return true;
 }
 
+bool blob::MatrixR::pcholesky (uint8_t * piv, uint8_t * rank, real_t tol)
+{
+  if(_nrows != _ncols)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::pcholesky() error: Matrix is not square" 
+              << std::endl;
+#endif
+    return false;
+  }
+
+  uint8_t n = _nrows;
+  uint8_t p[n];
+  BLOB_MATRIX_ALIGNED real_t dots[n]; // squared norms of computed L rows
+  BLOB_COUNT("pcholesky", (uint64_t)n*n*n/3, 2*sizeof(real_t)*n*n);
+
+  // symmetric swaps need full matrix
+  for(int i=0; i<n; i++)
+  {
+    p[i] = i;
+    dots[i] = 0;
+    for(int j=0; j<i; j++)
+      _data[j*n+i] = _data[i*n+j];
+  }
+
+  int j = 0;
+  for(; j<n; j++)
+  {
+    if(j > 0)
+      for(int i=j; i<n; i++)
+        dots[i] += _data[i*n+j-1]*_data[i*n+j-1];
+
+    // q = argmax{L(i,i)-dots(i)}_i=j:n
+    int q = j;
+    real_t mm = _data[j*n+j] - dots[j];
+    for(int i=j+1; i<n; i++)
+    {
+      real_t res = _data[i*n+i] - dots[i];
+      if(res > mm)
+      {
+        mm = res;
+        q = i;
+      }
+    }
+    if((j == 0) && (tol < 0))
+      tol = n*BLOB_MATRIX_EPS*((mm > 0)? mm:0);
+    // stopping criteria: remaining matrix is numerically null
+    if(mm <= tol)
+      break;
+
+    if(q != j)
+    {
+      real_t swap;
+      for(int i=0; i<n; i++)
+      {
+        swap = _data[j*n+i]; _data[j*n+i] = _data[q*n+i]; _data[q*n+i] = swap;
+      }
+      for(int i=0; i<n; i++)
+      {
+        swap = _data[i*n+j]; _data[i*n+j] = _data[i*n+q]; _data[i*n+q] = swap;
+      }
+      swap = dots[j]; dots[j] = dots[q]; dots[q] = swap;
+      uint8_t s = p[j]; p[j] = p[q]; p[q] = s;
+    }
+
+    real_t ljj = blob::math::sqrtr(mm);
+    _data[j*n+j] = ljj;
+    for(int i=j+1; i<n; i++)
+      _data[i*n+j] = (_data[i*n+j] - dot(&_data[i*n], 1, &_data[j*n], 1, j))/ljj;
+  }
+
+  for(int i=0; i<n; i++)
+    for(int c=(i<j)? i+1:j; c<n; c++)
+      _data[i*n+c] = 0;
+
+#if defined(__DEBUG__) & defined(__linux__)
+  if(j < n)
+    std::cerr << "MatrixR::pcholesky() warning: rank " << j << " < " << (int)n
+              << std::endl;
+#endif
+
+  if(piv)
+    for(int i=0; i<n; i++)
+      piv[i] = p[i];
+  if(rank)
+    *rank = j;
+  return true;
+}
+
+bool blob::MatrixR::mcholesky (real_t * shift)
+{
+  if(_nrows != _ncols)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::mcholesky() error: Matrix is not square" 
+              << std::endl;
+#endif
+    return false;
+  }
+
+  uint8_t n = _nrows;
+  BLOB_MATRIX_ALIGNED real_t d[n];
+  BLOB_MATRIX_ALIGNED real_t w[n]; // d[k]*L(j,k) of current row
+  BLOB_COUNT("mcholesky", (uint64_t)n*n*n/3, 2*sizeof(real_t)*n*n);
+
+  // bound on elements of L: beta^2 = max(gamma, xi/nu, eps)
+  real_t gamma = 0, xi = 0;
+  for(int i=0; i<n; i++)
+  {
+    real_t a = blob::math::rabs(_data[i*n+i]);
+    gamma = (a > gamma)? a:gamma;
+    for(int j=0; j<i; j++)
+    {
+      a = blob::math::rabs(_data[i*n+j]);
+      xi = (a > xi)? a:xi;
+    }
+  }
+  real_t nu = (n > 1)? blob::math::sqrtr((real_t)n*n - 1):1;
+  real_t beta2 = gamma;
+  beta2 = (xi/nu > beta2)? xi/nu:beta2;
+  beta2 = (BLOB_MATRIX_EPS > beta2)? BLOB_MATRIX_EPS:beta2;
+  real_t delta = BLOB_MATRIX_EPS*((gamma + xi > 1)? gamma + xi:1);
+  real_t emax = 0;
+
+  for(int j=0; j<n; j++)
+  {
+    real_t * lj = &_data[j*n];
+    for(int k=0; k<j; k++)
+      w[k] = d[k]*lj[k];
+    real_t cjj = lj[j] - dot(w, 1, lj, 1, j);
+
+    // c(i,j) stored in L(i,j) until d(j) is known
+    real_t theta = 0;
+    for(int i=j+1; i<n; i++)
+    {
+      real_t * li = &_data[i*n];
+      li[j] -= dot(li, 1, w, 1, j);
+      real_t a = blob::math::rabs(li[j]);
+      theta = (a > theta)? a:theta;
+    }
+
+    real_t dj = blob::math::rabs(cjj);
+    dj = (theta*theta/beta2 > dj)? theta*theta/beta2:dj;
+    dj = (delta > dj)? delta:dj;
+    emax = (dj - cjj > emax)? dj - cjj:emax;
+    d[j] = dj;
+    for(int i=j+1; i<n; i++)
+      _data[i*n+j] /= dj;
+  }
+
+  // L = L*sqrt(D)
+  for(int j=0; j<n; j++)
+  {
+    real_t s = blob::math::sqrtr(d[j]);
+    _data[j*n+j] = s;
+    for(int i=j+1; i<n; i++)
+    {
+      _data[i*n+j] *= s;
+      _data[j*n+i] = 0;
+    }
+  }
+
+  if(shift)
+    *shift = emax;
+  return true;
+}
+
 bool blob::MatrixR::cholrestore (bool zero)
 {
   bool retval = false;
@@ -214,6 +611,7 @@ bool blob::MatrixR::cholinverse ()
   if(_nrows == _ncols)
   {
     uint8_t n = _nrows;
+    BLOB_COUNT("cholinverse", (uint64_t)n*n*n/3, 2*sizeof(real_t)*n*n);
     for(int i=0; i<n; i++)
     {
       _data[i*n + i] = 1/_data[i*n + i];
@@ -244,6 +642,8 @@ bool blob::MatrixR::lu()
     return false;
   }
 
+  BLOB_COUNT("lu", 2*(uint64_t)_ncols*_ncols*_ncols/3, 
+                                           2*sizeof(real_t)*this->length());
   for(int k=0; k<_ncols-1; k++)
   {
     for(int j=k+1; j<_ncols; j++) 
@@ -284,6 +684,204 @@ bool blob::MatrixR::lurestore()
   return true;
 }
 
+bool blob::MatrixR::ldl (bool zero)
+{
+  if(_nrows != _ncols)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::ldl() error: Matrix is not square" << std::endl;
+#endif
+    return false;
+  }
+
+  uint8_t n = _nrows;
+  BLOB_MATRIX_ALIGNED real_t w[n]; // d[k]*L(j,k) of current row
+  BLOB_COUNT("ldl", (uint64_t)n*n*n/3, 2*sizeof(real_t)*n*n);
+  for(int j=0; j<n; j++)
+  {
+    real_t * lj = &_data[j*n];
+    real_t t = lj[j];
+    for(int k=0; k<j; k++)
+    {
+      w[k] = _data[k*n+k]*lj[k];
+      t -= w[k]*lj[k];
+    }
+    if(t == 0.0)
+    {
+#if defined(__DEBUG__) & defined(__linux__)
+      std::cerr << "MatrixR::ldl() error: zero pivot " << j << std::endl;
+#endif
+      return false;
+    }
+    lj[j] = t;
+    for(int i=j+1; i<n; i++)
+    {
+      real_t * li = &_data[i*n];
+      li[j] = (li[j] - dot(li, 1, w, 1, j))/t;
+    }
+    if(zero)
+      for(int i=j+1; i<n; i++)
+        lj[i] = 0;
+  }
+  return true;
+}
+
+bool blob::MatrixR::ldlupdate (MatrixR & v, real_t alpha)
+{
+  uint8_t n = _nrows;
+
+  if(_nrows != _ncols)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::ldlupdate() error: Matrix is not square"<< std::endl;
+#endif
+    return false;
+  }
+
+  if((v.length() != n)||((v.nrows() != 1)&&(v.ncols() != 1)))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::ldlupdate() error: vector not 1x" << (int)n 
+              << std::endl;
+#endif
+    return false;
+  }
+
+  BLOB_COUNT("ldlupdate", 4*(uint64_t)n*n/2, sizeof(real_t)*(n*n + 2*n));
+  real_t a = alpha;
+  for(int j=0; j<n && a != 0.0; j++)
+  {
+    real_t p = v[j];
+    real_t dj = _data[j*n+j];
+    real_t d = dj + a*p*p;
+    if((d == 0.0) || ((dj > 0) != (d > 0)))
+    {
+#if defined(__DEBUG__) & defined(__linux__)
+      std::cerr << "MatrixR::ldlupdate() error: Result is not definite"
+                << std::endl;
+#endif
+      return false;
+    }
+    real_t beta = p*a/d;
+    a *= dj/d;
+    _data[j*n+j] = d;
+    for(int r=j+1; r<n; r++)
+    {
+      v[r] -= p*_data[r*n+j];
+      _data[r*n+j] += beta*v[r];
+    }
+  }
+  return true;
+}
+
+bool blob::MatrixR::ldlsolve (MatrixR & X) const
+{
+  uint8_t n = _nrows;
+
+  if((_nrows != _ncols)||(X.nrows() != n))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::ldlsolve() error: " << (int)_nrows << "==" 
+              << (int)_ncols << "==" << (int)X.nrows() << "?" << std::endl;
+#endif
+    return false;
+  }
+
+  uint8_t m = X.ncols();
+  real_t * x = X.data();
+  BLOB_COUNT("ldlsolve", 2*(uint64_t)n*n*m, sizeof(real_t)*(n*n + 2*n*m));
+  // L*y = b, forward substitution
+  for(int i=1; i<n; i++)
+    for(int k=0; k<i; k++)
+      for(int c=0; c<m; c++)
+        x[i*m+c] -= _data[i*n+k]*x[k*m+c];
+  // D*z = y
+  for(int i=0; i<n; i++)
+  {
+    if(_data[i*n+i] == 0.0)
+      return false;
+    real_t t = 1/_data[i*n+i];
+    for(int c=0; c<m; c++)
+      x[i*m+c] *= t;
+  }
+  // L'*x = z, backward substitution
+  for(int i=n-2; i>=0; i--)
+    for(int k=i+1; k<n; k++)
+      for(int c=0; c<m; c++)
+        x[i*m+c] -= _data[k*n+i]*x[k*m+c];
+  return true;
+}
+
+bool blob::MatrixR::cholsolve (MatrixR & X) const
+{
+  uint8_t n = _nrows;
+
+  if((_nrows != _ncols)||(X.nrows() != n))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::cholsolve() error: " << (int)_nrows << "==" 
+              << (int)_ncols << "==" << (int)X.nrows() << "?" << std::endl;
+#endif
+    return false;
+  }
+
+  uint8_t m = X.ncols();
+  real_t * x = X.data();
+  BLOB_COUNT("cholsolve", 2*(uint64_t)n*n*m, sizeof(real_t)*(n*n + 2*n*m));
+  // L*y = b, forward substitution
+  for(int i=0; i<n; i++)
+  {
+    if(_data[i*n+i] == 0.0)
+      return false;
+    real_t t = 1/_data[i*n+i];
+    for(int k=0; k<i; k++)
+      for(int c=0; c<m; c++)
+        x[i*m+c] -= _data[i*n+k]*x[k*m+c];
+    for(int c=0; c<m; c++)
+      x[i*m+c] *= t;
+  }
+  // L'*x = y, backward substitution
+  for(int i=n-1; i>=0; i--)
+  {
+    real_t t = 1/_data[i*n+i];
+    for(int k=i+1; k<n; k++)
+      for(int c=0; c<m; c++)
+        x[i*m+c] -= _data[k*n+i]*x[k*m+c];
+    for(int c=0; c<m; c++)
+      x[i*m+c] *= t;
+  }
+  return true;
+}
+
+bool blob::MatrixR::ldlrestore ()
+{
+  if(_nrows != _ncols)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::ldlrestore() error: Matrix is not square" 
+              << std::endl;
+#endif
+    return false;
+  }
+
+  uint8_t n = _nrows;
+  BLOB_MATRIX_ALIGNED real_t w[n];
+  // row i of A only depends on rows k<=i of factorization: restore bottom-up
+  for(int i=n-1; i>=0; i--)
+  {
+    real_t * li = &_data[i*n];
+    for(int k=0; k<i; k++)
+      w[k] = _data[k*n+k]*li[k];
+    li[i] += dot(w, 1, li, 1, i);
+    for(int j=0; j<i; j++)
+    {
+      li[j] = w[j] + dot(w, 1, &_data[j*n], 1, j);
+      _data[j*n+i] = li[j];
+    }
+  }
+  return true;
+}
+
 bool blob::MatrixR::inverse (bool isPositiveDefinite)
 {
   bool retval = false;
@@ -293,6 +891,7 @@ bool blob::MatrixR::inverse (bool isPositiveDefinite)
   {
   // reconstruct inverse of A: inv(A) = inv(L)'*inv(L)
     uint8_t n = _nrows;
+    BLOB_COUNT("inverse", (uint64_t)n*n*n/3, 2*sizeof(real_t)*n*n);
     for(int i=0; i<n; i++)
     {
       int ii = n-i-1;
@@ -320,7 +919,7 @@ bool blob::MatrixR::inverse (bool isPositiveDefinite)
   } 
   else // lu decomposition inverse
   {
-    real_t r[this->length()]; //real_t r[MATRIX_MAX_LENGTH];
+    BLOB_MATRIX_ALIGNED real_t r[this->length()]; //real_t r[MATRIX_MAX_LENGTH];
     MatrixR LU(this->nrows(),this->ncols(),r);
 
     if( blob::MatrixR::lu(*this,LU)==true )
@@ -331,6 +930,7 @@ bool blob::MatrixR::inverse (bool isPositiveDefinite)
       memset(y,0,sizeof(real_t)*this->nrows()); //memset(y,0,sizeof(real_t)*MATRIX_MAX_ROWCOL); 
 
       uint8_t n = _nrows;
+      BLOB_COUNT("inverse", 2*(uint64_t)n*n*n, 3*sizeof(real_t)*n*n);
 
       for(int c=0;c<n;c++)
       { 
@@ -394,6 +994,71 @@ bool blob::MatrixR::forcePositive ()
   return retval;
 }
 
+bool blob::MatrixR::regularize (real_t rcondMin, real_t * rcond)
+{
+  if(_nrows != _ncols)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::regularize() error: Matrix is not square"
+              << std::endl;
+#endif
+    return false;
+  }
+
+  uint8_t n = _nrows;
+  BLOB_MATRIX_ALIGNED real_t l[n*n];
+  blob::MatrixR L(n,n,l);
+
+  real_t anorm = norm1();
+  real_t scale = (anorm > 0)? anorm:1;
+  real_t jitter = 0;
+  real_t rc = 0;
+
+  for(int it=0; it<BLOB_MATRIX_REGULARIZE_ITERATIONS; it++)
+  {
+    L.copy(*this);
+    for(int i=0; i<n; i++)
+      L[i*n + i] += jitter;
+
+    if(L.cholesky(false) == true)
+    {
+      rc = cholrcond(anorm + jitter, L);
+      if(rc >= rcondMin)
+        break;
+      // (lmin+d)/(lmax+d) >= rcondMin with lmax ~ norm1, lmin ~ rc*norm1,
+      // aiming slightly above rcondMin to absorb estimation error
+      jitter += (anorm + jitter)*(1.01f*rcondMin - rc)/(1 - rcondMin);
+    }
+    else
+    {
+      rc = 0;
+      jitter = (jitter > 0)? 2*jitter : scale*rcondMin;
+    }
+  }
+
+  if(rcond)
+    *rcond = rc;
+
+  if(rc < rcondMin)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::regularize() error: rcond=" << rc << " < " 
+              << rcondMin << std::endl;
+#endif
+    return false;
+  }
+
+  if(jitter > 0)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cout << "MatrixR::regularize() jitter=" << jitter << std::endl;
+#endif
+    for(int i=0; i<n; i++)
+      _data[i*n + i] += jitter;
+  }
+  return true;
+}
+
 bool blob::MatrixR::simmetrize ()
 {
   bool retval = false;
@@ -429,22 +1094,22 @@ bool blob::MatrixR::divide (const blob::MatrixR & A, blob::MatrixR & B,
      (R.ncols() == n)&&
       B.cholesky(false) == true)
   {
+    BLOB_COUNT("divide", 2*(uint64_t)m*n*n, 
+                        sizeof(real_t)*(2*m*n + (uint64_t)m*n*n));
     for(int c = 0; c<m; c++)
     {
       // forward solve Ly = I(c)
       for(int i = 0; i<n; i++)
       {
-        R(c,i) = A(c,i);
-        for(int j=0; j<i; j++)
-          R(c,i) -= B(i,j)*R(c,j);
+        R(c,i) = A(c,i) - dot(&B.data()[i*n], 1, &R.data()[c*n], 1, i);
         R(c,i) /= B(i,i);
       }
 
       // backward solve L'x = y
       for(int i=n-1; i>=0; i--)
       {
-        for (int j=i+1; j<n; j++)
-          R(c,i) -= B(j,i)*R(c,j);
+        R(c,i) -= dot(&B.data()[(i+1)*n + i], n, &R.data()[c*n + i+1], 1, 
+                                                                     n-i-1);
         R(c,i) /= B(i,i);
       }
     }
@@ -466,15 +1131,12 @@ bool blob::MatrixR::cholesky (const blob::MatrixR & A, blob::MatrixR & L)
      (A.nrows() == L.nrows()) && 
      (A.ncols() == L.ncols()))
   {
+    BLOB_COUNT("cholesky", (uint64_t)n*n*n/3, 2*sizeof(real_t)*n*n);
     for (int i = 0; i < n; i++)
     {
       for (int j = 0; j < (i+1); j++)
       {
-        real_t s = 0;
-        for (int k = 0; k < j; k++)
-        {
-          s += L[i*n + k]*L[j*n + k];
-        }
+        real_t s = dot(&L.data()[i*n], 1, &L.data()[j*n], 1, j);
         if(i==j && (A[i*n + i] - s) <=0)
         {
 #if defined(__DEBUG__) & defined(__linux__)
@@ -514,23 +1176,23 @@ bool blob::MatrixR::inverse (blob::MatrixR & A, blob::MatrixR & R,
     if(isPositiveDefinite == true && A.cholesky(false) == true) // A=L
     {
       uint8_t n = R.nrows();
+      BLOB_COUNT("inverse", 2*(uint64_t)n*n*n, 
+                                  sizeof(real_t)*(n*n + (uint64_t)n*n*n));
 
       for(int c = 0; c<n; c++)
       {
         // forward solve Ly = I(c)
         for(int i = 0; i<n; i++)
         {
-          R(c,i) = (c==i)? 1:0;
-          for(int j=0; j<i; j++)
-            R(c,i) -= A(i,j)*R(c,j);
+          R(c,i) = ((c==i)? 1:0) - dot(&A.data()[i*n], 1, &R.data()[c*n], 1, i);
           R(c,i) /= A(i,i);
         }
 
         // backward solve L'x = y
         for(int i=n-1; i>=0; i--)
         {
-          for (int j=i+1; j<n; j++)
-            R(c,i) -= A(j,i)*R(c,j);
+          R(c,i) -= dot(&A.data()[(i+1)*n + i], n, &R.data()[c*n + i+1], 1, 
+                                                                       n-i-1);
           R(c,i) /= A(i,i);
         }
       }
@@ -546,6 +1208,7 @@ bool blob::MatrixR::inverse (blob::MatrixR & A, blob::MatrixR & R,
       R.zero();
 
       uint8_t n = R.nrows();
+      BLOB_COUNT("inverse", 2*(uint64_t)n*n*n, 3*sizeof(real_t)*n*n);
 
       for(int c=0;c<n;c++)
       { 
@@ -610,6 +1273,38 @@ bool blob::MatrixR::cholinverse (const blob::MatrixR & L, blob::MatrixR & R)
   return retval;
 }
 
+real_t blob::MatrixR::cholrcond (real_t anorm, const blob::MatrixR & L)
+{
+  if(L.nrows() != L.ncols())
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::cholrcond() error: Matrix is not square" << std::endl;
+#endif
+    return 0;
+  }
+  real_t ainvnorm = invnorm1(L, false);
+  if(anorm <= 0 || ainvnorm <= 0)
+    return 0;
+  real_t rc = 1/(anorm*ainvnorm);
+  return (rc > 1)? 1:rc;
+}
+
+real_t blob::MatrixR::lurcond (real_t anorm, const blob::MatrixR & LU)
+{
+  if(LU.nrows() != LU.ncols())
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::lurcond() error: Matrix is not square" << std::endl;
+#endif
+    return 0;
+  }
+  real_t ainvnorm = invnorm1(LU, true);
+  if(anorm <= 0 || ainvnorm <= 0)
+    return 0;
+  real_t rc = 1/(anorm*ainvnorm);
+  return (rc > 1)? 1:rc;
+}
+
 bool blob::MatrixR::ldl (const blob::MatrixR & A, blob::MatrixR & L, 
                                                   blob::MatrixR & d)
 {
@@ -624,31 +1319,22 @@ bool blob::MatrixR::ldl (const blob::MatrixR & A, blob::MatrixR & L,
   if(((d.nrows() != 1)&&(d.ncols() != 1))||(d.length() != A.ncols()))
   {
 #if defined(__DEBUG__) & defined(__linux__)
-    std::cerr << "Matrix::ldl() error: Matrix is not square" << std::endl;
+    std::cerr << "Matrix::ldl() error: vector not 1x" << (int)A.ncols() 
+              << std::endl;
 #endif
     return false;
   }
 
   uint8_t n = A.nrows();
-  int i,j,k;
-  L.zero();
-  for(j=0; j<n; j++)
+  L.copy(A);
+  if(!L.ldl())
+    return false;
+  for(int j=0; j<n; j++)
   {
+    d[j] = L(j,j);
     L(j,j) = 1.0;
-    real_t t = A(j,j);
-    for(k=1; k<j; k++)
-      t -= d[k]*L(j,k)*L(j,k);
-    d[j] = t;
-    
-    for(i=j+1; i<n; i++)
-    {
-      L(j,i) = 0.0;
-      t = A(i,j);
-      for (k=1; k<j;k++)
-        t -= d[k]*L(i,k)*L(j,k);
-      L(i,j) = t/d[j];
-    }
   }
+  return true;
 }
 
 bool blob::MatrixR::qr (const MatrixR & A, MatrixR &Q, MatrixR & R)
@@ -687,8 +1373,9 @@ bool blob::MatrixR::qr (const MatrixR & A, MatrixR &Q, MatrixR & R)
   //real_t h[MATRIX_MAX_LENGTH];
   //real_t aux[MATRIX_MAX_LENGTH];
 
-  real_t h[A.nrows()*A.nrows()];
-  real_t aux[A.ncols()*A.nrows()];
+  BLOB_MATRIX_ALIGNED real_t h[A.nrows()*A.nrows()];
+  // aux holds both Q*H (mxm) and H*R (mxn)
+  BLOB_MATRIX_ALIGNED real_t aux[((m > n)? m:n)*m];
   
   Matrix H(m,m,h);
   Matrix Aux(m,n,aux);
@@ -733,6 +1420,62 @@ bool blob::MatrixR::qr (const MatrixR & A, MatrixR &Q, MatrixR & R)
 
   return true;
 }
+bool blob::MatrixR::qr (const MatrixR & A, MatrixR & R)
+{
+  uint8_t m = A.nrows();
+  uint8_t n = A.ncols();
+
+  if((m < n)||(R.nrows() != n)||(R.ncols() != n))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "Matrix::qr() error: " << (int)m << ">=" << (int)n << "?" 
+              << (int)R.nrows() << "x" << (int)R.ncols() << "==" << (int)n 
+              << "x" << (int)n << "?" << std::endl;
+#endif
+    return false;
+  }
+
+  BLOB_MATRIX_ALIGNED real_t w[m*n];
+  BLOB_COUNT("qr", 2*(uint64_t)n*n*(m - n/3), sizeof(real_t)*(2*m*n + n*n));
+  memcpy(w, A.data(), sizeof(real_t)*m*n);
+
+  for(int i=0; i<n; i++)
+  {
+    // householder vector v = w(i:m,i) - alpha*e1, alpha = -sign(w(i,i))*|.|
+    real_t nrm = 0;
+    for(int k=i; k<m; k++)
+      nrm += w[k*n+i]*w[k*n+i];
+    if(nrm == 0.0)
+      continue;
+    nrm = blob::math::sqrtr(nrm);
+    real_t alpha = (w[i*n+i] > 0)? -nrm : nrm;
+    real_t v0 = w[i*n+i] - alpha;
+    real_t vnrm = v0*v0 + nrm*nrm - w[i*n+i]*w[i*n+i];
+    if(vnrm <= 0.0)
+      continue;
+    w[i*n+i] = v0;
+    for(int j=i+1; j<n; j++)
+    {
+      real_t t = 0;
+      for(int k=i; k<m; k++)
+        t += w[k*n+i]*w[k*n+j];
+      t *= 2/vnrm;
+      for(int k=i; k<m; k++)
+        w[k*n+j] -= t*w[k*n+i];
+    }
+    w[i*n+i] = alpha;
+  }
+
+  // upper triangle, rows with negative diagonal flipped (Q columns flipped)
+  for(int i=0; i<n; i++)
+  {
+    real_t sign = (w[i*n+i] < 0)? -1:1;
+    for(int j=0; j<n; j++)
+      R(i,j) = (j < i)? 0 : sign*w[i*n+j];
+  }
+  return true;
+}
+
 // https://rosettacode.org/wiki/LU_decomposition 
 // TODO: Check why partial pivoting, applied but A=LU instead of PA=LU and result differs from octave and rosettacode 
 bool blob::MatrixR::lu (const MatrixR & A, MatrixR & L, MatrixR & U, MatrixR & P)
@@ -783,6 +1526,7 @@ bool blob::MatrixR::lu (const MatrixR & A, MatrixR & L, MatrixR & U, MatrixR & P
         U(j,l)=U(j,l)-L(j,k)*U(k,l);
     }
   }
+  return true;
 }
 
 bool blob::MatrixR::lu (const MatrixR & A, MatrixR & L, MatrixR & U)
@@ -815,6 +1559,7 @@ bool blob::MatrixR::lu (const MatrixR & A, MatrixR & L, MatrixR & U)
         U(j,l)=U(j,l)-L(j,k)*U(k,l);
     }
   }
+  return true;
 }
 
 bool blob::MatrixR::lu (const MatrixR & A, MatrixR & R)
@@ -836,6 +1581,8 @@ bool blob::MatrixR::lu (const MatrixR & A, MatrixR & R)
 
   R.copy(A);
 
+  BLOB_COUNT("lu", 2*(uint64_t)R.ncols()*R.ncols()*R.ncols()/3, 
+                                              2*sizeof(real_t)*R.length());
   for(int k=0; k<R.ncols()-1; k++)
   {
     for(int j=k+1; j<R.ncols(); j++) 
@@ -848,3 +1595,424 @@ bool blob::MatrixR::lu (const MatrixR & A, MatrixR & R)
   return true;
 }
 
+
+// applies plane rotation [c s;-s c] to contiguous rows x (p) and y (q):
+// x = c*x - s*y, y = s*x + c*y
+static inline void rotate (real_t * x, real_t * y, int n, real_t c, real_t s)
+{
+  for(int k=0; k<n; k++)
+  {
+    real_t xk = x[k];
+    real_t yk = y[k];
+    x[k] = c*xk - s*yk;
+    y[k] = s*xk + c*yk;
+  }
+}
+
+bool blob::MatrixR::eig (const MatrixR & A, MatrixR & V, MatrixR & d, 
+                                                                 bool warm)
+{
+  int n = A.nrows();
+  if((A.ncols()!=n)||(V.nrows()!=n)||(V.ncols()!=n)||(d.nrows()*d.ncols()!=n))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::eig() error: matrix sizes do not match" << std::endl;
+#endif
+    return false;
+  }
+
+  BLOB_MATRIX_ALIGNED real_t b[n*n], vt[n*n];
+  const real_t *a = A.data();
+  real_t *v = V.data();
+
+  // b = A (symmetric, from lower triangle), vt = V' (rows are eigenvectors)
+  for(int i=0; i<n; i++)
+    for(int j=0; j<=i; j++)
+      b[i*n + j] = b[j*n + i] = a[i*n + j];
+
+  if(warm)
+  {
+    BLOB_MATRIX_ALIGNED real_t aux[n*n];
+    for(int i=0; i<n; i++)
+      for(int j=0; j<n; j++)
+        vt[i*n + j] = v[j*n + i];
+    // b = V'*A*V, rows of vt are contiguous
+    for(int i=0; i<n; i++)
+      for(int j=0; j<n; j++)
+        aux[i*n + j] = dot(&b[i*n], 1, &vt[j*n], 1, n);   // A*V
+    for(int i=0; i<n; i++)
+      for(int j=0; j<=i; j++)
+        b[i*n + j] = b[j*n + i] = dot(&vt[i*n], 1, &aux[j], n, n);
+  }
+  else
+  {
+    for(int i=0; i<n; i++)
+      for(int j=0; j<n; j++)
+        vt[i*n + j] = (i==j)? 1:0;
+  }
+
+  real_t eps = BLOB_MATRIX_EPS;
+  real_t col[2*n];
+  int sweep = 0;
+  for(; sweep<BLOB_MATRIX_JACOBI_SWEEPS; sweep++)
+  {
+    real_t off = 0, diag = 0;
+    for(int i=0; i<n; i++)
+    {
+      diag += b[i*n + i]*b[i*n + i];
+      for(int j=i+1; j<n; j++)
+        off += b[i*n + j]*b[i*n + j];
+    }
+    if(off <= eps*eps*diag)
+      break;
+
+    for(int p=0; p<n-1; p++)
+    {
+      for(int q=p+1; q<n; q++)
+      {
+        real_t apq = b[p*n + q];
+        real_t app = b[p*n + p];
+        real_t aqq = b[q*n + q];
+        if(math::rabs(apq) <= eps*math::sqrtr(math::rabs(app*aqq)))
+        {
+          b[p*n + q] = b[q*n + p] = 0;
+          continue;
+        }
+
+        real_t theta = (aqq - app)/(2*apq);
+        real_t t = 1/(math::rabs(theta) + math::sqrtr(theta*theta + 1));
+        if(theta < 0) t = -t;
+        real_t c = 1/math::sqrtr(t*t + 1);
+        real_t s = t*c;
+
+        // b = J'*b*J: rows p,q are contiguous, columns p,q gathered
+        rotate(&b[p*n], &b[q*n], n, c, s);
+        for(int k=0; k<n; k++)
+        {
+          col[k] = b[k*n + p];
+          col[n + k] = b[k*n + q];
+        }
+        rotate(col, &col[n], n, c, s);
+        for(int k=0; k<n; k++)
+        {
+          b[k*n + p] = col[k];
+          b[k*n + q] = col[n + k];
+        }
+        b[p*n + q] = b[q*n + p] = 0;
+
+        // V = V*J, i.e. rows p,q of V'
+        rotate(&vt[p*n], &vt[q*n], n, c, s);
+      }
+    }
+  }
+
+  // sort ascending (selection, keeps rotations above free of bookkeeping)
+  int idx[n];
+  for(int i=0; i<n; i++)
+    idx[i] = i;
+  for(int i=0; i<n-1; i++)
+  {
+    int m = i;
+    for(int j=i+1; j<n; j++)
+      if(b[idx[j]*n + idx[j]] < b[idx[m]*n + idx[m]])
+        m = j;
+    int aux = idx[i]; idx[i] = idx[m]; idx[m] = aux;
+  }
+  for(int i=0; i<n; i++)
+  {
+    d[i] = b[idx[i]*n + idx[i]];
+    for(int k=0; k<n; k++)
+      v[k*n + i] = vt[idx[i]*n + k];
+  }
+
+#if defined(__DEBUG__) & defined(__linux__)
+  if(sweep == BLOB_MATRIX_JACOBI_SWEEPS)
+    std::cerr << "MatrixR::eig() warning: not converged" << std::endl;
+#endif
+  return true;
+}
+
+bool blob::MatrixR::svd (const MatrixR & A, MatrixR & U, MatrixR & s, 
+                                                                 MatrixR & V)
+{
+  int m = A.nrows();
+  int n = A.ncols();
+  if((m<n)||(U.nrows()!=m)||(U.ncols()!=n)||(s.nrows()*s.ncols()!=n)||
+     (V.nrows()!=n)||(V.ncols()!=n))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::svd() error: matrix sizes do not match" << std::endl;
+#endif
+    return false;
+  }
+
+  // columns of A and V kept as contiguous rows of w=A' and vt=V'
+  BLOB_MATRIX_ALIGNED real_t w[n*m], vt[n*n];
+  const real_t *a = A.data();
+  for(int i=0; i<n; i++)
+  {
+    for(int k=0; k<m; k++)
+      w[i*m + k] = a[k*n + i];
+    for(int k=0; k<n; k++)
+      vt[i*n + k] = (i==k)? 1:0;
+  }
+
+  real_t eps = BLOB_MATRIX_EPS;
+  int sweep = 0;
+  for(; sweep<BLOB_MATRIX_JACOBI_SWEEPS; sweep++)
+  {
+    bool rotated = false;
+    for(int p=0; p<n-1; p++)
+    {
+      for(int q=p+1; q<n; q++)
+      {
+        real_t alpha = dot(&w[p*m], 1, &w[p*m], 1, m);
+        real_t beta  = dot(&w[q*m], 1, &w[q*m], 1, m);
+        real_t gamma = dot(&w[p*m], 1, &w[q*m], 1, m);
+        if(math::rabs(gamma) <= eps*math::sqrtr(alpha*beta))
+          continue;
+
+        rotated = true;
+        real_t zeta = (beta - alpha)/(2*gamma);
+        real_t t = 1/(math::rabs(zeta) + math::sqrtr(zeta*zeta + 1));
+        if(zeta < 0) t = -t;
+        real_t c = 1/math::sqrtr(t*t + 1);
+        rotate(&w[p*m], &w[q*m], m, c, t*c);
+        rotate(&vt[p*n], &vt[q*n], n, c, t*c);
+      }
+    }
+    if(!rotated)
+      break;
+  }
+
+  real_t sv[n];
+  int idx[n];
+  for(int i=0; i<n; i++)
+  {
+    sv[i] = math::sqrtr(dot(&w[i*m], 1, &w[i*m], 1, m));
+    idx[i] = i;
+  }
+  for(int i=0; i<n-1; i++)
+  {
+    int k = i;
+    for(int j=i+1; j<n; j++)
+      if(sv[idx[j]] > sv[idx[k]])
+        k = j;
+    int aux = idx[i]; idx[i] = idx[k]; idx[k] = aux;
+  }
+
+  real_t *u = U.data();
+  real_t *v = V.data();
+  for(int i=0; i<n; i++)
+  {
+    int j = idx[i];
+    s[i] = sv[j];
+    real_t inv = (sv[j] > 0)? 1/sv[j]:0;
+    for(int k=0; k<m; k++)
+      u[k*n + i] = w[j*m + k]*inv;
+    for(int k=0; k<n; k++)
+      v[k*n + i] = vt[j*n + k];
+  }
+
+#if defined(__DEBUG__) & defined(__linux__)
+  if(sweep == BLOB_MATRIX_JACOBI_SWEEPS)
+    std::cerr << "MatrixR::svd() warning: not converged" << std::endl;
+#endif
+  return true;
+}
+
+bool blob::MatrixR::pinv (const MatrixR & A, MatrixR & R, real_t tol)
+{
+  int m = A.nrows();
+  int n = A.ncols();
+  if((R.nrows()!=n)||(R.ncols()!=m))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::pinv() error: matrix sizes do not match" << std::endl;
+#endif
+    return false;
+  }
+
+  // decompose the tall one of A and A': A=U*S*V' or A'=U*S*V' (A=V*S*U')
+  bool tall = (m >= n);
+  int r = tall? m:n;
+  int c = tall? n:m;
+  BLOB_MATRIX_ALIGNED real_t at[r*c], u[r*c], s[c], v[c*c];
+  MatrixR At(r,c,at), U(r,c,u), S(c,1,s), V(c,c,v);
+  for(int i=0; i<r; i++)
+    for(int j=0; j<c; j++)
+      at[i*c + j] = tall? A(i,j):A(j,i);
+  if(!svd(At,U,S,V))
+    return false;
+
+  if(tol < 0)
+    tol = r*s[0]*BLOB_MATRIX_EPS;
+  for(int k=0; k<c; k++)
+    s[k] = (s[k] > tol)? 1/s[k]:0;
+
+  // pinv(A) = V*inv(S)*U' (tall) or U*inv(S)*V' (wide)
+  for(int i=0; i<n; i++)
+  {
+    for(int j=0; j<m; j++)
+    {
+      real_t sum = 0;
+      for(int k=0; k<c; k++)
+        sum += tall? v[i*c + k]*s[k]*u[j*c + k] : u[i*c + k]*s[k]*v[j*c + k];
+      R(i,j) = sum;
+    }
+  }
+  return true;
+}
+
+// solves D*X = N in place of N (nxn) by LU with partial pivoting of D
+static bool luSolve (real_t * d, real_t * x, int n)
+{
+  for(int k=0; k<n; k++)
+  {
+    int p = k;
+    for(int i=k+1; i<n; i++)
+      if(blob::math::rabs(d[i*n + k]) > blob::math::rabs(d[p*n + k]))
+        p = i;
+    if(d[p*n + k] == 0)
+      return false;
+    if(p != k)
+    {
+      for(int j=0; j<n; j++)
+      {
+        real_t aux = d[k*n + j]; d[k*n + j] = d[p*n + j]; d[p*n + j] = aux;
+        aux = x[k*n + j]; x[k*n + j] = x[p*n + j]; x[p*n + j] = aux;
+      }
+    }
+    for(int i=k+1; i<n; i++)
+    {
+      real_t l = d[i*n + k]/d[k*n + k];
+      for(int j=k+1; j<n; j++)
+        d[i*n + j] -= l*d[k*n + j];
+      for(int j=0; j<n; j++)
+        x[i*n + j] -= l*x[k*n + j];
+    }
+  }
+  for(int i=n-1; i>=0; i--)
+  {
+    for(int j=0; j<n; j++)
+    {
+      x[i*n + j] -= blob::MatrixR::dot(&d[i*n + i+1], 1, &x[(i+1)*n + j], n, 
+                                                                     n-i-1);
+      x[i*n + j] /= d[i*n + i];
+    }
+  }
+  return true;
+}
+
+bool blob::MatrixR::expm (const MatrixR & A, MatrixR & R)
+{
+  int n = A.nrows();
+  if((A.ncols()!=n)||(R.nrows()!=n)||(R.ncols()!=n))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::expm() error: matrix sizes do not match" << std::endl;
+#endif
+    return false;
+  }
+
+  // scaling: norm1(A/2^s) <= 0.5
+  int s = 0;
+  real_t anorm = A.norm1();
+  while(anorm > 0.5f && s < 64)
+  {
+    anorm /= 2;
+    s++;
+  }
+  real_t scale = 1;
+  for(int i=0; i<s; i++)
+    scale /= 2;
+
+  BLOB_MATRIX_ALIGNED real_t x[n*n], xa[n*n], num[n*n], den[n*n], aux[n*n];
+  MatrixR X(n,n,x), XA(n,n,xa), Aux(n,n,aux);
+  XA.copy(A);
+  XA.scale(scale);
+  X.copy(XA);
+
+  // pade: num = sum(c(k)*X^k), den = sum((-1)^k*c(k)*X^k)
+  real_t c = 0.5f;
+  for(int i=0; i<n*n; i++)
+  {
+    real_t e = (i%(n+1) == 0)? 1:0;
+    num[i] = e + c*x[i];
+    den[i] = e - c*x[i];
+  }
+  const int q = BLOB_MATRIX_EXPM_PADE;
+  bool positive = true;
+  for(int k=2; k<=q; k++)
+  {
+    c = c*(q - k + 1)/(k*(2*q - k + 1));
+    Aux.multiply(XA,X);
+    X.copy(Aux);
+    for(int i=0; i<n*n; i++)
+    {
+      num[i] += c*x[i];
+      den[i] += (positive? c:-c)*x[i];
+    }
+    positive = !positive;
+  }
+
+  // exp(A/2^s) = den\num, then squaring
+  if(!luSolve(den, num, n))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::expm() error: singular pade denominator" 
+              << std::endl;
+#endif
+    return false;
+  }
+  MatrixR Num(n,n,num);
+  for(int i=0; i<s; i++)
+  {
+    Aux.multiply(Num,Num);
+    Num.copy(Aux);
+  }
+  R.copy(Num);
+  return true;
+}
+
+bool blob::MatrixR::discretize (const MatrixR & A, const MatrixR & Q, 
+                                real_t dt, MatrixR & Phi, MatrixR & Qd)
+{
+  int n = A.nrows();
+  if((A.ncols()!=n)||(Q.nrows()!=n)||(Q.ncols()!=n)||(Phi.nrows()!=n)||
+     (Phi.ncols()!=n)||(Qd.nrows()!=n)||(Qd.ncols()!=n))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "MatrixR::discretize() error: matrix sizes do not match" 
+              << std::endl;
+#endif
+    return false;
+  }
+
+  // van loan: exp([-A Q; 0 A']*dt) = [. inv(Phi)*Qd; 0 Phi']
+  int m = 2*n;
+  BLOB_MATRIX_ALIGNED real_t c[m*m], e[m*m];
+  MatrixR C(m,m,c), E(m,m,e);
+  C.zero();
+  for(int i=0; i<n; i++)
+  {
+    for(int j=0; j<n; j++)
+    {
+      c[i*m + j] = -A(i,j)*dt;
+      c[i*m + n + j] = Q(i,j)*dt;
+      c[(n + i)*m + n + j] = A(j,i)*dt;
+    }
+  }
+  if(!expm(C,E))
+    return false;
+
+  for(int i=0; i<n; i++)
+    for(int j=0; j<n; j++)
+      Phi(i,j) = e[(n + j)*m + n + i];
+  for(int i=0; i<n; i++)
+    for(int j=0; j<n; j++)
+      Qd(i,j) = dot(&Phi.data()[i*n], 1, &e[n + j], m, n);
+  // remove round-off asymmetry
+  Qd.simmetrize();
+  return true;
+}
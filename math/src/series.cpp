@@ -0,0 +1,364 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * \file       series.cpp
+ * \brief      implementation of binary memory-mappable series files
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2017 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include "blob/series.h"
+
+#if defined(__linux__)
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char seriesMagic[8] = "BLOBSER";
+static const uint32_t seriesVersion = 1;
+
+blob::SeriesReader::SeriesReader () : _map(NULL), _size(0), _header(NULL),
+                                      _payload(NULL), _nrows(0) {}
+
+blob::SeriesReader::~SeriesReader ()
+{
+  close();
+}
+
+bool blob::SeriesReader::open (const char * filename)
+{
+  close();
+
+  int fd = ::open(filename, O_RDONLY);
+  if(fd < 0)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "SeriesReader::open() error: unable to open " << filename 
+              << std::endl;
+#endif
+    return false;
+  }
+  struct stat st;
+  if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(SeriesHeader))
+  {
+    ::close(fd);
+    return false;
+  }
+  _size = st.st_size;
+  _map = mmap(NULL, _size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(_map == MAP_FAILED)
+  {
+    _map = NULL;
+    return false;
+  }
+
+  const SeriesHeader * h = (const SeriesHeader *)_map;
+  if(memcmp(h->magic, seriesMagic, sizeof(seriesMagic)) || 
+     h->version != seriesVersion ||
+     (h->dtype != SERIES_FLOAT32 && h->dtype != SERIES_FLOAT64) ||
+     h->ncols == 0 || h->ncols > BLOB_SERIES_MAX_COLS || 
+     h->offset < sizeof(SeriesHeader) || h->offset > _size)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "SeriesReader::open() error: " << filename 
+              << " is not a valid series file" << std::endl;
+#endif
+    close();
+    return false;
+  }
+
+  // column names, each '\0'-terminated inside the header area
+  const char * p = (const char *)_map + sizeof(SeriesHeader);
+  const char * end = (const char *)_map + h->offset;
+  for(uint32_t i=0; i<h->ncols; i++)
+  {
+    const char * z = (const char *)memchr(p, 0, end - p);
+    if(!z)
+    {
+      close();
+      return false;
+    }
+    _names[i] = p;
+    p = z + 1;
+  }
+
+  _header = h;
+  _payload = (const char *)_map + h->offset;
+  _nrows = (_size - h->offset)/((uint64_t)h->ncols*h->dtype);
+  return true;
+}
+
+void blob::SeriesReader::close ()
+{
+  if(_map)
+    munmap(_map, _size);
+  _map = NULL;
+  _size = 0;
+  _header = NULL;
+  _payload = NULL;
+  _nrows = 0;
+}
+
+const char * blob::SeriesReader::name (uint32_t col) const
+{
+  return (_header && col < _header->ncols)? _names[col] : NULL;
+}
+
+int blob::SeriesReader::column (const char * name) const
+{
+  for(uint32_t i=0; _header && i<_header->ncols; i++)
+    if(!strcmp(_names[i], name))
+      return i;
+  return -1;
+}
+
+real_t blob::SeriesReader::value (uint64_t i, uint32_t col) const
+{
+  if(!_header || i >= _nrows || col >= _header->ncols)
+    return 0;
+  uint64_t k = i*_header->ncols + col;
+  if(_header->dtype == SERIES_FLOAT64)
+    return (real_t)((const double *)_payload)[k];
+  return (real_t)((const float *)_payload)[k];
+}
+
+blob::SeriesWriter::SeriesWriter () : _file(NULL) 
+{
+  memset(&_header, 0, sizeof(_header));
+}
+
+blob::SeriesWriter::~SeriesWriter ()
+{
+  close();
+}
+
+bool blob::SeriesWriter::open (const char * filename, uint32_t ncols, 
+                               const char * const * names, double dt,
+                               series_dtype_t dtype)
+{
+  close();
+  if(ncols == 0 || ncols > BLOB_SERIES_MAX_COLS ||
+     (dtype != SERIES_FLOAT32 && dtype != SERIES_FLOAT64))
+    return false;
+
+  // append to existing compatible file
+  _file = fopen(filename, "r+b");
+  if(_file)
+  {
+    if(fread(&_header, sizeof(_header), 1, _file) != 1 || 
+       memcmp(_header.magic, seriesMagic, sizeof(seriesMagic)) || 
+       _header.version != seriesVersion || 
+       _header.ncols != ncols || _header.dtype != (uint32_t)dtype)
+    {
+#if defined(__DEBUG__) & defined(__linux__)
+      std::cerr << "SeriesWriter::open() error: " << filename 
+                << " exists with other format" << std::endl;
+#endif
+      fclose(_file);
+      _file = NULL;
+      return false;
+    }
+    // rows counted from file size (header may be stale), drop partial row
+    fseek(_file, 0, SEEK_END);
+    long size = ftell(_file);
+    uint64_t rowsize = (uint64_t)ncols*dtype;
+    _header.nrows = (size - _header.offset)/rowsize;
+    fseek(_file, _header.offset + _header.nrows*rowsize, SEEK_SET);
+    return true;
+  }
+
+  _file = fopen(filename, "w+b");
+  if(!_file)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "SeriesWriter::open() error: unable to open " << filename 
+              << std::endl;
+#endif
+    return false;
+  }
+
+  memcpy(_header.magic, seriesMagic, sizeof(seriesMagic));
+  _header.version = seriesVersion;
+  _header.dtype = dtype;
+  _header.nrows = 0;
+  _header.ncols = ncols;
+  _header.dt = dt;
+
+  char area[BLOB_SERIES_MAX_COLS*BLOB_SERIES_MAX_NAME];
+  uint32_t len = 0;
+  for(uint32_t i=0; i<ncols; i++)
+  {
+    char def[BLOB_SERIES_MAX_NAME];
+    snprintf(def, sizeof(def), "c%u", i);
+    const char * name = (names && names[i])? names[i] : def;
+    size_t l = strnlen(name, BLOB_SERIES_MAX_NAME-1);
+    memcpy(&area[len], name, l);
+    area[len + l] = 0;
+    len += l + 1;
+  }
+  uint32_t offset = sizeof(SeriesHeader) + len;
+  offset = ((offset + BLOB_SERIES_ALIGNMENT - 1)/BLOB_SERIES_ALIGNMENT)*
+                                                        BLOB_SERIES_ALIGNMENT;
+  _header.offset = offset;
+
+  char pad[BLOB_SERIES_ALIGNMENT];
+  memset(pad, 0, sizeof(pad));
+  bool ok = fwrite(&_header, sizeof(_header), 1, _file) == 1 &&
+            fwrite(area, 1, len, _file) == len;
+  uint32_t npad = offset - sizeof(SeriesHeader) - len;
+  ok = ok && (npad == 0 || fwrite(pad, 1, npad, _file) == npad);
+  if(!ok)
+    close();
+  return ok;
+}
+
+bool blob::SeriesWriter::append (const real_t * rows, uint32_t n)
+{
+  if(!_file)
+    return false;
+
+  uint64_t count = (uint64_t)n*_header.ncols;
+  bool ok = true;
+  if(_header.dtype == sizeof(real_t))
+    ok = fwrite(rows, sizeof(real_t), count, _file) == count;
+  else
+  {
+    for(uint64_t k=0; k<count && ok; k++)
+    {
+      if(_header.dtype == SERIES_FLOAT64)
+      {
+        double v = rows[k];
+        ok = fwrite(&v, sizeof(v), 1, _file) == 1;
+      }
+      else
+      {
+        float v = rows[k];
+        ok = fwrite(&v, sizeof(v), 1, _file) == 1;
+      }
+    }
+  }
+  if(ok)
+    _header.nrows += n;
+  return ok;
+}
+
+bool blob::SeriesWriter::flush ()
+{
+  if(!_file)
+    return false;
+  long end = ftell(_file);
+  bool ok = fseek(_file, 0, SEEK_SET) == 0 &&
+            fwrite(&_header, sizeof(_header), 1, _file) == 1 &&
+            fseek(_file, end, SEEK_SET) == 0 &&
+            fflush(_file) == 0;
+  return ok;
+}
+
+void blob::SeriesWriter::close ()
+{
+  if(!_file)
+    return;
+  flush();
+  fclose(_file);
+  _file = NULL;
+}
+
+long blob::SeriesWriter::convert (const char * textfile, const char * filename,
+                                  series_dtype_t dtype)
+{
+  std::ifstream input(textfile);
+  if(!input.is_open())
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "SeriesWriter::convert() error: unable to open " << textfile
+              << std::endl;
+#endif
+    return -1;
+  }
+
+  std::string line;
+  std::string names[BLOB_SERIES_MAX_COLS];
+  const char * pnames[BLOB_SERIES_MAX_COLS];
+  uint32_t nnames = 0;
+  double dt = 0;
+  SeriesWriter writer;
+  real_t row[BLOB_SERIES_MAX_COLS];
+
+  remove(filename);
+  while(getline(input, line))
+  {
+    if(line.empty())
+      continue;
+    bool numeric = (line[0] == '-') || (line[0] == '.') || 
+                   ((line[0] >= '0') && (line[0] <= '9'));
+    std::stringstream tokens(line);
+    std::string token;
+    if(!numeric)
+    {
+      // header: column names and optional (dt=...)
+      while(tokens >> token && nnames < BLOB_SERIES_MAX_COLS)
+      {
+        if(!token.compare(0, 4, "(dt="))
+          dt = atof(token.c_str() + 4);
+        else
+          names[nnames++] = token;
+      }
+      continue;
+    }
+
+    uint32_t ncols = 0;
+    while(ncols < BLOB_SERIES_MAX_COLS && tokens >> token)
+      row[ncols++] = atof(token.c_str());
+    if(!writer._file)
+    {
+      for(uint32_t i=0; i<ncols; i++)
+        pnames[i] = (i < nnames)? names[i].c_str() : NULL;
+      if(!writer.open(filename, ncols, pnames, dt, dtype))
+        return -1;
+    }
+    if(ncols != writer._header.ncols || !writer.append(row))
+    {
+#if defined(__DEBUG__) & defined(__linux__)
+      std::cerr << "SeriesWriter::convert() error: bad row " 
+                << writer.nrows() << std::endl;
+#endif
+      return -1;
+    }
+  }
+  long n = writer.nrows();
+  writer.close();
+  return n;
+}
+
+#endif // defined(__linux__)
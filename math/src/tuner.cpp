@@ -0,0 +1,395 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * \file       tuner.cpp
+ * \brief      implementation of auto-tuned selection of matrix kernels
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2017 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include "blob/tuner.h"
+#include "blob/math.h"
+
+#if defined(__linux__)
+ #include <iostream>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+#endif
+
+blob::Tuner::Shape blob::Tuner::_shapes[BLOB_TUNER_MAX_SHAPES];
+int blob::Tuner::_count = 0;
+
+static const char * kernelNames[blob::KERNEL_COUNT] = 
+                                  {"scalar", "unrolled", "stream", "blocked"};
+
+// R = A*B, dot product per element unrolled by 4
+static void multiplyUnrolled (const real_t * a, const real_t * b, real_t * r,
+                              int m, int k, int n)
+{
+  for(int i=0; i<m; i++)
+  {
+    const real_t *ai = &a[i*k];
+    for(int j=0; j<n; j++)
+    {
+      real_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+      int l = 0;
+      for(; l+3<k; l+=4)
+      {
+        s0 += ai[l]*b[l*n + j];
+        s1 += ai[l+1]*b[(l+1)*n + j];
+        s2 += ai[l+2]*b[(l+2)*n + j];
+        s3 += ai[l+3]*b[(l+3)*n + j];
+      }
+      for(; l<k; l++)
+        s0 += ai[l]*b[l*n + j];
+      r[i*n + j] = (s0 + s1) + (s2 + s3);
+    }
+  }
+}
+
+// R = A*B, row i of R accumulated as sum of A(i,l)*row l of B (unit stride)
+static void multiplyStream (const real_t * a, const real_t * b, real_t * r,
+                            int m, int k, int n)
+{
+  for(int i=0; i<m; i++)
+  {
+    real_t *ri = &r[i*n];
+    for(int j=0; j<n; j++)
+      ri[j] = 0;
+    for(int l=0; l<k; l++)
+    {
+      real_t ail = a[i*k + l];
+      const real_t *bl = &b[l*n];
+      for(int j=0; j<n; j++)
+        ri[j] += ail*bl[j];
+    }
+  }
+}
+
+// R = A*B, row streaming over BLOB_TUNER_BLOCK x BLOB_TUNER_BLOCK tiles
+static void multiplyBlocked (const real_t * a, const real_t * b, real_t * r,
+                             int m, int k, int n)
+{
+  const int bs = BLOB_TUNER_BLOCK;
+  for(int i=0; i<m*n; i++)
+    r[i] = 0;
+  for(int l0=0; l0<k; l0+=bs)
+  {
+    int l1 = (l0+bs < k)? l0+bs:k;
+    for(int j0=0; j0<n; j0+=bs)
+    {
+      int j1 = (j0+bs < n)? j0+bs:n;
+      for(int i=0; i<m; i++)
+      {
+        real_t *ri = &r[i*n];
+        for(int l=l0; l<l1; l++)
+        {
+          real_t ail = a[i*k + l];
+          const real_t *bl = &b[l*n];
+          for(int j=j0; j<j1; j++)
+            ri[j] += ail*bl[j];
+        }
+      }
+    }
+  }
+}
+
+bool blob::Tuner::multiply (kernel_t kernel, const MatrixR & A, 
+                                             const MatrixR & B, MatrixR & R)
+{
+  // reordered kernels only apply to naive accumulation
+  if(kernel == KERNEL_SCALAR || 
+     MatrixR::getAccumulation() != ACCUMULATION_NAIVE)
+    return R.Matrix<real_t>::multiply(A,B);
+
+  if((A.ncols() != B.nrows()) ||
+     (R.nrows() != A.nrows()) ||
+     (R.ncols() != B.ncols()))
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "Tuner::multiply() error: " 
+              << (int)A.ncols() << "==" << (int)B.nrows() << "?" 
+              << (int)R.nrows() << "==" << (int)A.nrows() << "?" 
+              << (int)R.ncols() << "==" << (int)B.ncols() << "?" 
+              << std::endl;
+#endif
+    return false;
+  }
+
+  int m = A.nrows(), k = A.ncols(), n = B.ncols();
+  BLOB_COUNT("multiply", 2*(uint64_t)m*n*k, 
+             sizeof(real_t)*(A.length() + B.length() + R.length()));
+  switch(kernel)
+  {
+    case KERNEL_UNROLLED:
+      multiplyUnrolled(A.data(), B.data(), R.data(), m, k, n);
+      break;
+    case KERNEL_STREAM:
+      multiplyStream(A.data(), B.data(), R.data(), m, k, n);
+      break;
+    default:
+      multiplyBlocked(A.data(), B.data(), R.data(), m, k, n);
+      break;
+  }
+  return true;
+}
+
+int blob::Tuner::find (uint8_t m, uint8_t k, uint8_t n)
+{
+  for(int i=0; i<_count; i++)
+    if(_shapes[i].m == m && _shapes[i].k == k && _shapes[i].n == n)
+      return i;
+  return -1;
+}
+
+bool blob::Tuner::registerShape (uint8_t m, uint8_t k, uint8_t n)
+{
+  if(find(m,k,n) >= 0)
+    return true;
+  if(_count == BLOB_TUNER_MAX_SHAPES)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "Tuner::registerShape() error: dispatch table full" 
+              << std::endl;
+#endif
+    return false;
+  }
+  Shape & s = _shapes[_count++];
+  s.m = m;
+  s.k = k;
+  s.n = n;
+  s.kernel = KERNEL_SCALAR;
+  s.tuned = false;
+  return true;
+}
+
+blob::kernel_t blob::Tuner::kernel (uint8_t m, uint8_t k, uint8_t n)
+{
+  int i = find(m,k,n);
+  return (i >= 0)? _shapes[i].kernel : KERNEL_SCALAR;
+}
+
+const char * blob::Tuner::name (kernel_t kernel)
+{
+  return (kernel >= 0 && kernel < KERNEL_COUNT)? kernelNames[kernel] : "?";
+}
+
+#if defined(__linux__)
+
+static double now ()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return 1e9*ts.tv_sec + ts.tv_nsec;
+}
+
+// provides cpu model name, empty if unknown
+static void cpuModel (char * model, int size)
+{
+  model[0] = 0;
+  FILE * f = fopen("/proc/cpuinfo", "r");
+  if(!f)
+    return;
+  char line[256];
+  while(fgets(line, sizeof(line), f))
+  {
+    if(!strncmp(line, "model name", 10))
+    {
+      const char * p = strchr(line, ':');
+      if(p)
+      {
+        p++;
+        while(*p == ' ')
+          p++;
+        strncpy(model, p, size-1);
+        model[size-1] = 0;
+        model[strcspn(model, "\r\n")] = 0;
+      }
+      break;
+    }
+  }
+  fclose(f);
+}
+
+static const char * precision ()
+{
+  return (sizeof(real_t) == sizeof(double))? "double":"float";
+}
+
+int blob::Tuner::tune (bool force)
+{
+  int tuned = 0;
+  for(int s=0; s<_count; s++)
+  {
+    Shape & shape = _shapes[s];
+    if(shape.tuned && !force)
+      continue;
+
+    int m = shape.m, k = shape.k, n = shape.n;
+    BLOB_MATRIX_ALIGNED real_t a[m*k], b[k*n], r[m*n], r0[m*n];
+    MatrixR A(m,k,a), B(k,n,b), R(m,n,r), R0(m,n,r0);
+    for(int i=0; i<m*k; i++)
+      a[i] = (real_t)rand()/RAND_MAX - 0.5f;
+    for(int i=0; i<k*n; i++)
+      b[i] = (real_t)rand()/RAND_MAX - 0.5f;
+    multiply(KERNEL_SCALAR, A, B, R0);
+
+    double best = 0;
+    shape.kernel = KERNEL_SCALAR;
+    for(int kk=0; kk<KERNEL_COUNT; kk++)
+    {
+      kernel_t kernel = (kernel_t)kk;
+      multiply(kernel, A, B, R);
+      R.substract(R0);
+      if(R.norm() > 1e-3f*(R0.norm() + 1))
+        continue;
+
+      // calibrate calls per sample to ~10us, keep fastest sample
+      int inner = 1;
+      for(;;)
+      {
+        double t0 = now();
+        for(int i=0; i<inner; i++)
+          multiply(kernel, A, B, R);
+        if(now() - t0 >= 10000 || inner >= (1<<16))
+          break;
+        inner *= 2;
+      }
+      double tmin = 0;
+      for(int rep=0; rep<BLOB_TUNER_REPETITIONS; rep++)
+      {
+        double t0 = now();
+        for(int i=0; i<inner; i++)
+          multiply(kernel, A, B, R);
+        double t = (now() - t0)/inner;
+        if(rep == 0 || t < tmin)
+          tmin = t;
+      }
+      if(kk == 0 || tmin < best)
+      {
+        best = tmin;
+        shape.kernel = kernel;
+      }
+    }
+    shape.tuned = true;
+    tuned++;
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "Tuner::tune() " << m << "x" << k << "x" << n << ": " 
+              << name(shape.kernel) << " " << best << "ns" << std::endl;
+#endif
+  }
+  return tuned;
+}
+
+bool blob::Tuner::save (const char * filename)
+{
+  FILE * f = fopen(filename, "w");
+  if(!f)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "Tuner::save() error: unable to open file " << filename 
+              << std::endl;
+#endif
+    return false;
+  }
+  char model[128];
+  cpuModel(model, sizeof(model));
+  fprintf(f, "# blob tuner: precision cpu / m k n kernel\n");
+  fprintf(f, "%s %s\n", precision(), model);
+  for(int i=0; i<_count; i++)
+    if(_shapes[i].tuned)
+      fprintf(f, "%d %d %d %s\n", _shapes[i].m, _shapes[i].k, _shapes[i].n, 
+                                  name(_shapes[i].kernel));
+  fclose(f);
+  return true;
+}
+
+bool blob::Tuner::load (const char * filename)
+{
+  FILE * f = fopen(filename, "r");
+  if(!f)
+    return false;
+
+  char line[256], model[128];
+  cpuModel(model, sizeof(model));
+  bool valid = false;
+  // skip comments, check precision and cpu model of saved table
+  while(fgets(line, sizeof(line), f))
+  {
+    if(line[0] == '#')
+      continue;
+    line[strcspn(line, "\r\n")] = 0;
+    const char * p = precision();
+    int lp = strlen(p);
+    valid = !strncmp(line, p, lp) && line[lp] == ' ' && 
+            !strcmp(&line[lp+1], model);
+    break;
+  }
+  if(!valid)
+  {
+#if defined(__DEBUG__) & defined(__linux__)
+    std::cerr << "Tuner::load() error: " << filename << " was tuned for other"
+              << " hardware or precision" << std::endl;
+#endif
+    fclose(f);
+    return false;
+  }
+
+  int m, k, n;
+  char kname[32];
+  while(fscanf(f, "%d %d %d %31s", &m, &k, &n, kname) == 4)
+  {
+    for(int kk=0; kk<KERNEL_COUNT; kk++)
+    {
+      if(!strcmp(kname, kernelNames[kk]) && registerShape(m,k,n))
+      {
+        Shape & s = _shapes[find(m,k,n)];
+        s.kernel = (kernel_t)kk;
+        s.tuned = true;
+      }
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+void blob::Tuner::print (std::ostream & os)
+{
+  for(int i=0; i<_count; i++)
+    os << " " << (int)_shapes[i].m << "x" << (int)_shapes[i].k << "*" 
+       << (int)_shapes[i].k << "x" << (int)_shapes[i].n << ": " 
+       << name(_shapes[i].kernel) << (_shapes[i].tuned? "":" (not tuned)")
+       << std::endl;
+}
+
+#else
+
+int blob::Tuner::tune (bool force) { return 0; }
+bool blob::Tuner::save (const char * filename) { return false; }
+bool blob::Tuner::load (const char * filename) { return false; }
+
+#endif // defined(__linux__)
@@ -0,0 +1,268 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * \file       bench_matrix_linux.cpp
+ * \brief      timing benchmark of matrix kernels with json output (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2017 Blob Robots.
+ *
+ ******************************************************************************/
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "blob/matrix.h"
+
+#define BENCH_WARMUP      20     // default untimed samples per kernel
+#define BENCH_REPS        200    // default timed samples per kernel
+#define BENCH_SAMPLE_NS   20000  // target duration of one sample [ns]
+
+const int sizes[] = { 2, 3, 4, 6, 8, 10, 12, 16, 20, 25, 30, 40, 50 };
+const int nsizes = sizeof(sizes)/sizeof(sizes[0]);
+
+const char * precision = (sizeof(real_t) == sizeof(double))? "double":"float";
+
+volatile real_t sink = 0; // keeps results alive
+
+double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return 1e9*ts.tv_sec + ts.tv_nsec;
+}
+
+/**
+ * Kernel operands for square size n: random M, symmetric positive definite
+ * A = M*M' + n*I, its Cholesky factor L, vectors v, w and results.
+ */
+struct Operands
+{
+  Operands (int n) : n(n), m(n*n), a(n*n), l(n*n), b(n*n), r(n*n), q(n*n),
+                     v(n), v0(n), w(n),
+                     M(n,n,&m[0]), A(n,n,&a[0]), L(n,n,&l[0]), B(n,n,&b[0]),
+                     R(n,n,&r[0]), Q(n,n,&q[0]), V(n,1,&v[0]), W(n,1,&w[0])
+  {
+    for(int i=0; i<n*n; i++)
+      m[i] = (real_t)rand()/RAND_MAX - 0.5f;
+    for(int i=0; i<n; i++)
+      v[i] = v0[i] = 0.1f*((real_t)rand()/RAND_MAX - 0.5f);
+    blob::MatrixR Mt(n,n,&r[0]);
+    blob::MatrixR::transpose(M,Mt);
+    A.multiply(M,Mt);
+    for(int i=0; i<n; i++)
+      A(i,i) += n;
+    blob::MatrixR::cholesky(A,L);
+    B.copy(M);
+  }
+  int n;
+  std::vector<real_t> m, a, l, b, r, q, v, v0, w;
+  blob::MatrixR M, A, L, B, R, Q, V, W;
+};
+
+/**
+ * Runs one kernel call on the operands.
+ */
+typedef void (*kernel_t)(Operands & o);
+
+void kMultiply (Operands & o) { o.R.multiply(o.M,o.A); }
+void kMultiplyDiag (Operands & o) { blob::MatrixR::multiplyDiag(o.M,o.V,o.R); }
+void kTranspose (Operands & o) { blob::MatrixR::transpose(o.M,o.R); }
+void kCholesky (Operands & o) { blob::MatrixR::cholesky(o.A,o.R); }
+void kCholupdate (Operands & o) 
+{
+  // update and downdate keep the factor bounded; v is consumed by each call
+  memcpy(&o.v[0], &o.v0[0], sizeof(real_t)*o.n);
+  o.L.cholupdate(o.V,1);
+  memcpy(&o.v[0], &o.v0[0], sizeof(real_t)*o.n);
+  o.L.cholupdate(o.V,-1);
+}
+void kGemv (Operands & o) { blob::MatrixR::gemv(o.M,o.V,o.W); }
+void kGemvT (Operands & o) { blob::MatrixR::gemvT(o.M,o.V,o.W); }
+void kSymv (Operands & o) { blob::MatrixR::symv(o.A,o.V,o.W); }
+void kGer (Operands & o) 
+{
+  // update and downdate keep the matrix bounded
+  o.B.ger(o.V,o.V,1);
+  o.B.ger(o.V,o.V,-1);
+}
+void kQr (Operands & o) { blob::MatrixR::qr(o.M,o.Q,o.R); }
+void kLu (Operands & o) { blob::MatrixR::lu(o.A,o.R); }
+void kInverse (Operands & o) { blob::MatrixR::inverse(o.A,o.R,true); }
+void kDivide (Operands & o) { blob::MatrixR::divide(o.M,o.A,o.R); }
+
+struct Kernel
+{
+  const char * name;
+  kernel_t run;
+  int calls; // kernel calls per run
+};
+
+const Kernel kernels[] = { {"multiply",     kMultiply,     1},
+                           {"multiplyDiag", kMultiplyDiag, 1},
+                           {"transpose",    kTranspose,    1},
+                           {"cholesky",     kCholesky,     1},
+                           {"cholupdate",   kCholupdate,   2},
+                           {"gemv",         kGemv,         1},
+                           {"gemvT",        kGemvT,        1},
+                           {"symv",         kSymv,         1},
+                           {"ger",          kGer,          2},
+                           {"qr",           kQr,           1},
+                           {"lu",           kLu,           1},
+                           {"inverse",      kInverse,      1},
+                           {"divide",       kDivide,       1} };
+const int nkernels = sizeof(kernels)/sizeof(kernels[0]);
+
+struct Result
+{
+  const char * name;
+  int n;
+  int inner;
+  double median, p99, min; // per call [ns]
+};
+
+Result bench (const Kernel & k, Operands & o, int warmup, int reps)
+{
+  // calibrate calls per sample so that one sample lasts ~BENCH_SAMPLE_NS
+  int inner = 1;
+  for(;;)
+  {
+    double t0 = now();
+    for(int i=0; i<inner; i++)
+      k.run(o);
+    if(now() - t0 >= BENCH_SAMPLE_NS || inner >= (1<<20))
+      break;
+    inner *= 2;
+  }
+
+  for(int w=0; w<warmup; w++)
+    for(int i=0; i<inner; i++)
+      k.run(o);
+
+  std::vector<double> samples(reps);
+  for(int r=0; r<reps; r++)
+  {
+    double t0 = now();
+    for(int i=0; i<inner; i++)
+      k.run(o);
+    samples[r] = (now() - t0)/(inner*k.calls);
+    sink = o.R[0];
+  }
+  std::sort(samples.begin(), samples.end());
+
+  Result res;
+  res.name = k.name;
+  res.n = o.n;
+  res.inner = inner;
+  res.median = samples[reps/2];
+  res.p99 = samples[std::min(reps-1, (int)(0.99*reps))];
+  res.min = samples[0];
+  return res;
+}
+
+void json (std::ostream & os, const std::vector<Result> & results, 
+                                                     int warmup, int reps)
+{
+  os << "{" << std::endl
+     << "  \"benchmark\": \"bench_matrix\"," << std::endl
+     << "  \"precision\": \"" << precision << "\"," << std::endl
+     << "  \"warmup\": " << warmup << "," << std::endl
+     << "  \"repetitions\": " << reps << "," << std::endl
+     << "  \"unit\": \"ns\"," << std::endl
+     << "  \"results\": [" << std::endl;
+  for(size_t i=0; i<results.size(); i++)
+  {
+    const Result & r = results[i];
+    os << "    {\"op\": \"" << r.name << "\", \"n\": " << r.n 
+       << ", \"inner\": " << r.inner << ", \"median\": " << r.median 
+       << ", \"p99\": " << r.p99 << ", \"min\": " << r.min << "}"
+       << ((i+1 < results.size())? ",":"") << std::endl;
+  }
+  os << "  ]" << std::endl << "}" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+  int warmup = BENCH_WARMUP;
+  int reps = BENCH_REPS;
+  const char * output = NULL;
+  const char * filter = NULL;
+
+  for(int i=1; i<argc; i++)
+  {
+    if(!strcmp(argv[i],"-w") && i+1<argc)
+      warmup = atoi(argv[++i]);
+    else if(!strcmp(argv[i],"-r") && i+1<argc)
+      reps = atoi(argv[++i]);
+    else if(!strcmp(argv[i],"-o") && i+1<argc)
+      output = argv[++i];
+    else if(!strcmp(argv[i],"-k") && i+1<argc)
+      filter = argv[++i];
+    else
+    {
+      std::cerr << "[bench] - usage: " << argv[0] << " [-w warmup] "
+                << "[-r repetitions] [-k kernel] [-o output.json]" << std::endl;
+      return -1;
+    }
+  }
+  if(reps < 1)
+    reps = 1;
+
+  srand(1);
+  std::vector<Result> results;
+  std::cerr << "[bench] - " << precision << " (median/p99 ns per call)" 
+            << std::endl;
+  for(int s=0; s<nsizes; s++)
+  {
+    Operands o(sizes[s]);
+    for(int k=0; k<nkernels; k++)
+    {
+      if(filter && strcmp(filter, kernels[k].name))
+        continue;
+      Result r = bench(kernels[k], o, warmup, reps);
+      results.push_back(r);
+      std::cerr << "  " << r.name << " n=" << r.n << ": " << r.median << "/"
+                << r.p99 << std::endl;
+    }
+  }
+
+  if(output)
+  {
+    std::ofstream file(output);
+    if(!file.is_open())
+    {
+      std::cerr << "[bench] - file i/o error: unable to open file " << output
+                << std::endl;
+      return -1;
+    }
+    json(file, results, warmup, reps);
+  }
+  else
+    json(std::cout, results, warmup, reps);
+
+  return 0;
+}
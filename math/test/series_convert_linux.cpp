@@ -0,0 +1,108 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ *
+ * \file       series_convert_linux.cpp
+ * \brief      converts text datasets to binary series files and compares
+ *             text parsing against mmap replay (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2017 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <string.h>
+#include <time.h>
+
+#include "blob/series.h"
+
+double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc < 3 || (argc == 4 && strcmp(argv[3], "-d")) || argc > 4)
+  {
+    std::cerr << "[convert] - usage: ./series_convert input_file output_file "
+              << "[-d]" << std::endl
+              << "  -d  store 64 bits elements (default real_t)" << std::endl;
+    return -1;
+  }
+  blob::series_dtype_t dtype = (argc == 4)? blob::SERIES_FLOAT64 :
+                                      (blob::series_dtype_t)sizeof(real_t);
+
+  double t0 = now();
+  long n = blob::SeriesWriter::convert(argv[1], argv[2], dtype);
+  double t1 = now();
+  if(n < 0)
+  {
+    std::cerr << "[convert] - unable to convert " << argv[1] << std::endl;
+    return -1;
+  }
+
+  // replay: sum of all elements from text and from mapped file
+  std::ifstream input(argv[1]);
+  std::string line;
+  double sumt = 0;
+  while(getline(input, line))
+  {
+    if((line[0] == '-') || ((line[0] >= '0')&&(line[0] <='9')))
+    {
+      std::stringstream lineinput(line);
+      real_t value = 0;
+      while(lineinput >> value)
+        sumt += value;
+    }
+  }
+  input.close();
+  double t2 = now();
+
+  blob::SeriesReader reader;
+  if(!reader.open(argv[2]))
+  {
+    std::cerr << "[convert] - unable to map " << argv[2] << std::endl;
+    return -1;
+  }
+  double sumb = 0;
+  for(uint64_t i=0; i<reader.nrows(); i++)
+    for(uint32_t j=0; j<reader.ncols(); j++)
+      sumb += reader.value(i,j);
+  double t3 = now();
+
+  std::cout << "[convert] - " << n << "x" << reader.ncols() << " dt=" 
+            << reader.dt() << " columns:";
+  for(uint32_t j=0; j<reader.ncols(); j++)
+    std::cout << " " << reader.name(j);
+  std::cout << std::endl;
+  std::cout << "[convert] - convert " << (t1-t0) << " s, text replay " 
+            << (t2-t1) << " s, mmap replay " << (t3-t2) << " s" << std::endl;
+  std::cout << "[convert] - sum text=" << sumt << " mmap=" << sumb << std::endl;
+  return 0;
+}
@@ -30,6 +30,10 @@
 #include <iostream>
 
 #include "blob/matrix.h"
+#include "blob/discretizer.h"
+#include "blob/tuner.h"
+#include "blob/series.h"
+#include "blob/dual.h"
 
 bool test00_eye()
 {
@@ -319,6 +323,7 @@ bool test05_multiply()
   std::cout << " = " << std::endl;
   blob::MatrixR::multiplyElem(A,B,R);
   R.print();
+  return true;
 }
 
 bool test06_transpose()
@@ -772,6 +777,7 @@ bool test12_qr()
   R.print();
   std::cout << std::endl;
   std::cout << std::endl;
+  return true;
 }
 
 bool test13_permute()
@@ -796,6 +802,7 @@ bool test13_permute()
   std::cout << " A \n =" << std::endl; 
   A.print();
   std::cout << std::endl; 
+  return true;
 }
 
 bool test14_lu()
@@ -863,6 +870,7 @@ bool test14_lu()
   std::cout << "  = " << std::endl; 
   A.lurestore();
   A.print();  
+  return true;
 }
 
 bool test15_lu()
@@ -920,6 +928,7 @@ bool test15_lu()
   R.multiply(L,U);  
   R.print();
   std::cout << std::endl;
+  return true;
 }
 
 bool test16_lu()
@@ -992,6 +1001,631 @@ bool test16_lu()
   std::cout << "  = " << std::endl; 
   P.print();
   
+  return true;
+}
+
+bool test17_accumulation()
+{
+  std::cout << "test17_accumulation" << std::endl << std::endl;
+
+  // 1 + 200*1e-8 = 1.000002, naive float accumulation loses the small terms
+  real_t a[201];
+  real_t b[201];
+  a[0] = 1.f;
+  b[0] = 1.f;
+  for(int i=1; i<201; i++)
+  {
+    a[i] = 1e-4f;
+    b[i] = 1e-4f;
+  }
+  blob::MatrixR A(1,201,a);
+  blob::MatrixR B(201,1,b);
+  real_t r[] = { 0.f };
+  blob::MatrixR R(1,1,r);
+
+  const char * name[] = {"naive", "kahan", "pairwise", "wide"};
+  blob::accumulation_t policy[] = {blob::ACCUMULATION_NAIVE,
+                                   blob::ACCUMULATION_KAHAN,
+                                   blob::ACCUMULATION_PAIRWISE,
+                                   blob::ACCUMULATION_WIDE};
+  std::cout.precision(9);
+  for(int i=0; i<4; i++)
+  {
+    blob::MatrixR::setAccumulation(policy[i]);
+    R.multiply(A,B);
+    std::cout << " " << name[i] << ": A*B = " << R[0] 
+              << " |A|^2 = " << A.squareNorm() << " (1.000002)" << std::endl;
+  }
+  blob::MatrixR::setAccumulation(blob::ACCUMULATION_NAIVE);
+  std::cout.precision(6);
+  std::cout << std::endl;
+  return true;
+}
+
+bool test18_rcond()
+{
+  std::cout << "test18_rcond" << std::endl << std::endl;
+
+  // well conditioned covariance: left untouched
+  real_t a[] = { 4.f, 1.f, 0.f,
+                 1.f, 3.f, 1.f,
+                 0.f, 1.f, 2.f };
+  real_t l[9];
+  blob::MatrixR A(3,3,a);
+  blob::MatrixR L(3,3,l);
+  real_t rcond = 0;
+
+  L.copy(A);
+  L.cholesky(false);
+  std::cout << " rcond(A) = " << blob::MatrixR::cholrcond(A.norm1(),L)
+            << " (0.225)" << std::endl;
+  A.regularize(1e-3f,&rcond);
+  std::cout << " regularize(A,1e-3) rcond = " << rcond << " => A = " 
+            << std::endl;
+  A.print();
+
+  // hilbert(5): cond1 ~ 9.4e5, regularized to rcond >= 1e-4
+  real_t h[25];
+  blob::MatrixR H(5,5,h);
+  for(int i=0; i<5; i++)
+    for(int j=0; j<5; j++)
+      h[i*5+j] = 1.f/(i+j+1);
+  real_t hl[25];
+  blob::MatrixR HL(5,5,hl);
+  HL.copy(H);
+  HL.cholesky(false);
+  std::cout << " rcond(hilb(5)) = " << blob::MatrixR::cholrcond(H.norm1(),HL)
+            << " (1.06e-6)" << std::endl;
+  H.regularize(1e-4f,&rcond);
+  std::cout << " regularize(hilb(5),1e-4) rcond = " << rcond 
+            << " => diag(H) = " << std::endl;
+  for(int i=0; i<5; i++)
+    std::cout << " " << h[i*5+i];
+  std::cout << std::endl;
+
+  // non symmetric matrix from its lu decomposition
+  real_t b[] = { 2.f, -51.f,  4.f,  3.f,  2.f,
+                 6.f, 167.f,-68.f,-10.f, 0.5f, 
+                -4.f,  24.f,-41.f, 44.f,-0.9f,
+                -1.f,   1.f,  0.f, 50.f,-44.f,
+                 2.f,   0.f,  3.f,  1.f,  1.f};
+  blob::MatrixR B(5,5,b);
+  real_t bnorm = B.norm1();
+  B.lu();
+  std::cout << " rcond(B) = " << blob::MatrixR::lurcond(bnorm,B) 
+            << " (0.00713)" << std::endl;
+  std::cout << std::endl;
+  return true;
+}
+
+bool test19_eig()
+{
+  std::cout << "test19_eig" << std::endl << std::endl;
+
+  real_t a[] = { 4.f, 1.f, 2.f, 0.5f,
+                 1.f, 3.f, 0.f, 1.f,
+                 2.f, 0.f, 5.f, 1.5f,
+                 0.5f, 1.f, 1.5f, 2.f };
+  real_t v[16], d[4], r[16], vt[16], vd[16];
+  blob::MatrixR A(4,4,a);
+  blob::MatrixR V(4,4,v);
+  blob::MatrixR D(4,1,d);
+  blob::MatrixR R(4,4,r);
+  blob::MatrixR Vt(4,4,vt);
+  blob::MatrixR VD(4,4,vd);
+
+  blob::MatrixR::eig(A,V,D);
+  std::cout << " eig(A) = " << std::endl;
+  D.print();
+  std::cout << " V*diag(d)*V' = " << std::endl;
+  blob::MatrixR::multiplyDiag(V,D,VD);
+  blob::MatrixR::transpose(V,Vt);
+  blob::MatrixR::multiply(VD,Vt,R);
+  R.print();
+
+  // slowly changing covariance: warm start from previous eigenvectors
+  a[0] += 0.01f; a[5] -= 0.02f; a[1] += 0.01f; a[4] += 0.01f;
+  blob::MatrixR::eig(A,V,D,true);
+  std::cout << " eig(A+dA) warm = " << std::endl;
+  D.print();
+  blob::MatrixR::multiplyDiag(V,D,VD);
+  blob::MatrixR::transpose(V,Vt);
+  blob::MatrixR::multiply(VD,Vt,R);
+  R.substract(A);
+  std::cout << " |V*diag(d)*V'-A| = " << R.norm() << std::endl;
+  std::cout << std::endl;
+  return true;
+}
+
+bool test20_svd()
+{
+  std::cout << "test20_svd" << std::endl << std::endl;
+
+  real_t a[] = { 1.f, 2.f, 3.f,
+                 4.f, 5.f, 6.f,
+                 7.f, 8.f, 9.f,
+                 1.f, 0.f, 1.f,
+                 2.f, 1.f, 0.f };
+  real_t u[15], s[3], v[9], vt[9], us[15], r[15];
+  blob::MatrixR A(5,3,a);
+  blob::MatrixR U(5,3,u);
+  blob::MatrixR S(3,1,s);
+  blob::MatrixR V(3,3,v);
+  blob::MatrixR Vt(3,3,vt);
+  blob::MatrixR US(5,3,us);
+  blob::MatrixR R(5,3,r);
+
+  blob::MatrixR::svd(A,U,S,V);
+  std::cout << " svd(A) = " << std::endl;
+  S.print();
+  blob::MatrixR::multiplyDiag(U,S,US);
+  blob::MatrixR::transpose(V,Vt);
+  blob::MatrixR::multiply(US,Vt,R);
+  R.substract(A);
+  std::cout << " |U*diag(s)*V'-A| = " << R.norm() << std::endl;
+
+  // allocation matrix (wide, rank deficient)
+  real_t b[] = { 1.f, 1.f, 1.f, 1.f, 2.f,
+                 1.f,-1.f, 1.f,-1.f, 0.f,
+                 2.f, 0.f, 2.f, 0.f, 2.f };
+  real_t bp[15], bbp[9], bbpb[15];
+  blob::MatrixR B(3,5,b);
+  blob::MatrixR Bp(5,3,bp);
+  blob::MatrixR BBp(3,3,bbp);
+  blob::MatrixR BBpB(3,5,bbpb);
+  blob::MatrixR::pinv(B,Bp);
+  std::cout << " pinv(B) = " << std::endl;
+  Bp.print();
+  BBp.multiply(B,Bp);
+  BBpB.multiply(BBp,B);
+  BBpB.substract(B);
+  std::cout << " |B*pinv(B)*B-B| = " << BBpB.norm() << std::endl;
+  std::cout << std::endl;
+  return true;
+}
+
+bool test21_expm()
+{
+  std::cout << "test21_expm" << std::endl << std::endl;
+
+  // rotation generator: exp([0 t; -t 0]) = [cos(t) sin(t); -sin(t) cos(t)]
+  real_t a[] = { 0.f, 2.f,
+                -2.f, 0.f };
+  real_t r[4];
+  blob::MatrixR A(2,2,a);
+  blob::MatrixR R(2,2,r);
+  blob::MatrixR::expm(A,R);
+  std::cout << " expm(A) = " << std::endl;
+  R.print();
+  std::cout << " (" << blob::math::cos(2.f) << " " << blob::math::sin(2.f) 
+            << ")" << std::endl;
+
+  // constant velocity model: Phi = [1 dt; 0 1], 
+  // Qd = q*[dt^3/3 dt^2/2; dt^2/2 dt]
+  real_t f[] = { 0.f, 1.f,
+                 0.f, 0.f };
+  real_t q[] = { 0.f, 0.f,
+                 0.f, 2.f };
+  real_t phi[4], qd[4];
+  blob::MatrixR F(2,2,f);
+  blob::MatrixR Q(2,2,q);
+  blob::MatrixR Phi(2,2,phi);
+  blob::MatrixR Qd(2,2,qd);
+  blob::MatrixR::discretize(F,Q,0.1f,Phi,Qd);
+  std::cout << " discretize(F,Q,0.1) => Phi = " << std::endl;
+  Phi.print();
+  std::cout << " Qd = (0.000666667 0.01; 0.01 0.2)" << std::endl;
+  Qd.print();
+
+  // sensors at fixed rates: same sample periods repeat
+  blob::Discretizer disc(F,Q);
+  real_t dts[] = { 0.01f, 0.02f, 0.1f };
+  for(int i=0; i<300; i++)
+    disc.discretize(dts[i%3],Phi,Qd);
+  std::cout << " cached discretize x300: hits=" << disc.hits() 
+            << " misses=" << disc.misses() << " (297 3)" << std::endl;
+  std::cout << std::endl;
+  return true;
+}
+
+bool test22_tuner()
+{
+  std::cout << "test22_tuner" << std::endl << std::endl;
+
+  // ukf (n=7) covariance product and 20x20 product
+  blob::Tuner::reset();
+  blob::Tuner::registerShape(7,15,7);
+  blob::Tuner::registerShape(20,20,20);
+  std::cout << " tuned " << blob::Tuner::tune() << " shapes" << std::endl;
+  blob::Tuner::save("test_tuner.txt");
+
+  blob::Tuner::reset();
+  bool loaded = blob::Tuner::load("test_tuner.txt");
+  std::cout << " reloaded=" << loaded << " re-tuned " << blob::Tuner::tune()
+            << " shapes (0)" << std::endl;
+
+  real_t a[7*15], b[15*7], r[49], r0[49];
+  for(int i=0; i<7*15; i++)
+  {
+    a[i] = 0.01f*i;
+    b[i] = 1.f - 0.02f*i;
+  }
+  blob::MatrixR A(7,15,a), B(15,7,b), R(7,7,r), R0(7,7,r0);
+  for(int k=0; k<blob::KERNEL_COUNT; k++)
+  {
+    blob::Tuner::multiply(blob::KERNEL_SCALAR,A,B,R0);
+    blob::Tuner::multiply((blob::kernel_t)k,A,B,R);
+    R.substract(R0);
+    std::cout << " " << blob::Tuner::name((blob::kernel_t)k) 
+              << ": |R-R0| = " << R.norm() << std::endl;
+  }
+  blob::MatrixR::multiply(A,B,R);
+  R.substract(R0);
+  std::cout << " dispatched: |R-R0| = " << R.norm() << std::endl;
+  blob::Tuner::reset();
+  remove("test_tuner.txt");
+  std::cout << std::endl;
+  return true;
+}
+
+bool test23_series()
+{
+  std::cout << "test23_series" << std::endl << std::endl;
+
+  // text dataset -> series file
+  FILE * text = fopen("test_series.in", "w");
+  fprintf(text, "t x y (dt=0.5)\n0 1 -2\n0.5 1.5 -2.5\n1 2 -3\n");
+  fclose(text);
+  long n = blob::SeriesWriter::convert("test_series.in", "test_series.bin");
+  std::cout << " converted " << n << " rows (3)" << std::endl;
+
+  // append-only writing with element conversion
+  const char * names[] = { "t", "x", "y" };
+  blob::SeriesWriter writer;
+  bool opened = writer.open("test_series.bin", 3, names, 0.5, 
+                            blob::SERIES_FLOAT64);
+  std::cout << " append with other type: " << opened << " (0)" << std::endl;
+  opened = writer.open("test_series.bin", 3, names, 0.5);
+  real_t rows[] = { 1.5, 2.5, -3.5,  2, 3, -4 };
+  writer.append(rows, 2);
+  std::cout << " appended: " << opened << " rows=" << writer.nrows() << " (5)" 
+            << std::endl;
+  writer.close();
+
+  // zero-copy reading
+  blob::SeriesReader reader;
+  bool ok = reader.open("test_series.bin");
+  std::cout << " read: " << ok << " " << reader.nrows() << "x" 
+            << reader.ncols() << " dtype=" << reader.dtype() << " dt=" 
+            << reader.dt() << " aligned=" 
+            << blob::isAligned(reader.data<real_t>(), 64) << std::endl;
+  std::cout << " columns:";
+  for(uint32_t j=0; j<reader.ncols(); j++)
+    std::cout << " " << reader.name(j);
+  std::cout << " (y is " << reader.column("y") << ")" << std::endl;
+  for(uint64_t i=0; i<reader.nrows(); i++)
+  {
+    const real_t * r = reader.row<real_t>(i);
+    std::cout << "  " << r[0] << " " << r[1] << " " << reader.value(i,2)
+              << std::endl;
+  }
+  reader.close();
+  remove("test_series.in");
+  remove("test_series.bin");
+  std::cout << std::endl;
+  return true;
+}
+
+bool test24_ldl()
+{
+  std::cout << "test24_ldl" << std::endl << std::endl;
+
+  real_t a[] = { 4.f, 2.f, 0.4f, 0.f,
+                 2.f, 5.f, 1.f,  0.5f,
+                 0.4f,1.f, 3.f,  1.f,
+                 0.f, 0.5f,1.f,  2.f };
+  real_t f[16], l[16], d[4], g[16], v[4], w[4], b[8];
+  blob::MatrixR A(4,4,a), F(4,4,f), L(4,4,l), D(4,1,d), G(4,4,g);
+  blob::MatrixR V(4,1,v), W(4,1,w), B(4,2,b);
+
+  // in place factorization against static one and restore
+  F.copy(A);
+  bool ok = F.ldl();
+  std::cout << " ldl(A) = " << ok << " => LD = " << std::endl;
+  F.print();
+  blob::MatrixR::ldl(A,L,D);
+  real_t e = 0;
+  for(int i=0; i<4; i++)
+  {
+    e += blob::math::rabs(d[i] - f[i*4+i]);
+    for(int j=0; j<i; j++)
+      e += blob::math::rabs(l[i*4+j] - f[i*4+j]);
+  }
+  std::cout << " |static ldl - in place ldl| = " << e << " (0)" << std::endl;
+  G.copy(F);
+  G.ldlrestore();
+  G.substract(A);
+  std::cout << " |ldlrestore(LD) - A| = " << G.norm() << " (0)" << std::endl;
+
+  // rank-1 update against factorization of A + 0.5*v*v'
+  for(int i=0; i<4; i++)
+    v[i] = w[i] = 0.5f - 0.3f*i;
+  G.copy(A);
+  for(int i=0; i<4; i++)
+    for(int j=0; j<4; j++)
+      g[i*4+j] += 0.5f*v[i]*v[j];
+  G.ldl();
+  F.ldlupdate(V,0.5f);
+  G.substract(F);
+  std::cout << " |ldlupdate(LD,v,0.5) - ldl(A+0.5vv')| = " << G.norm() 
+            << " (0)" << std::endl;
+
+  // downdate back to A
+  F.ldlupdate(W,-0.5f);
+  G.copy(F);
+  G.ldlrestore();
+  G.substract(A);
+  std::cout << " |ldlupdate(LD,v,-0.5) restored - A| = " << G.norm() << " (0)"
+            << std::endl;
+  for(int i=0; i<4; i++)
+    v[i] = 0.5f - 0.3f*i;
+  std::cout << " downdate to indefinite = " << F.ldlupdate(V,-100.f) << " (0)"
+            << std::endl;
+
+  // solve A*X = B
+  F.copy(A);
+  F.ldl();
+  for(int i=0; i<8; i++)
+    b[i] = 1.f + i;
+  real_t x[8];
+  blob::MatrixR X(4,2,x);
+  X.copy(B);
+  F.ldlsolve(X);
+  real_t r[8];
+  blob::MatrixR AX(4,2,r);
+  AX.multiply(A,X);
+  AX.substract(B);
+  std::cout << " |A*ldlsolve(B) - B| = " << AX.norm() << " (0)" << std::endl;
+  std::cout << std::endl;
+  return true;
+}
+
+bool test25_pcholesky()
+{
+  std::cout << "test25_pcholesky" << std::endl << std::endl;
+
+  // rank 2 covariance A = B*B', B = [1 0; 1 1; 0 2; 2 1]
+  real_t bb[] = { 1.f, 0.f,  1.f, 1.f,  0.f, 2.f,  2.f, 1.f };
+  real_t a[16], l[16], s[16], r[16];
+  blob::MatrixR B(4,2,bb), A(4,4,a), L(4,4,l), S(4,4,s), R(4,4,r);
+  for(int i=0; i<4; i++)
+    for(int j=0; j<4; j++)
+      a[i*4+j] = bb[i*2]*bb[j*2] + bb[i*2+1]*bb[j*2+1];
+
+  L.copy(A);
+  std::cout << " cholesky(A) = " << L.cholesky() << " (0)" << std::endl;
+  uint8_t piv[4], rank = 0;
+  L.copy(A);
+  bool ok = L.pcholesky(piv, &rank);
+  std::cout << " pcholesky(A) = " << ok << " rank=" << (int)rank 
+            << " (2) piv=";
+  for(int i=0; i<4; i++)
+    std::cout << " " << (int)piv[i];
+  std::cout << " => L = " << std::endl;
+  L.print();
+  for(int i=0; i<4; i++)
+    for(int j=0; j<4; j++)
+      s[piv[i]*4+j] = l[i*4+j];
+  blob::MatrixR::transpose(S,L);
+  R.multiply(S,L);
+  R.substract(A);
+  std::cout << " |S*S' - A| = " << R.norm() << " (0)" << std::endl;
+
+  // slightly indefinite covariance
+  real_t c[] = { 2.f,   1.f, 0.f,
+                 1.f,   0.5f, 0.f,
+                 0.f,   0.f, -1e-3f };
+  real_t m[9], mt[9], e[9];
+  blob::MatrixR C(3,3,c), M(3,3,m), Mt(3,3,mt), E(3,3,e);
+  M.copy(C);
+  ok = M.pcholesky(NULL, &rank);
+  std::cout << " pcholesky(C) = " << ok << " rank=" << (int)rank << " (1)" 
+            << std::endl;
+  real_t shift = 0;
+  M.copy(C);
+  ok = M.mcholesky(&shift);
+  std::cout << " mcholesky(C) = " << ok << " max(E)=" << shift 
+            << " => L = " << std::endl;
+  M.print();
+  blob::MatrixR::transpose(M,Mt);
+  E.multiply(M,Mt);
+  E.substract(C);
+  std::cout << " E = L*L' - C = " << std::endl;
+  E.print();
+
+  // positive definite matrix is not modified
+  real_t p[] = { 4.f, 2.f, 0.f,  2.f, 3.f, 1.f,  0.f, 1.f, 2.f };
+  blob::MatrixR P(3,3,p);
+  M.copy(P);
+  M.mcholesky(&shift);
+  E.copy(P);
+  E.cholesky();
+  E.substract(M);
+  std::cout << " mcholesky(P) max(E)=" << shift << " (0) |L - chol(P)| = " 
+            << E.norm() << " (0)" << std::endl;
+  std::cout << std::endl;
+  return true;
+}
+
+bool test26_weighted()
+{
+  std::cout << "test26_weighted" << std::endl << std::endl;
+
+  // 3 dimensional set of 7 samples
+  real_t u[21], w[7], mu[3], p[9], d[21], c[9];
+  for(int k=0; k<7; k++)
+  {
+    w[k] = (k == 0)? 0.4f : 0.1f;
+    u[k] = 1.f + 0.5f*k;
+    u[7+k] = (k%2)? -1.f : 2.f;
+    u[14+k] = 0.1f*k*k;
+  }
+  blob::MatrixR U(3,7,u), W(7,1,w), Mu(3,1,mu), P(3,3,p), D(3,7,d), C(3,3,c);
+  blob::MatrixR::weightedMean(U,W,Mu);
+  std::cout << " mean = " << mu[0] << " " << mu[1] << " " << mu[2] 
+            << " (2.05 1.1 0.91)" << std::endl;
+  blob::MatrixR::weightedCov(U,W,Mu,P,&D);
+  std::cout << " cov = " << std::endl;
+  P.print();
+  real_t e = 0;
+  for(int i=0; i<3; i++)
+    for(int j=0; j<3; j++)
+    {
+      real_t r = 0;
+      for(int k=0; k<7; k++)
+        r += w[k]*(u[i*7+k] - mu[i])*(u[j*7+k] - mu[j]);
+      e += blob::math::rabs(r - p[i*3+j]);
+    }
+  std::cout << " |cov - sum(w*(u-mu)*(u-mu)')| = " << e << " (0)" 
+            << std::endl;
+  blob::MatrixR::weightedCross(D,D,W,C);
+  C.substract(P);
+  std::cout << " |cross(D,D) - cov| = " << C.norm() << " (0)" << std::endl;
+  std::cout << std::endl;
+  return true;
+}
+
+bool test27_blocks()
+{
+  std::cout << "test27_blocks" << std::endl << std::endl;
+
+  real_t p[] = { 1.f, 2.f,  2.f, 3.f };
+  real_t q[] = { 4.f };
+  real_t r[] = { 5.f, 6.f,  7.f, 8.f };
+  real_t aug[25], h[8], v[8], g[4];
+  blob::MatrixR P(2,2,p), Q(1,1,q), R(2,2,r), Aug(5,5,aug);
+  blob::MatrixR H(2,4,h), V(4,2,v), G(2,2,g);
+
+  // augmented covariance blkdiag(P,Q,R)
+  bool ok = blob::MatrixR::blkdiag(P,Q,R,Aug);
+  std::cout << " blkdiag(P,Q,R) = " << ok << std::endl;
+  Aug.print();
+  std::cout << " blkdiag(P,R) into 5x5 = " 
+            << blob::MatrixR::blkdiag(P,R,Aug) << " (0)" << std::endl;
+
+  blob::MatrixR::hstack(P,R,H);
+  std::cout << " hstack(P,R) = " << std::endl;
+  H.print();
+  blob::MatrixR::vstack(P,R,V);
+  std::cout << " vstack(P,R) = " << std::endl;
+  V.print();
+
+  Aug.getBlock(G,3,3);
+  G.substract(R);
+  std::cout << " |getBlock(Aug,3,3) - R| = " << G.norm() << " (0)" 
+            << std::endl;
+  std::cout << " setBlock out of range = " << Aug.setBlock(R,4,0) << " (0)" 
+            << std::endl;
+  std::cout << std::endl;
+  return true;
+}
+
+bool test28_gemv()
+{
+  std::cout << "test28_gemv" << std::endl << std::endl;
+
+  real_t a[] = { 1.f, 2.f, 3.f,
+                 4.f, 5.f, 6.f };
+  real_t s[] = { 2.f, 0.f, 0.f,
+                 1.f, 3.f, 0.f,
+                 4.f, 5.f, 6.f }; // lower triangle of symmetric matrix
+  real_t x[] = { 1.f, -1.f, 2.f };
+  real_t z[] = { 0.5f, -2.f };
+  real_t y2[2], y3[3], r[6];
+  blob::MatrixR A(2,3,a), S(3,3,s), X(3,1,x), Z(2,1,z), Y2(2,1,y2), Y3(3,1,y3);
+  blob::MatrixR R(2,3,r);
+
+  blob::MatrixR::gemv(A,X,Y2);
+  std::cout << " A*x = " << y2[0] << " " << y2[1] << " (5 11)" << std::endl;
+  blob::MatrixR::gemv(A,X,Y2,2,1);
+  std::cout << " 2*A*x + y = " << y2[0] << " " << y2[1] << " (15 33)" 
+            << std::endl;
+  blob::MatrixR::gemvT(A,Z,Y3);
+  std::cout << " A'*z = " << y3[0] << " " << y3[1] << " " << y3[2] 
+            << " (-7.5 -9 -10.5)" << std::endl;
+  blob::MatrixR::symv(S,X,Y3);
+  std::cout << " S*x = " << y3[0] << " " << y3[1] << " " << y3[2] 
+            << " (9 8 11)" << std::endl;
+  R.copy(A);
+  R.ger(Z,X,-1);
+  std::cout << " A - z*x' = " << std::endl;
+  R.print();
+
+  // dispatch of vector operands
+  blob::MatrixR Zt(1,2,z), Xt(1,3,x);
+  blob::MatrixR::multiply(A,X,Y2);
+  std::cout << " multiply(A,x) = " << y2[0] << " " << y2[1] << " (5 11)" 
+            << std::endl;
+  blob::MatrixR::multiply(Zt,A,Xt);
+  std::cout << " multiply(z',A) = " << x[0] << " " << x[1] << " " << x[2] 
+            << " (-7.5 -9 -10.5)" << std::endl;
+  blob::MatrixR::multiply(Z,Xt,R);
+  std::cout << " multiply(z,x') = " << std::endl;
+  R.print();
+  std::cout << std::endl;
+  return true;
+}
+
+bool test29_qrsolve()
+{
+  std::cout << "test29_qrsolve" << std::endl << std::endl;
+
+  real_t a[] = { 3.f, 1.f,
+                 4.f, 2.f,
+                 0.f, 2.f };
+  real_t r[4];
+  blob::MatrixR A(3,2,a), R(2,2,r);
+
+  blob::MatrixR::qr(A,R);
+  std::cout << " R = qr(A) (5 2.2; 0 2.0396) = " << std::endl;
+  R.print();
+
+  real_t l[] = { 2.f, 0.f,
+                 1.f, 3.f };
+  real_t b[] = { 8.f, 22.f };
+  blob::MatrixR L(2,2,l), B(2,1,b);
+
+  L.cholsolve(B);
+  std::cout << " L*L'\\b = " << b[0] << " " << b[1] << " (1 2)" << std::endl;
+  std::cout << std::endl;
+  return true;
+}
+
+template <typename S> S dualFunction (const S & x, const S & y)
+{
+  return x*y + sin(x)/y + 3*atan2(y, x) - sqrt(x*x + y*y);
+}
+
+bool test30_dual()
+{
+  std::cout << "test30_dual" << std::endl << std::endl;
+
+  typedef blob::Dual<2> D;
+  D x(1, 0), y(2, 1);
+  D f = dualFunction(x, y);
+  std::cout << " f(1,2) = " << f << " (3.50611 [0.622938 0.495205])" << std::endl;
+
+  // same template over real_t, central differences of gradient
+  real_t h = 1e-2f;
+  real_t fx = (dualFunction<real_t>(1+h,2) - dualFunction<real_t>(1-h,2))/(2*h);
+  real_t fy = (dualFunction<real_t>(1,2+h) - dualFunction<real_t>(1,2-h))/(2*h);
+  std::cout << " f(1,2) = " << dualFunction<real_t>(1,2) << " [" << fx << " " 
+            << fy << "] (central differences)" << std::endl;
+
+  D e = exp(log(x*y))/y - 1;
+  std::cout << " exp(log(x*y))/y - 1 = " << e << " (0 [1 0])" << std::endl;
+  std::cout << std::endl;
+  return true;
 }
 
 int main(int argc, char* argv[])
@@ -1016,6 +1650,21 @@ int main(int argc, char* argv[])
   test14_lu();
   test15_lu();
   test16_lu();
+
+  test17_accumulation();
+  test18_rcond();
+  test19_eig();
+  test20_svd();
+  test21_expm();
+  test22_tuner();
+  test23_series();
+  test24_ldl();
+  test25_pcholesky();
+  test26_weighted();
+  test27_blocks();
+  test28_gemv();
+  test29_qrsolve();
+  test30_dual();
   
   return 0;
 }
@@ -0,0 +1,123 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       pool.h
+ * \brief      interface for persistent worker thread pool (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#ifndef B_POOL_H
+#define B_POOL_H
+
+#include <blob/types.h>
+
+#if defined(__linux__)
+  #include <pthread.h>
+#endif
+
+#if !defined(BLOB_POOL_MAX_THREADS)
+ #define BLOB_POOL_MAX_THREADS 16
+#endif
+
+namespace blob {
+
+#if defined(__linux__)
+
+/**
+ * Defines job to be executed by the pool over one chunk of work.
+ * \param arg    job argument given to Pool::run()
+ * \param chunk  index of chunk to process, in [0, nchunks)
+ */
+typedef void (*pool_job_t)(void* arg, uint32_t chunk);
+
+/**
+ * Implements persistent pool of worker threads. Threads are created once and
+ * sleep between jobs; each job is split in chunks that threads (caller 
+ * included) claim dynamically. Results only depend on the chunk index, never
+ * on the thread that processed it, so chunked jobs are deterministic for any
+ * number of threads.
+ */
+class Pool
+{
+  public:
+    /**
+     * Creates worker threads.
+     * \param nthreads  number of threads including caller, 0 for one per 
+     *                  online processor
+     */
+    Pool (uint8_t nthreads=0);
+    /**
+     * Stops and joins worker threads.
+     */
+    ~Pool ();
+    /**
+     * Executes job over nchunks chunks and waits until all are processed.
+     * The calling thread also processes chunks.
+     * \param job      function to execute for each chunk
+     * \param arg      argument passed to job
+     * \param nchunks  number of chunks
+     * \return  true if successful, false otherwise.
+     */
+    bool run (pool_job_t job, void* arg, uint32_t nchunks);
+    /**
+     * Provides number of threads, caller included.
+     * \return  number of threads
+     */
+    uint8_t getNumThreads () {return _nthreads;}
+
+  protected:
+    /**
+     * Worker thread entry point.
+     * \param pool  pointer to pool
+     * \return  NULL
+     */
+    static void* loop (void* pool);
+    /**
+     * Claims and processes chunks of current job until none is left.
+     * \param job      function to execute for each chunk
+     * \param arg      argument passed to job
+     * \param nchunks  number of chunks
+     * \return  number of chunks processed
+     */
+    uint32_t work (pool_job_t job, void* arg, uint32_t nchunks);
+
+    uint8_t         _nthreads;   /**< number of threads, caller included */
+    pthread_t       _threads[BLOB_POOL_MAX_THREADS]; /**< worker threads */
+    pthread_mutex_t _mutex;      /**< protects job state */
+    pthread_cond_t  _wake;       /**< signals new job or stop to workers */
+    pthread_cond_t  _done;       /**< signals job completion to caller */
+    pool_job_t      _job;        /**< current job */
+    void*           _arg;        /**< current job argument */
+    uint32_t        _nchunks;    /**< current job number of chunks */
+    uint32_t        _next;       /**< next chunk to claim (atomic) */
+    uint32_t        _finished;   /**< chunks processed of current job */
+    uint32_t        _generation; /**< job counter, wakes workers */
+    uint8_t         _busy;       /**< workers inside current job */
+    bool            _stop;       /**< requests workers to exit */
+};
+
+#endif // defined(__linux__)
+}
+#endif /* B_POOL_H */
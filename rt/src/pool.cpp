@@ -0,0 +1,177 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Blob Robotics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal 
+ * in the Software without restriction, including without limitation the rights 
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+ * SOFTWARE.
+ * 
+ * \file       pool.cpp
+ * \brief      implementation of persistent worker thread pool (linux)
+ * \author     adrian jimenez-gonzalez (blob.robots@gmail.com)
+ * \copyright  the MIT License Copyright (c) 2015 Blob Robots.
+ *
+ ******************************************************************************/
+
+#include "blob/pool.h"
+
+#if defined(__linux__)
+
+#include <unistd.h>
+#if defined(__DEBUG__)
+  #include <iostream>
+#endif
+
+blob::Pool::Pool (uint8_t nthreads)
+{
+  if(nthreads == 0)
+  {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = (ncpu > 0)? ((ncpu < 255)? ncpu:255) : 1;
+  }
+  if(nthreads > BLOB_POOL_MAX_THREADS)
+    nthreads = BLOB_POOL_MAX_THREADS;
+
+  _job = NULL;
+  _arg = NULL;
+  _nchunks = 0;
+  _next = 0;
+  _finished = 0;
+  _generation = 0;
+  _busy = 0;
+  _stop = false;
+
+  pthread_mutex_init(&_mutex, NULL);
+  pthread_cond_init(&_wake, NULL);
+  pthread_cond_init(&_done, NULL);
+
+  // caller is thread 0
+  _nthreads = 1;
+  for(int i=1; i<nthreads; i++)
+  {
+    if(pthread_create(&_threads[i], NULL, loop, this) != 0)
+    {
+#if defined(__DEBUG__)
+      std::cerr << "Pool::Pool() error: unable to create thread " << i 
+                << std::endl;
+#endif
+      break;
+    }
+    _nthreads++;
+  }
+}
+
+blob::Pool::~Pool ()
+{
+  pthread_mutex_lock(&_mutex);
+  _stop = true;
+  pthread_cond_broadcast(&_wake);
+  pthread_mutex_unlock(&_mutex);
+
+  for(int i=1; i<_nthreads; i++)
+    pthread_join(_threads[i], NULL);
+
+  pthread_cond_destroy(&_done);
+  pthread_cond_destroy(&_wake);
+  pthread_mutex_destroy(&_mutex);
+}
+
+uint32_t blob::Pool::work (pool_job_t job, void* arg, uint32_t nchunks)
+{
+  uint32_t count = 0;
+  uint32_t chunk = __sync_fetch_and_add(&_next, 1);
+  while(chunk < nchunks)
+  {
+    job(arg, chunk);
+    count++;
+    chunk = __sync_fetch_and_add(&_next, 1);
+  }
+  return count;
+}
+
+bool blob::Pool::run (pool_job_t job, void* arg, uint32_t nchunks)
+{
+  if(!job)
+    return false;
+
+  // nothing to share: run inline without waking workers
+  if((_nthreads == 1) || (nchunks <= 1))
+  {
+    for(uint32_t c=0; c<nchunks; c++)
+      job(arg, c);
+    return true;
+  }
+
+  pthread_mutex_lock(&_mutex);
+  _job = job;
+  _arg = arg;
+  _nchunks = nchunks;
+  _next = 0;
+  _finished = 0;
+  _generation++;
+  pthread_cond_broadcast(&_wake);
+  pthread_mutex_unlock(&_mutex);
+
+  uint32_t count = work(job, arg, nchunks);
+
+  // wait for all chunks and for every worker to leave the job, so that no
+  // late worker claims chunks of the next job with this job's arguments
+  pthread_mutex_lock(&_mutex);
+  _finished += count;
+  while((_finished < nchunks) || (_busy > 0))
+    pthread_cond_wait(&_done, &_mutex);
+  _job = NULL;
+  pthread_mutex_unlock(&_mutex);
+
+  return true;
+}
+
+void* blob::Pool::loop (void* pool)
+{
+  blob::Pool* p = (blob::Pool*)pool;
+  uint32_t generation = 0;
+
+  pthread_mutex_lock(&p->_mutex);
+  while(true)
+  {
+    while(!p->_stop && ((generation == p->_generation) || !p->_job))
+      pthread_cond_wait(&p->_wake, &p->_mutex);
+    if(p->_stop)
+      break;
+
+    generation = p->_generation;
+    pool_job_t job = p->_job;
+    void* arg = p->_arg;
+    uint32_t nchunks = p->_nchunks;
+    p->_busy++;
+    pthread_mutex_unlock(&p->_mutex);
+
+    uint32_t count = p->work(job, arg, nchunks);
+
+    pthread_mutex_lock(&p->_mutex);
+    p->_finished += count;
+    p->_busy--;
+    if((p->_finished >= nchunks) && (p->_busy == 0))
+      pthread_cond_signal(&p->_done);
+  }
+  pthread_mutex_unlock(&p->_mutex);
+
+  return NULL;
+}
+
+#endif // defined(__linux__)
@@ -32,6 +32,7 @@
 
 #if defined(__linux__)
   #include <unistd.h>
+  #include <sys/time.h>
 #endif //defined(__linux__)
 
 uint8_t blob::Task::_number = 0;
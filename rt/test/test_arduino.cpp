@@ -11,13 +11,15 @@
 class TestTask : public blob::Task 
 {
   public:
-    void init () { 
+    bool init () { 
       Serial.println("task init");
+      return true;
     }
-    void update () {
+    bool update () {
       static int i = 0;
       Serial.print("index: "); Serial.print(i++);
       Serial.print(" dtime: "); Serial.println(this->getTimeLapse());
+      return true;
     }
 };
 
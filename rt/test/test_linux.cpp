@@ -10,12 +10,14 @@
 class TestTask : public blob::Task 
 {
   public:
-    void init () { 
+    bool init () { 
       std::cout << "task init" << std::endl;
+      return true;
     }
-    void update () {
+    bool update () {
       int i = 0;
       std::cout << "index: " << i++ << "dtime: " << getTimeLapse() << std::endl;
+      return true;
     }
 };
 
@@ -0,0 +1,80 @@
+/********* blob robotics 2015 *********
+ *  title: test_pool_linux.cpp
+ *  brief: test for worker thread pool (linux)
+ * author: adrian jimenez-gonzalez
+ * e-mail: blob.robotics@gmail.com
+ /*************************************/
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <time.h>
+#include "blob/pool.h"
+
+#define N      (1<<22) // elements
+#define CHUNKS 64      // chunks per job
+#define REPEAT 20      // jobs per timing
+
+struct Job
+{
+  float  *x;
+  double partial[CHUNKS];
+};
+
+void square (void* arg, uint32_t chunk)
+{
+  Job* job = (Job*)arg;
+  uint32_t begin = chunk*(N/CHUNKS), end = begin + N/CHUNKS;
+  double sum = 0;
+  for(uint32_t i=begin; i<end; i++)
+  {
+    job->x[i] = sinf(job->x[i]) + 1e-3f*i/N;
+    sum += job->x[i]*job->x[i];
+  }
+  job->partial[chunk] = sum;
+}
+
+double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+double run (blob::Pool & pool, float* x, double & seconds)
+{
+  Job job;
+  job.x = x;
+  for(uint32_t i=0; i<N; i++)
+    x[i] = (float)i/N;
+
+  double t0 = now();
+  for(int r=0; r<REPEAT; r++)
+    pool.run(square, &job, CHUNKS);
+  seconds = (now() - t0)/REPEAT;
+
+  // deterministic reduction: partial sums added in chunk order
+  double sum = 0;
+  for(int c=0; c<CHUNKS; c++)
+    sum += job.partial[c];
+  return sum;
+}
+
+int main(int argc, char* argv[])
+{
+  static float x[N];
+  double t1, tn;
+
+  blob::Pool single(1);
+  blob::Pool pool((argc > 1)? atoi(argv[1]) : 0); // default one per cpu
+
+  double s1 = run(single, x, t1);
+  double sn = run(pool, x, tn);
+
+  std::cout.precision(17);
+  std::cout << "1 thread:  sum=" << s1 << " time=" << t1 << "s" << std::endl;
+  std::cout << (int)pool.getNumThreads() << " threads: sum=" << sn 
+            << " time=" << tn << "s" << std::endl;
+  std::cout << "deterministic: " << ((s1 == sn)? "yes":"no") << std::endl;
+
+  return (s1 == sn)? 0 : -1;
+}